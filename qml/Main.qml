@@ -1,5 +1,6 @@
 import QtQuick
 import QtQuick.Controls
+import QtQuick.Dialogs
 import QtQuick.Layouts
 import QtQuick.Window
 import KeithConsole 1.0
@@ -20,19 +21,6 @@ Window {
 
         Component.onCompleted: forceActiveFocus()
 
-        Keys.onPressed: event => {
-            if (event.key === Qt.Key_Return || event.key === Qt.Key_Enter) {
-                terminalBridge.sendText("\r");
-                event.accepted = true;
-            } else if (event.key === Qt.Key_Backspace) {
-                terminalBridge.sendText("\x7f");
-                event.accepted = true;
-            } else if (event.text.length > 0 && !event.text.match(/^[\x00-\x1F]$/)) {
-                terminalBridge.sendText(event.text);
-                event.accepted = true;
-            }
-        }
-
         MouseArea {
             anchors.fill: parent
             acceptedButtons: Qt.AllButtons
@@ -40,15 +28,240 @@ Window {
         }
     }
 
+    // Performance HUD; sampling only runs while it is shown.
+    Rectangle {
+        id: hud
+        visible: false
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 8
+        width: hudText.implicitWidth + 16
+        height: hudText.implicitHeight + 12
+        radius: 4
+        color: "#c0000000"
+
+        Text {
+            id: hudText
+            anchors.centerIn: parent
+            color: "#e0e0e0"
+            font.family: "monospace"
+            font.pixelSize: 11
+            text: [
+                "frame      " + performanceStats.frameTimeMs.toFixed(2) + " ms  "
+                    + performanceStats.framesPerSecond.toFixed(0) + " fps",
+                "parse      " + performanceStats.parseMegabytesPerSecond.toFixed(1) + " MB/s",
+                "pty        " + (performanceStats.ptyBytesPerSecond / 1024).toFixed(1) + " KB/s",
+                "dirty      " + performanceStats.dirtyCellsPerFrame.toFixed(0) + " cells/frame",
+                "scrollback " + performanceStats.scrollbackMegabytes.toFixed(2) + " MB",
+                "glyphs     " + (performanceStats.glyphAtlasHitRate * 100).toFixed(1) + "% atlas  "
+                    + (performanceStats.glyphRunHitRate * 100).toFixed(1) + "% rows"
+            ].join("\n")
+        }
+    }
+
+    // Find in scrollback. Enter steps to older matches, Shift+Enter to newer.
+    Rectangle {
+        id: findBar
+        visible: false
+        anchors.top: parent.top
+        anchors.left: parent.left
+        anchors.margins: 8
+        width: findRow.implicitWidth + 16
+        height: findRow.implicitHeight + 12
+        radius: 4
+        color: "#e0202020"
+
+        function close() {
+            terminalBridge.clearFind()
+            visible = false
+            surface.forceActiveFocus()
+        }
+
+        function search() {
+            findField.valid = terminalBridge.find(findField.text, caseToggle.checked, regexToggle.checked)
+        }
+
+        RowLayout {
+            id: findRow
+            anchors.centerIn: parent
+            spacing: 6
+
+            TextField {
+                id: findField
+                property bool valid: true
+                Layout.preferredWidth: 260
+                placeholderText: qsTr("Find")
+                color: valid ? "#e0e0e0" : "#ff6060"
+                onTextChanged: findBar.search()
+                Keys.onReturnPressed: (event) => terminalBridge.findNext(!(event.modifiers & Qt.ShiftModifier))
+                Keys.onEnterPressed: (event) => terminalBridge.findNext(!(event.modifiers & Qt.ShiftModifier))
+                Keys.onEscapePressed: findBar.close()
+            }
+
+            CheckBox {
+                id: caseToggle
+                text: qsTr("Aa")
+                focusPolicy: Qt.NoFocus
+                onToggled: findBar.search()
+            }
+
+            CheckBox {
+                id: regexToggle
+                text: qsTr(".*")
+                focusPolicy: Qt.NoFocus
+                onToggled: findBar.search()
+            }
+
+            Text {
+                color: "#a0a0a0"
+                font.family: "monospace"
+                font.pixelSize: 11
+                text: findField.text.length === 0 ? ""
+                    : terminalBridge.searchMatchCount + (terminalBridge.searching ? "…" : "")
+                    + qsTr(" matches")
+            }
+        }
+    }
+
+    // Lines matched by notify triggers.
+    Rectangle {
+        id: notification
+        visible: false
+        anchors.bottom: parent.bottom
+        anchors.right: parent.right
+        anchors.margins: 8
+        width: Math.min(notificationText.implicitWidth + 16, root.width - 16)
+        height: notificationText.implicitHeight + 12
+        radius: 4
+        color: "#e0303030"
+
+        Text {
+            id: notificationText
+            anchors.fill: parent
+            anchors.margins: 6
+            color: "#e0e0e0"
+            font.family: "monospace"
+            font.pixelSize: 12
+            elide: Text.ElideRight
+        }
+
+        Timer {
+            id: notificationTimer
+            interval: 4000
+            onTriggered: notification.visible = false
+        }
+
+        Connections {
+            target: terminalBridge
+
+            function onTriggerNotification(pattern, line) {
+                notificationText.text = line
+                notification.visible = true
+                notificationTimer.restart()
+            }
+        }
+    }
+
+    // Exit status and run time of the command selected with Ctrl+Shift+Up/Down.
+    Rectangle {
+        id: commandBadge
+        // Read commandCount so the binding re-runs whenever a mark is recorded.
+        property var info: terminalBridge.commandCount >= 0 && terminalBridge.selectedCommand >= 0
+            ? terminalBridge.commandInfo(terminalBridge.selectedCommand) : ({})
+        visible: terminalBridge.selectedCommand >= 0
+        anchors.bottom: parent.bottom
+        anchors.left: parent.left
+        anchors.margins: 8
+        width: commandText.implicitWidth + 16
+        height: commandText.implicitHeight + 12
+        radius: 4
+        color: info.finished && info.exitCode > 0 ? "#e0602020" : "#e0203048"
+
+        Text {
+            id: commandText
+            anchors.centerIn: parent
+            color: "#e0e0e0"
+            font.family: "monospace"
+            font.pixelSize: 11
+            text: {
+                const info = commandBadge.info
+                if (info.durationMs === undefined) {
+                    return ""
+                }
+                const seconds = (info.durationMs / 1000).toFixed(2) + " s"
+                if (!info.finished) {
+                    return info.startedAt ? qsTr("running ") + seconds : qsTr("no output")
+                }
+                return (info.exitCode >= 0 ? qsTr("exit ") + info.exitCode : qsTr("done")) + "  " + seconds
+            }
+        }
+    }
+
+    Shortcut {
+        sequence: "Ctrl+Shift+Up"
+        onActivated: terminalBridge.selectAdjacentCommand(true)
+    }
+
+    Shortcut {
+        sequence: "Ctrl+Shift+Down"
+        onActivated: terminalBridge.selectAdjacentCommand(false)
+    }
+
+    Shortcut {
+        sequence: "Ctrl+Shift+O"
+        enabled: terminalBridge.selectedCommand >= 0
+        onActivated: terminalBridge.copyCommandOutput(terminalBridge.selectedCommand)
+    }
+
+    FileDialog {
+        id: saveScrollbackDialog
+        title: qsTr("Save Scrollback")
+        fileMode: FileDialog.SaveFile
+        nameFilters: [qsTr("Text files (*.txt)"), qsTr("All files (*)")]
+        onAccepted: terminalBridge.saveScrollback(selectedFile)
+    }
+
+    Shortcut {
+        sequence: "Ctrl+Shift+S"
+        onActivated: saveScrollbackDialog.open()
+    }
+
+    Shortcut {
+        sequence: "Ctrl+Shift+F"
+        onActivated: {
+            findBar.visible = true
+            findBar.search()
+            findField.selectAll()
+            findField.forceActiveFocus()
+        }
+    }
+
+    Shortcut {
+        sequence: "Ctrl+Shift+F12"
+        onActivated: hud.visible = !hud.visible
+    }
+
+    Binding {
+        target: performanceStats
+        property: "active"
+        value: hud.visible
+    }
+
     Binding {
         target: surface
         property: "fontFamily"
-        value: terminalBridge.config["font.family"] !== undefined ? terminalBridge.config["font.family"] : "monospace"
+        value: terminalBridge.fontFamily
     }
 
     Binding {
         target: surface
         property: "fontPointSize"
-        value: terminalBridge.config["font.size"] !== undefined ? terminalBridge.config["font.size"] : 13
+        value: terminalBridge.fontPointSize
+    }
+
+    Binding {
+        target: surface
+        property: "fontFallback"
+        value: terminalBridge.fontFallback
     }
 }
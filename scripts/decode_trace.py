@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Decode a keith_console binary event trace (recorded with --trace=FILE).
+
+Prints a per-event summary by default, or every record as CSV with --csv.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"KCTRACE1"
+RECORD = struct.Struct("<QIIq")
+
+EVENTS = {
+    1: ("pty_read", "bytes"),
+    2: ("parse", "ns"),
+    3: ("dirty_cells", "cells"),
+    4: ("frame_time", "ns"),
+    5: ("key_latency", "ns"),
+    255: ("dropped", "records"),
+}
+
+
+def read_records(path):
+    with open(path, "rb") as trace:
+        header = trace.read(len(MAGIC) + 4)
+        if len(header) < len(MAGIC) + 4 or header[: len(MAGIC)] != MAGIC:
+            sys.exit(f"{path}: not a keith_console trace")
+        (record_size,) = struct.unpack("<I", header[len(MAGIC):])
+        if record_size != RECORD.size:
+            sys.exit(f"{path}: record size {record_size}, expected {RECORD.size}")
+        while True:
+            chunk = trace.read(RECORD.size)
+            if len(chunk) < RECORD.size:
+                return
+            timestamp, event, _, value = RECORD.unpack(chunk)
+            yield timestamp, event, value
+
+
+def percentile(values, fraction):
+    index = round(fraction * (len(values) - 1))
+    return values[index]
+
+
+def summarise(records):
+    by_event = {}
+    first = last = None
+    for timestamp, event, value in records:
+        by_event.setdefault(event, []).append(value)
+        first = timestamp if first is None else min(first, timestamp)
+        last = timestamp if last is None else max(last, timestamp)
+    if first is None:
+        print("empty trace")
+        return
+
+    duration = (last - first) / 1e9
+    print(f"{duration:.3f} s traced")
+    print(f"{'event':<12} {'unit':<8} {'count':>9} {'total':>14} {'p50':>12} {'p99':>12} {'max':>12}")
+    for event in sorted(by_event):
+        name, unit = EVENTS.get(event, (f"event_{event}", ""))
+        values = sorted(by_event[event])
+        print(f"{name:<12} {unit:<8} {len(values):>9} {sum(values):>14} "
+              f"{percentile(values, 0.5):>12} {percentile(values, 0.99):>12} {values[-1]:>12}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("trace", help="trace file written by keith_console --trace=FILE")
+    parser.add_argument("--csv", action="store_true", help="print every record as CSV")
+    arguments = parser.parse_args()
+
+    records = read_records(arguments.trace)
+    if arguments.csv:
+        print("timestamp_ns,event,value")
+        for timestamp, event, value in records:
+            print(f"{timestamp},{EVENTS.get(event, (event,))[0]},{value}")
+    else:
+        summarise(records)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,295 @@
+#include "cpu_rasterizer.h"
+
+#include "profiling.h"
+#include "screen_buffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RENDER_HAVE_SSE2 1
+#endif
+
+namespace render
+{
+
+namespace {
+
+// Rows per worker task; smaller bands are not worth a thread hand-off.
+constexpr int kMinRowsPerTask = 4;
+
+inline quint32 blendPixel(quint32 foreground, quint32 background, uint coverage)
+{
+    const uint inverse = 255 - coverage;
+    quint32 result = 0xFF000000;
+    for (int shift = 0; shift < 24; shift += 8) {
+        const uint value = (((foreground >> shift) & 0xFF) * coverage) + (((background >> shift) & 0xFF) * inverse);
+        result |= (((value + 1 + (value >> 8)) >> 8) & 0xFF) << shift;
+    }
+    return result;
+}
+
+// destination[i] = lerp(background, foreground, coverage[i] / 255) for one
+// glyph scanline, four pixels per iteration where SSE2 is available.
+void blendSpan(quint32 *destination, const uchar *coverage, int count, quint32 foreground, quint32 background)
+{
+    int index = 0;
+#if defined(RENDER_HAVE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i foreground16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(foreground)), zero);
+    const __m128i background16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(background)), zero);
+    for (; index + 4 <= count; index += 4) {
+        quint32 packedCoverage;
+        std::memcpy(&packedCoverage, coverage + index, sizeof(packedCoverage));
+        if (packedCoverage == 0) {
+            const __m128i fill = _mm_set1_epi32(static_cast<int>(background));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + index), fill);
+            continue;
+        }
+        // Broadcast each coverage byte to the four channels of its pixel.
+        __m128i alpha = _mm_cvtsi32_si128(static_cast<int>(packedCoverage));
+        alpha = _mm_unpacklo_epi8(alpha, alpha);
+        alpha = _mm_unpacklo_epi16(alpha, alpha);
+        const __m128i alphaLow = _mm_unpacklo_epi8(alpha, zero);
+        const __m128i alphaHigh = _mm_unpackhi_epi8(alpha, zero);
+
+        // fg * a + bg * (255 - a) stays below 2^16, then divide by 255.
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(foreground16, alphaLow),
+                                    _mm_mullo_epi16(background16, _mm_sub_epi16(full, alphaLow)));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(foreground16, alphaHigh),
+                                     _mm_mullo_epi16(background16, _mm_sub_epi16(full, alphaHigh)));
+        low = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(low, one), _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(high, one), _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + index), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; index < count; ++index) {
+        destination[index] = blendPixel(foreground, background, coverage[index]);
+    }
+}
+
+}
+
+CpuRasterizer::CpuRasterizer()
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+void CpuRasterizer::setFont(const QFont &font, qreal devicePixelRatio, const QStringList &fallbackFamilies)
+{
+    const QSize previousCellSize = m_atlas.cellSize();
+    m_atlas.setFont(font, devicePixelRatio, fallbackFamilies);
+    m_devicePixelRatio = devicePixelRatio;
+    m_image.setDevicePixelRatio(devicePixelRatio);
+    if (m_atlas.cellSize() != previousCellSize) {
+        const int rows = m_rows;
+        const int columns = m_columns;
+        m_rows = 0;
+        resize(rows, columns);
+    }
+}
+
+void CpuRasterizer::resize(int rows, int columns)
+{
+    if (rows == m_rows && columns == m_columns) {
+        return;
+    }
+    m_rows = rows;
+    m_columns = columns;
+    m_cursorCell = -1;
+    m_cells = QVector<CellPaint>(rows * columns, CellPaint{{}, 0xFFC0C0C0, 0xFF101010});
+    m_rowDirty = QVector<bool>(rows, true);
+    m_rowMoved = QVector<bool>(rows, false);
+    const QSize cellSize = m_atlas.cellSize();
+    m_image = QImage(qMax(1, columns * cellSize.width()), qMax(1, rows * cellSize.height()), QImage::Format_RGB32);
+    m_image.setDevicePixelRatio(m_devicePixelRatio);
+}
+
+void CpuRasterizer::updateRow(int row, const terminal::Cell *cells, int firstColumn, int lastColumn)
+{
+    if (row < 0 || row >= m_rows) {
+        return;
+    }
+    firstColumn = std::max(firstColumn, 0);
+    lastColumn = lastColumn < 0 ? m_columns - 1 : std::min(lastColumn, m_columns - 1);
+    if (firstColumn > lastColumn) {
+        return;
+    }
+
+    const QVector<GlyphSlot> slots = m_shaper.shape(cells, firstColumn, lastColumn, m_columns, m_atlas);
+    CellPaint *paint = m_cells.data() + (row * m_columns);
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+        const terminal::CellAttributes &attributes = cells[column].attributes;
+        CellPaint &cell = paint[column];
+        cell.slot = slots[column - firstColumn];
+        cell.foreground = 0xFF000000 | (attributes.inverse ? attributes.background : attributes.foreground);
+        cell.background = 0xFF000000 | (attributes.inverse ? attributes.foreground : attributes.background);
+    }
+    markRowDirty(row);
+}
+
+void CpuRasterizer::setCursor(int row, int column)
+{
+    const int cell = (row >= 0 && row < m_rows && column >= 0 && column < m_columns)
+        ? (row * m_columns) + column
+        : -1;
+    if (cell == m_cursorCell) {
+        return;
+    }
+    if (m_cursorCell >= 0) {
+        markRowDirty(m_cursorCell / m_columns);
+    }
+    if (cell >= 0) {
+        markRowDirty(row);
+    }
+    m_cursorCell = cell;
+}
+
+void CpuRasterizer::scroll(int top, int bottom, int lines)
+{
+    top = std::max(top, 0);
+    bottom = std::min(bottom, m_rows - 1);
+    const int height = (bottom - top) + 1;
+    if (lines == 0 || height <= 0 || std::abs(lines) >= height) {
+        for (int row = top; row <= bottom; ++row) {
+            markRowDirty(row);
+        }
+        return;
+    }
+
+    // Rows vacated by the scroll arrive as damage spans from the screen buffer.
+    const int moved = height - std::abs(lines);
+    const int source = lines > 0 ? top + lines : top;
+    const int destination = lines > 0 ? top : top - lines;
+    CellPaint *cells = m_cells.data();
+    std::memmove(cells + (destination * m_columns), cells + (source * m_columns),
+                 sizeof(CellPaint) * moved * m_columns);
+    const int rowBytes = static_cast<int>(m_image.bytesPerLine()) * m_atlas.cellSize().height();
+    uchar *pixels = m_image.bits();
+    std::memmove(pixels + (destination * rowBytes), pixels + (source * rowBytes),
+                 static_cast<size_t>(rowBytes) * moved);
+
+    const auto movedBegin = m_rowMoved.begin() + destination;
+    std::fill(movedBegin, movedBegin + moved, true);
+    // The ranges overlap; copy in the direction that reads each flag before
+    // it is overwritten, as memmove does for the cells above.
+    const auto sourceBegin = m_rowDirty.begin() + source;
+    if (lines > 0) {
+        std::move(sourceBegin, sourceBegin + moved, m_rowDirty.begin() + destination);
+    } else {
+        std::move_backward(sourceBegin, sourceBegin + moved, m_rowDirty.begin() + destination + moved);
+    }
+
+    // The inverted cursor cell moved with the pixels; repaint it at both spots.
+    if (m_cursorCell >= 0) {
+        const int cursorRow = m_cursorCell / m_columns;
+        if (cursorRow >= top && cursorRow <= bottom) {
+            markRowDirty(cursorRow);
+            if (cursorRow - lines >= top && cursorRow - lines <= bottom) {
+                markRowDirty(cursorRow - lines);
+            }
+        }
+    }
+}
+
+void CpuRasterizer::invalidate()
+{
+    std::fill(m_rowDirty.begin(), m_rowDirty.end(), true);
+}
+
+QVector<QRect> CpuRasterizer::rasterize()
+{
+    PROFILE_FUNCTION();
+    QVector<int> dirtyRows;
+    QVector<int> changedRows;
+    for (int row = 0; row < m_rows; ++row) {
+        if (m_rowDirty[row]) {
+            dirtyRows.append(row);
+        }
+        if (m_rowDirty[row] || m_rowMoved[row]) {
+            changedRows.append(row);
+        }
+        m_rowDirty[row] = false;
+        m_rowMoved[row] = false;
+    }
+    if (changedRows.isEmpty()) {
+        return {};
+    }
+
+    // The atlas image is only read from here on, so workers can share it.
+    // scanLine() on a non-const QImage may detach, so the pixel pointer is
+    // taken once here and rows are addressed from it.
+    uchar *pixels = m_image.bits();
+    const qsizetype bytesPerLine = m_image.bytesPerLine();
+    const int workers = qBound(1, static_cast<int>(dirtyRows.size() / kMinRowsPerTask), m_pool.maxThreadCount());
+    if (workers == 1) {
+        for (int row : std::as_const(dirtyRows)) {
+            paintRow(row, pixels, bytesPerLine);
+        }
+    } else {
+        const qsizetype chunk = (dirtyRows.size() + workers - 1) / workers;
+        for (qsizetype begin = 0; begin < dirtyRows.size(); begin += chunk) {
+            const qsizetype end = std::min(begin + chunk, dirtyRows.size());
+            m_pool.start([this, &dirtyRows, begin, end, pixels, bytesPerLine]() {
+                PROFILE_ZONE("CpuRasterizer band");
+                for (qsizetype index = begin; index < end; ++index) {
+                    paintRow(dirtyRows[index], pixels, bytesPerLine);
+                }
+            });
+        }
+        m_pool.waitForDone();
+    }
+
+    // Coalesce adjacent rows into bands so callers upload as few rects as possible.
+    const QSize cellSize = m_atlas.cellSize();
+    QVector<QRect> bands;
+    int bandStart = changedRows.first();
+    int previous = bandStart;
+    for (qsizetype index = 1; index <= changedRows.size(); ++index) {
+        if (index < changedRows.size() && changedRows[index] == previous + 1) {
+            previous = changedRows[index];
+            continue;
+        }
+        bands.append(QRect(0, bandStart * cellSize.height(), m_image.width(),
+                           ((previous - bandStart) + 1) * cellSize.height()));
+        if (index < changedRows.size()) {
+            bandStart = previous = changedRows[index];
+        }
+    }
+    return bands;
+}
+
+void CpuRasterizer::markRowDirty(int row)
+{
+    m_rowDirty[row] = true;
+}
+
+void CpuRasterizer::paintRow(int row, uchar *pixels, qsizetype bytesPerLine) const
+{
+    const QSize cellSize = m_atlas.cellSize();
+    const QImage &atlas = m_atlas.image();
+    const CellPaint *cells = m_cells.constData() + (row * m_columns);
+    for (int column = 0; column < m_columns; ++column) {
+        const CellPaint &cell = cells[column];
+        const bool cursor = (row * m_columns) + column == m_cursorCell;
+        const quint32 foreground = cursor ? cell.background : cell.foreground;
+        const quint32 background = cursor ? cell.foreground : cell.background;
+        const bool blank = cell.slot.x == 0 && cell.slot.y == 0;
+        for (int y = 0; y < cellSize.height(); ++y) {
+            uchar *line = pixels + (((row * cellSize.height()) + y) * bytesPerLine);
+            auto *destination = reinterpret_cast<quint32 *>(line) + (column * cellSize.width());
+            if (blank) {
+                std::fill(destination, destination + cellSize.width(), background);
+                continue;
+            }
+            const uchar *coverage = atlas.constScanLine(cell.slot.y + y) + cell.slot.x;
+            blendSpan(destination, coverage, cellSize.width(), foreground, background);
+        }
+    }
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef RENDER_CPU_RASTERIZER_H
+#define RENDER_CPU_RASTERIZER_H
+
+#include "glyph_atlas.h"
+#include "row_shaper.h"
+
+#include <QImage>
+#include <QRect>
+#include <QThreadPool>
+#include <QVector>
+
+namespace terminal
+{
+struct Cell;
+}
+
+namespace render
+{
+
+// Software renderer for hosts without a usable GPU and for offscreen frame
+// dumps. Glyph slots are resolved on the calling thread; dirty rows are then
+// blended from the shared glyph atlas into an RGB32 image in parallel, each
+// worker owning a disjoint band of rows.
+class CpuRasterizer
+{
+public:
+    CpuRasterizer();
+
+    void setFont(const QFont &font, qreal devicePixelRatio, const QStringList &fallbackFamilies = {});
+    void resize(int rows, int columns);
+    void updateRow(int row, const terminal::Cell *cells, int firstColumn = 0, int lastColumn = -1);
+    void setCursor(int row, int column);
+    // Shifts rows top..bottom by lines (positive: up), matching ScreenBuffer.
+    // Moved rows keep their pixels and are only reported, not repainted.
+    void scroll(int top, int bottom, int lines);
+    void invalidate();
+
+    // Fraction of a row the presenter shifts the image up by, for smooth
+    // scrolling; the rasteriser itself only stores it.
+    void setScrollFraction(qreal rows) { m_scrollFraction = rows; }
+    qreal scrollFraction() const { return m_scrollFraction; }
+
+    int rows() const { return m_rows; }
+    int columns() const { return m_columns; }
+    QSize cellSize() const { return m_atlas.cellSize(); }
+    quint32 atlasGeneration() const { return m_atlas.generation(); }
+    const RowShaper &shaper() const { return m_shaper; }
+
+    // Paints every damaged row and returns the changed bands in image pixels.
+    QVector<QRect> rasterize();
+    const QImage &image() const { return m_image; }
+
+private:
+    struct CellPaint
+    {
+        GlyphSlot slot;
+        quint32 foreground;
+        quint32 background;
+    };
+
+    void markRowDirty(int row);
+    void paintRow(int row, uchar *pixels, qsizetype bytesPerLine) const;
+
+    GlyphAtlas m_atlas;
+    RowShaper m_shaper;
+    QImage m_image;
+    QThreadPool m_pool;
+
+    QVector<CellPaint> m_cells;
+    QVector<bool> m_rowDirty;
+    QVector<bool> m_rowMoved;
+    qreal m_devicePixelRatio = 1.0;
+    qreal m_scrollFraction = 0.0;
+    int m_rows = 0;
+    int m_columns = 0;
+    int m_cursorCell = -1;
+};
+
+}
+#endif
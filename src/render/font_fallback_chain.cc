@@ -0,0 +1,102 @@
+#include "font_fallback_chain.h"
+
+#include "glyph_atlas.h"
+
+#include <QFontDatabase>
+
+namespace render
+{
+
+namespace {
+
+constexpr char32_t kBmpEnd = 0x10000;
+// The table stores indexes in a byte next to the unresolved marker.
+constexpr int kMaxFaces = 254;
+
+}
+
+QStringList FontFallbackChain::defaultFallbackFamilies()
+{
+    return {
+        QStringLiteral("Symbols Nerd Font Mono"),
+        QStringLiteral("Noto Sans Symbols 2"),
+        QStringLiteral("Noto Sans Mono CJK SC"),
+        QStringLiteral("Noto Sans CJK SC"),
+        QStringLiteral("Noto Color Emoji"),
+    };
+}
+
+void FontFallbackChain::setFonts(const QFont &primary, const QStringList &fallbackFamilies)
+{
+    m_faces.clear();
+    m_bmpIndex.clear();
+    m_astralIndex.clear();
+
+    Face primaryFace;
+    primaryFace.font = primary;
+    m_faces.append(primaryFace);
+
+    const QStringList families = fallbackFamilies.isEmpty() ? defaultFallbackFamilies() : fallbackFamilies;
+    for (const QString &family : families) {
+        const QString trimmed = family.trimmed();
+        if (trimmed.isEmpty() || m_faces.size() >= kMaxFaces || !QFontDatabase::hasFamily(trimmed)) {
+            continue;
+        }
+        Face face;
+        face.font = primary;
+        face.font.setFamilies({trimmed});
+        m_faces.append(face);
+    }
+}
+
+int FontFallbackChain::fontIndex(char32_t codepoint)
+{
+    if (codepoint < 0x80 || m_faces.size() <= 1) {
+        return 0;
+    }
+
+    if (codepoint < kBmpEnd) {
+        if (m_bmpIndex.empty()) {
+            m_bmpIndex.assign(kBmpEnd, 0);
+        }
+        quint8 &entry = m_bmpIndex[codepoint];
+        if (entry == 0) {
+            entry = static_cast<quint8>(resolve(codepoint) + 1);
+        }
+        return entry - 1;
+    }
+
+    const auto it = m_astralIndex.constFind(codepoint);
+    if (it != m_astralIndex.constEnd()) {
+        return it.value();
+    }
+    const int index = resolve(codepoint);
+    m_astralIndex.insert(codepoint, static_cast<quint8>(index));
+    return index;
+}
+
+const QRawFont &FontFallbackChain::rawFont(int index, quint8 style)
+{
+    Face &face = m_faces[index];
+    const int variant = style & (GlyphBold | GlyphItalic);
+    if (!face.loaded[variant]) {
+        QFont font = face.font;
+        font.setBold((variant & GlyphBold) != 0);
+        font.setItalic((variant & GlyphItalic) != 0);
+        face.raw[variant] = QRawFont::fromFont(font);
+        face.loaded[variant] = true;
+    }
+    return face.raw[variant];
+}
+
+int FontFallbackChain::resolve(char32_t codepoint)
+{
+    for (int index = 0; index < m_faces.size(); ++index) {
+        if (rawFont(index, GlyphRegular).supportsCharacter(codepoint)) {
+            return index;
+        }
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef RENDER_FONT_FALLBACK_CHAIN_H
+#define RENDER_FONT_FALLBACK_CHAIN_H
+
+#include <QFont>
+#include <QHash>
+#include <QRawFont>
+#include <QStringList>
+#include <QVector>
+
+#include <vector>
+
+namespace render
+{
+
+// Ordered list of faces consulted for codepoints the primary font lacks:
+// symbols, CJK and emoji by default. Which face draws a codepoint is decided
+// once and kept in a flat table for the BMP (a hash above it), so rendering
+// never goes back to the font database. Fallback faces are only opened when
+// a codepoint first misses every face before them.
+class FontFallbackChain
+{
+public:
+    static QStringList defaultFallbackFamilies();
+
+    // An empty list selects defaultFallbackFamilies(); families that are not
+    // installed are skipped.
+    void setFonts(const QFont &primary, const QStringList &fallbackFamilies);
+
+    // Index of the first face covering the codepoint, 0 (the primary) if
+    // none does, so the missing-glyph box comes from the terminal font.
+    int fontIndex(char32_t codepoint);
+
+    // Face at index with the bold and italic bits of a GlyphStyle applied.
+    const QRawFont &rawFont(int index, quint8 style);
+
+private:
+    struct Face
+    {
+        QFont font;
+        QRawFont raw[4];
+        bool loaded[4] = {false, false, false, false};
+    };
+
+    int resolve(char32_t codepoint);
+
+    QVector<Face> m_faces;
+    // Face index + 1 per BMP codepoint, 0 while unresolved; allocated on the
+    // first non-ASCII lookup.
+    std::vector<quint8> m_bmpIndex;
+    QHash<char32_t, quint8> m_astralIndex;
+};
+
+}
+#endif
@@ -0,0 +1,148 @@
+#include "glyph_atlas.h"
+
+#include "char_width.h"
+#include "metrics.h"
+#include "profiling.h"
+
+#include <QFontMetricsF>
+#include <QGlyphRun>
+#include <QPainter>
+#include <QtMath>
+
+#include <cstring>
+
+namespace render
+{
+
+namespace {
+
+// Slot 0 stays empty so blank cells never trigger a lookup.
+constexpr int kBlankSlot = 0;
+
+}
+
+GlyphAtlas::GlyphAtlas(int extent)
+    : m_extent(extent)
+{
+}
+
+QSize GlyphAtlas::cellSizeFor(const QFont &font, qreal devicePixelRatio)
+{
+    const QFontMetricsF metrics(font);
+    return QSize(qCeil(metrics.horizontalAdvance(QLatin1Char('M')) * devicePixelRatio),
+                 qCeil(metrics.height() * devicePixelRatio));
+}
+
+void GlyphAtlas::setFont(const QFont &font, qreal devicePixelRatio, const QStringList &fallbackFamilies)
+{
+    if (font == m_font && fallbackFamilies == m_fallbackFamilies && qFuzzyCompare(devicePixelRatio, m_devicePixelRatio)
+        && !m_cellSize.isEmpty()) {
+        return;
+    }
+
+    if (m_image.isNull()) {
+        m_image = QImage(m_extent, m_extent, QImage::Format_Alpha8);
+    }
+    m_font = font;
+    m_fallbackFamilies = fallbackFamilies;
+    m_fallback.setFonts(font, fallbackFamilies);
+    m_devicePixelRatio = devicePixelRatio;
+    m_cellSize = cellSizeFor(font, devicePixelRatio);
+    m_scratch = QImage(m_cellSize.width() * 2, m_cellSize.height(), QImage::Format_ARGB32_Premultiplied);
+    m_scratch.setDevicePixelRatio(devicePixelRatio);
+    reset();
+}
+
+GlyphSlot GlyphAtlas::slot(char32_t codepoint, quint8 style)
+{
+    if (codepoint == U' ' || codepoint == 0 || m_cellSize.isEmpty()) {
+        return {};
+    }
+
+    if ((style & GlyphWideRight) != 0) {
+        GlyphSlot right = slot(codepoint, style & ~GlyphWideRight);
+        if (right.x != 0 || right.y != 0) {
+            right.x = static_cast<quint16>(right.x + m_cellSize.width());
+        }
+        return right;
+    }
+
+    const Key key{codepoint, style};
+    const auto it = m_slots.constFind(key);
+    if (it != m_slots.constEnd()) {
+        return it.value();
+    }
+
+    // Both halves of a wide glyph sit in one atlas row so the right half is
+    // always the next slot over.
+    const int width = terminal::characterWidth(codepoint) == 2 ? 2 : 1;
+    const int slotsPerRow = m_image.width() / m_cellSize.width();
+    const int slotCount = slotsPerRow * (m_image.height() / m_cellSize.height());
+    if (width == 2 && m_nextSlot % slotsPerRow == slotsPerRow - 1) {
+        ++m_nextSlot;
+    }
+    if (m_nextSlot + width > slotCount) {
+        reset();
+    }
+
+    const int index = m_nextSlot;
+    m_nextSlot += width;
+    GlyphSlot glyphSlot;
+    glyphSlot.x = static_cast<quint16>((index % slotsPerRow) * m_cellSize.width());
+    glyphSlot.y = static_cast<quint16>((index / slotsPerRow) * m_cellSize.height());
+    rasterise(glyphSlot, codepoint, style, width);
+    m_slots.insert(key, glyphSlot);
+    return glyphSlot;
+}
+
+QRect GlyphAtlas::takeDirtyRect()
+{
+    const QRect dirty = m_dirtyRect;
+    m_dirtyRect = QRect();
+    return dirty;
+}
+
+void GlyphAtlas::reset()
+{
+    m_slots.clear();
+    m_nextSlot = kBlankSlot + 1;
+    m_image.fill(0);
+    m_dirtyRect = m_image.rect();
+    ++m_generation;
+}
+
+void GlyphAtlas::rasterise(const GlyphSlot &slot, char32_t codepoint, quint8 style, int width)
+{
+    PROFILE_FUNCTION();
+    terminal::metrics().add(terminal::Metrics::GlyphsRasterisedTotal, 1);
+    // Shaping against the resolved raw font keeps QPainter from running its
+    // own per-string fallback lookup.
+    const QRawFont &rawFont = m_fallback.rawFont(m_fallback.fontIndex(codepoint), style);
+    QGlyphRun run;
+    run.setRawFont(rawFont);
+    const QList<quint32> glyphs = rawFont.glyphIndexesForString(QString::fromUcs4(&codepoint, 1));
+    run.setGlyphIndexes(glyphs);
+    run.setPositions(QList<QPointF>(glyphs.size(), QPointF()));
+
+    m_scratch.fill(Qt::transparent);
+    {
+        QPainter painter(&m_scratch);
+        painter.setRenderHint(QPainter::TextAntialiasing, true);
+        painter.setPen(Qt::white);
+        // Every face shares the primary baseline so fallback glyphs line up.
+        painter.drawGlyphRun(QPointF(0, QFontMetricsF(m_font).ascent()), run);
+    }
+
+    // Keep only coverage; colours are applied per cell at draw time.
+    const int pixelWidth = m_cellSize.width() * width;
+    for (int y = 0; y < m_cellSize.height(); ++y) {
+        const auto *source = reinterpret_cast<const QRgb *>(m_scratch.constScanLine(y));
+        uchar *destination = m_image.scanLine(slot.y + y) + slot.x;
+        for (int x = 0; x < pixelWidth; ++x) {
+            destination[x] = static_cast<uchar>(qAlpha(source[x]));
+        }
+    }
+    m_dirtyRect |= QRect(QPoint(slot.x, slot.y), QSize(pixelWidth, m_cellSize.height()));
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef RENDER_GLYPH_ATLAS_H
+#define RENDER_GLYPH_ATLAS_H
+
+#include "font_fallback_chain.h"
+
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+
+namespace render
+{
+
+enum GlyphStyle : quint8 {
+    GlyphRegular = 0,
+    GlyphBold = 1 << 0,
+    GlyphItalic = 1 << 1,
+    // Right half of a double-width glyph, drawn in its continuation cell.
+    GlyphWideRight = 1 << 2,
+};
+
+// Top-left corner of a cell-sized slot in the atlas image, in pixels.
+struct GlyphSlot
+{
+    quint16 x = 0;
+    quint16 y = 0;
+};
+
+// Single-channel glyph cache laid out as a grid of cell-sized slots. Glyphs
+// are rasterised once per (codepoint, style) for the current font; changing
+// the font or running out of slots starts a new generation. Codepoints the
+// primary font lacks are drawn from its FontFallbackChain, and double-width
+// glyphs take two neighbouring slots on the same atlas row.
+class GlyphAtlas
+{
+public:
+    explicit GlyphAtlas(int extent = 2048);
+
+    static QSize cellSizeFor(const QFont &font, qreal devicePixelRatio);
+
+    void setFont(const QFont &font, qreal devicePixelRatio, const QStringList &fallbackFamilies = {});
+
+    QSize cellSize() const { return m_cellSize; }
+    const QImage &image() const { return m_image; }
+    quint32 generation() const { return m_generation; }
+
+    GlyphSlot slot(char32_t codepoint, quint8 style);
+
+    // Region rasterised since the last call, for partial texture uploads.
+    QRect takeDirtyRect();
+
+private:
+    struct Key
+    {
+        char32_t codepoint;
+        quint8 style;
+
+        bool operator==(const Key &other) const
+        {
+            return codepoint == other.codepoint && style == other.style;
+        }
+    };
+    friend size_t qHash(const Key &key, size_t seed = 0)
+    {
+        return qHashMulti(seed, key.codepoint, key.style);
+    }
+
+    void reset();
+    void rasterise(const GlyphSlot &slot, char32_t codepoint, quint8 style, int width);
+
+    // Allocated by the first setFont(), so an unused atlas costs nothing.
+    int m_extent;
+    QImage m_image;
+    QImage m_scratch;
+    QFont m_font;
+    QStringList m_fallbackFamilies;
+    FontFallbackChain m_fallback;
+    qreal m_devicePixelRatio = 1.0;
+    QSize m_cellSize;
+    QHash<Key, GlyphSlot> m_slots;
+    int m_nextSlot = 0;
+    QRect m_dirtyRect;
+    quint32 m_generation = 0;
+};
+
+}
+#endif
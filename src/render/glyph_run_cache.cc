@@ -0,0 +1,44 @@
+#include "glyph_run_cache.h"
+
+#include "metrics.h"
+
+namespace render
+{
+
+GlyphRunCache::GlyphRunCache(qsizetype maxBytes)
+    : m_entries(maxBytes)
+{
+}
+
+QVector<GlyphSlot> GlyphRunCache::shape(const QVector<quint32> &packedRow, GlyphAtlas &atlas)
+{
+    if (atlas.generation() != m_generation) {
+        m_entries.clear();
+        m_generation = atlas.generation();
+    }
+
+    const size_t key = qHashBits(packedRow.constData(), sizeof(quint32) * static_cast<size_t>(packedRow.size()));
+    if (const Entry *entry = m_entries.object(key); entry && entry->packedRow == packedRow) {
+        ++m_hits;
+        terminal::metrics().add(terminal::Metrics::GlyphRunHitsTotal, 1);
+        return entry->slots;
+    }
+
+    ++m_misses;
+    terminal::metrics().add(terminal::Metrics::GlyphRunMissesTotal, 1);
+    terminal::metrics().add(terminal::Metrics::GlyphLookupsTotal, packedRow.size());
+    QVector<GlyphSlot> slots;
+    slots.reserve(packedRow.size());
+    for (const quint32 packed : packedRow) {
+        slots.append(atlas.slot(packedCodepoint(packed), packedStyle(packed)));
+    }
+
+    // A full atlas mid-row invalidates the slots resolved before the reset.
+    if (atlas.generation() == m_generation) {
+        const qsizetype cost = (sizeof(quint32) + sizeof(GlyphSlot)) * packedRow.size();
+        m_entries.insert(key, new Entry{packedRow, slots}, cost);
+    }
+    return slots;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef RENDER_GLYPH_RUN_CACHE_H
+#define RENDER_GLYPH_RUN_CACHE_H
+
+#include "glyph_atlas.h"
+
+#include <QCache>
+#include <QVector>
+
+namespace render
+{
+
+// Packs a cell for run lookup; codepoints need 21 bits, styles sit above them.
+inline quint32 packGlyphKey(char32_t codepoint, quint8 style)
+{
+    return static_cast<quint32>(codepoint) | (static_cast<quint32>(style) << 24);
+}
+
+inline char32_t packedCodepoint(quint32 packed)
+{
+    return packed & 0x00FFFFFF;
+}
+
+inline quint8 packedStyle(quint32 packed)
+{
+    return static_cast<quint8>(packed >> 24);
+}
+
+// LRU cache of shaped rows: every cell of a row resolved to its atlas slot,
+// keyed by a hash of the row's packed codepoints and styles. Rows that repeat
+// or reappear (full repaints, screen switches, history) skip the per-cell atlas
+// lookups entirely. Entries are tied to one atlas generation.
+class GlyphRunCache
+{
+public:
+    explicit GlyphRunCache(qsizetype maxBytes = 4 * 1024 * 1024);
+
+    QVector<GlyphSlot> shape(const QVector<quint32> &packedRow, GlyphAtlas &atlas);
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+
+private:
+    struct Entry
+    {
+        QVector<quint32> packedRow;
+        QVector<GlyphSlot> slots;
+    };
+
+    QCache<size_t, Entry> m_entries;
+    quint32 m_generation = 0;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+}
+#endif
@@ -0,0 +1,55 @@
+#include "row_shaper.h"
+
+#include "char_width.h"
+#include "metrics.h"
+#include "screen_buffer.h"
+
+namespace render
+{
+
+quint8 glyphStyleFor(const terminal::CellAttributes &attributes)
+{
+    quint8 style = GlyphRegular;
+    if (attributes.bold) {
+        style |= GlyphBold;
+    }
+    if (attributes.italic) {
+        style |= GlyphItalic;
+    }
+    return style;
+}
+
+QVector<GlyphSlot> RowShaper::shape(const terminal::Cell *cells, int firstColumn, int lastColumn, int columns,
+                                    GlyphAtlas &atlas)
+{
+    m_packedRow.resize((lastColumn - firstColumn) + 1);
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+        const terminal::CellAttributes &attributes = cells[column].attributes;
+        char32_t codepoint = attributes.invisible ? U' ' : cells[column].codepoint;
+        quint8 style = glyphStyleFor(attributes);
+        if (codepoint == terminal::kWideCharContinuation && column > 0) {
+            // The right half of the wide glyph in the cell before; a stray
+            // continuation left by a partial overwrite stays blank.
+            const terminal::Cell &previous = cells[column - 1];
+            if (!previous.attributes.invisible && terminal::characterWidth(previous.codepoint) == 2) {
+                codepoint = previous.codepoint;
+                style = glyphStyleFor(previous.attributes) | GlyphWideRight;
+            }
+        }
+        m_packedRow[column - firstColumn] = packGlyphKey(codepoint, style);
+    }
+
+    if (firstColumn == 0 && lastColumn == columns - 1) {
+        return m_runCache.shape(m_packedRow, atlas);
+    }
+
+    terminal::metrics().add(terminal::Metrics::GlyphLookupsTotal, m_packedRow.size());
+    QVector<GlyphSlot> slots;
+    slots.reserve(m_packedRow.size());
+    for (const quint32 packed : std::as_const(m_packedRow)) {
+        slots.append(atlas.slot(packedCodepoint(packed), packedStyle(packed)));
+    }
+    return slots;
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef RENDER_ROW_SHAPER_H
+#define RENDER_ROW_SHAPER_H
+
+#include "glyph_atlas.h"
+#include "glyph_run_cache.h"
+
+#include <QVector>
+
+namespace terminal
+{
+struct Cell;
+struct CellAttributes;
+}
+
+namespace render
+{
+
+quint8 glyphStyleFor(const terminal::CellAttributes &attributes);
+
+// Resolves screen cells to atlas slots for the renderers. Whole rows go through
+// the run cache; short spans (typing, cursor updates) are cheaper to resolve
+// cell by cell than to hash.
+class RowShaper
+{
+public:
+    QVector<GlyphSlot> shape(const terminal::Cell *cells, int firstColumn, int lastColumn, int columns,
+                             GlyphAtlas &atlas);
+
+    const GlyphRunCache &runCache() const { return m_runCache; }
+
+private:
+    GlyphRunCache m_runCache;
+    QVector<quint32> m_packedRow;
+};
+
+}
+#endif
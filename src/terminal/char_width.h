@@ -0,0 +1,14 @@
+#ifndef TERMINAL_CHAR_WIDTH_H
+#define TERMINAL_CHAR_WIDTH_H
+
+namespace terminal
+{
+
+// Number of cells a codepoint occupies: 0 for combining and zero-width
+// characters, 2 for East Asian wide and emoji presentation characters, 1
+// otherwise. Ambiguous-width characters count as narrow, as in xterm's
+// default. BMP results are cached in a flat table filled on first use.
+int characterWidth(char32_t codepoint);
+
+}
+#endif
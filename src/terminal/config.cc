@@ -0,0 +1,290 @@
+#include "config.h"
+
+#include "toml_parser.h"
+
+#include <QVariant>
+
+#include <algorithm>
+
+namespace terminal
+{
+
+namespace {
+
+enum class FieldType {
+    String,
+    Integer,
+    Number,
+    // An array of strings, or one comma-separated string.
+    StringList,
+    // An array of [[triggers]] tables.
+    Triggers,
+};
+
+struct ConfigField
+{
+    const char *key;
+    FieldType type;
+    // Inclusive range for Integer and Number fields.
+    double minimum;
+    double maximum;
+    void (*assign)(Config &config, const QVariant &value);
+    QVariant (*read)(const Config &config);
+};
+
+// The schema: one entry per key, in the order they are documented.
+const ConfigField kFields[] = {
+    {"shell.command", FieldType::String, 0, 0,
+     [](Config &config, const QVariant &value) { config.shellCommand = value.toString(); },
+     [](const Config &config) -> QVariant { return config.shellCommand; }},
+    {"emulation.engine", FieldType::String, 0, 0,
+     [](Config &config, const QVariant &value) { config.emulationEngine = value.toString(); },
+     [](const Config &config) -> QVariant { return config.emulationEngine; }},
+    {"font.family", FieldType::String, 0, 0,
+     [](Config &config, const QVariant &value) { config.fontFamily = value.toString(); },
+     [](const Config &config) -> QVariant { return config.fontFamily; }},
+    {"font.size", FieldType::Number, 4, 200,
+     [](Config &config, const QVariant &value) { config.fontSize = value.toDouble(); },
+     [](const Config &config) -> QVariant { return config.fontSize; }},
+    {"font.fallback", FieldType::StringList, 0, 0,
+     [](Config &config, const QVariant &value) { config.fontFallback = value.toStringList(); },
+     [](const Config &config) -> QVariant { return config.fontFallback; }},
+    {"scrollback.lines", FieldType::Integer, 0, 10000000,
+     [](Config &config, const QVariant &value) { config.scrollbackLines = value.toInt(); },
+     [](const Config &config) -> QVariant { return config.scrollbackLines; }},
+    {"metrics.file", FieldType::String, 0, 0,
+     [](Config &config, const QVariant &value) { config.metricsFile = value.toString(); },
+     [](const Config &config) -> QVariant { return config.metricsFile; }},
+    {"metrics.socket", FieldType::String, 0, 0,
+     [](Config &config, const QVariant &value) { config.metricsSocket = value.toString(); },
+     [](const Config &config) -> QVariant { return config.metricsSocket; }},
+    {"metrics.interval_ms", FieldType::Integer, 100, 3600000,
+     [](Config &config, const QVariant &value) { config.metricsIntervalMs = value.toInt(); },
+     [](const Config &config) -> QVariant { return config.metricsIntervalMs; }},
+    {"triggers", FieldType::Triggers, 0, 0,
+     [](Config &config, const QVariant &value) { config.triggers = value.value<QVector<TriggerConfig>>(); },
+     [](const Config &config) -> QVariant { return QVariant::fromValue(config.triggers); }},
+};
+
+const ConfigField *findField(const QString &key)
+{
+    for (const ConfigField &field : kFields) {
+        if (key == QLatin1String(field.key)) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+const char *typeName(FieldType type)
+{
+    switch (type) {
+    case FieldType::String:
+        return "a string";
+    case FieldType::Integer:
+        return "an integer";
+    case FieldType::Number:
+        return "a number";
+    case FieldType::StringList:
+        return "an array of strings";
+    case FieldType::Triggers:
+        return "an array of tables";
+    }
+    return "";
+}
+
+// One [[triggers]] table, or an error naming the offending key.
+bool parseTrigger(const QVariantMap &table, TriggerConfig &trigger, QString &error)
+{
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it) {
+        const QString &key = it.key();
+        const int type = it.value().typeId();
+        if (key == QLatin1String("case_sensitive")) {
+            if (type != QMetaType::Bool) {
+                error = QStringLiteral("'case_sensitive' must be true or false");
+                return false;
+            }
+            trigger.caseSensitive = it.value().toBool();
+            continue;
+        }
+        if (type != QMetaType::QString) {
+            error = QStringLiteral("'%1' must be a string").arg(key);
+            return false;
+        }
+        const QString text = it.value().toString();
+        if (key == QLatin1String("pattern")) {
+            trigger.pattern = text;
+        } else if (key == QLatin1String("action")) {
+            if (text == QLatin1String("highlight")) {
+                trigger.action = TriggerConfig::Action::Highlight;
+            } else if (text == QLatin1String("notify")) {
+                trigger.action = TriggerConfig::Action::Notify;
+            } else if (text == QLatin1String("command")) {
+                trigger.action = TriggerConfig::Action::Command;
+            } else {
+                error = QStringLiteral("'action' must be \"highlight\", \"notify\" or \"command\"");
+                return false;
+            }
+        } else if (key == QLatin1String("color")) {
+            bool ok = false;
+            const uint color = text.startsWith(QLatin1Char('#')) && text.size() == 7 ? text.mid(1).toUInt(&ok, 16) : 0;
+            if (!ok) {
+                error = QStringLiteral("'color' must look like \"#rrggbb\"");
+                return false;
+            }
+            trigger.color = color;
+        } else if (key == QLatin1String("command")) {
+            trigger.command = text;
+        } else {
+            error = QStringLiteral("unknown key '%1'").arg(key);
+            return false;
+        }
+    }
+    if (trigger.pattern.isEmpty()) {
+        error = QStringLiteral("'pattern' is required");
+        return false;
+    }
+    if (trigger.action == TriggerConfig::Action::Command && trigger.command.isEmpty()) {
+        error = QStringLiteral("'command' is required for the command action");
+        return false;
+    }
+    return true;
+}
+
+// Converts value to the field's type, or returns an invalid QVariant and an
+// error message.
+QVariant coerce(const ConfigField &field, const QVariant &value, QString &error)
+{
+    const int type = value.typeId();
+    QVariant result;
+    switch (field.type) {
+    case FieldType::String:
+        if (type == QMetaType::QString) {
+            result = value;
+        }
+        break;
+    case FieldType::Integer:
+        if (type == QMetaType::LongLong) {
+            result = value;
+        }
+        break;
+    case FieldType::Number:
+        if (type == QMetaType::LongLong || type == QMetaType::Double) {
+            result = value.toDouble();
+        }
+        break;
+    case FieldType::StringList:
+        if (type == QMetaType::QString) {
+            QStringList items = value.toString().split(QLatin1Char(','), Qt::SkipEmptyParts);
+            for (QString &item : items) {
+                item = item.trimmed();
+            }
+            result = items;
+        } else if (type == QMetaType::QVariantList) {
+            QStringList items;
+            for (const QVariant &item : value.toList()) {
+                if (item.typeId() != QMetaType::QString) {
+                    items.clear();
+                    break;
+                }
+                items.append(item.toString());
+            }
+            if (items.size() == value.toList().size()) {
+                result = items;
+            }
+        }
+        break;
+    case FieldType::Triggers:
+        if (type == QMetaType::QVariantList) {
+            QVector<TriggerConfig> triggers;
+            const QVariantList items = value.toList();
+            for (qsizetype index = 0; index < items.size(); ++index) {
+                TriggerConfig trigger;
+                QString problem;
+                if (items[index].typeId() != QMetaType::QVariantMap) {
+                    problem = QStringLiteral("entries must be tables");
+                } else {
+                    parseTrigger(items[index].toMap(), trigger, problem);
+                }
+                if (!problem.isEmpty()) {
+                    error = QStringLiteral("'%1' entry %2: %3").arg(QLatin1String(field.key)).arg(index + 1).arg(problem);
+                    return {};
+                }
+                triggers.append(trigger);
+            }
+            result = QVariant::fromValue(triggers);
+        }
+        break;
+    }
+    if (!result.isValid()) {
+        error = QStringLiteral("'%1' must be %2").arg(QLatin1String(field.key), QLatin1String(typeName(field.type)));
+        return {};
+    }
+    if (field.type == FieldType::Integer || field.type == FieldType::Number) {
+        const double number = result.toDouble();
+        if (number < field.minimum || number > field.maximum) {
+            error = QStringLiteral("'%1' must be between %2 and %3")
+                        .arg(QLatin1String(field.key))
+                        .arg(field.minimum)
+                        .arg(field.maximum);
+            return {};
+        }
+    }
+    return result;
+}
+
+void applyTable(const QVariantMap &table, const QString &prefix, const TomlDocument &document, Config &config,
+                QVector<ConfigDiagnostic> &diagnostics)
+{
+    for (auto it = table.constBegin(); it != table.constEnd(); ++it) {
+        const QString key = prefix.isEmpty() ? it.key() : prefix + QLatin1Char('.') + it.key();
+        const int line = document.keyLines.value(key);
+        if (const ConfigField *field = findField(key)) {
+            QString error;
+            const QVariant value = coerce(*field, it.value(), error);
+            if (value.isValid()) {
+                field->assign(config, value);
+            } else {
+                diagnostics.append({line, error});
+            }
+        } else if (it.value().typeId() == QMetaType::QVariantMap) {
+            applyTable(it.value().toMap(), key, document, config, diagnostics);
+        } else {
+            diagnostics.append({line, QStringLiteral("unknown key '%1'").arg(key)});
+        }
+    }
+}
+
+}
+
+Config configFromToml(const TomlDocument &document, QVector<ConfigDiagnostic> &diagnostics)
+{
+    Config config;
+    applyTable(document.root, QString(), document, config, diagnostics);
+    std::sort(diagnostics.begin(), diagnostics.end(), [](const ConfigDiagnostic &a, const ConfigDiagnostic &b) {
+        return a.line < b.line;
+    });
+    return config;
+}
+
+QStringList changedConfigKeys(const Config &previous, const Config &current)
+{
+    QStringList keys;
+    for (const ConfigField &field : kFields) {
+        if (field.read(previous) != field.read(current)) {
+            keys.append(QLatin1String(field.key));
+        }
+    }
+    return keys;
+}
+
+QStringList configKeys()
+{
+    QStringList keys;
+    for (const ConfigField &field : kFields) {
+        keys.append(QLatin1String(field.key));
+    }
+    return keys;
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef TERMINAL_CONFIG_H
+#define TERMINAL_CONFIG_H
+
+#include <QString>
+#include <QStringList>
+#include <QMetaType>
+#include <QVector>
+
+namespace terminal
+{
+
+struct TomlDocument;
+
+// One [[triggers]] entry: what to do when a completed output line contains
+// pattern. Patterns are plain text, matched ignoring case unless
+// case_sensitive is set.
+struct TriggerConfig
+{
+    enum class Action {
+        // Paints the line's background in color.
+        Highlight,
+        // Shows the line in a notification.
+        Notify,
+        // Runs command through /bin/sh with the line as $1.
+        Command,
+    };
+
+    QString pattern;
+    Action action = Action::Highlight;
+    quint32 color = 0x00603000;
+    QString command;
+    bool caseSensitive = false;
+
+    bool operator==(const TriggerConfig &other) const
+    {
+        return pattern == other.pattern && action == other.action && color == other.color
+            && command == other.command && caseSensitive == other.caseSensitive;
+    }
+};
+
+// The configuration as plain fields, so readers on hot paths never look
+// values up by name. Defaults apply to keys the file leaves out or gets wrong.
+struct Config
+{
+    // File the values came from; empty when running on defaults.
+    QString path;
+
+    QString shellCommand = QStringLiteral("/bin/sh");
+    // See createEmulationEngine().
+    QString emulationEngine = QStringLiteral("native");
+    QString fontFamily = QStringLiteral("monospace");
+    double fontSize = 13.0;
+    QStringList fontFallback;
+    int scrollbackLines = 1000;
+    QString metricsFile;
+    QString metricsSocket;
+    int metricsIntervalMs = 5000;
+    QVector<TriggerConfig> triggers;
+};
+
+struct ConfigDiagnostic
+{
+    int line = 0;
+    QString message;
+};
+
+// Fills config from a parsed document against the schema in config.cc.
+// Unknown keys and values of the wrong type or out of range are reported and
+// leave the default in place.
+Config configFromToml(const TomlDocument &document, QVector<ConfigDiagnostic> &diagnostics);
+
+// Dotted names of the schema keys whose values differ between the two.
+QStringList changedConfigKeys(const Config &previous, const Config &current);
+// Every key in the schema.
+QStringList configKeys();
+
+}
+
+Q_DECLARE_METATYPE(terminal::TriggerConfig)
+
+#endif
@@ -1,5 +1,8 @@
 #include "config_loader.h"
 
+#include "logger.h"
+#include "toml_parser.h"
+
 #include <QCoreApplication>
 #include <QDir>
 #include <QFile>
@@ -8,6 +11,10 @@
 #include <QStringList>
 
 namespace {
+constexpr int kReloadDebounceMs = 150;
+// Safe-save editors briefly leave no file at the path.
+constexpr int kMaxMissingFileRetries = 10;
+
 QString locateConfigFile(const QString &overridePath)
 {
     if (!overridePath.isEmpty()) {
@@ -27,80 +34,70 @@ QString locateConfigFile(const QString &overridePath)
         .filePath("../config/default.toml");
 }
 
-QVariant convertValue(const QString &value)
-{
-    if (value.compare("true", Qt::CaseInsensitive) == 0) {
-        return true;
-    }
-    if (value.compare("false", Qt::CaseInsensitive) == 0) {
-        return false;
-    }
-
-    bool ok = false;
-    int intValue = value.toInt(&ok);
-    if (ok) {
-        return intValue;
-    }
-
-    double doubleValue = value.toDouble(&ok);
-    if (ok) {
-        return doubleValue;
-    }
-
-    QString str = value.trimmed();
-    if (str.startsWith('"') && str.endsWith('"') && str.size() >= 2) {
-        str = str.mid(1, str.size() - 2);
-    }
-    return str;
-}
 } // namespace
 
 ConfigLoader::ConfigLoader(QObject *parent)
     : QObject(parent)
 {
     m_defaultPath = locateConfigFile({});
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(kReloadDebounceMs);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &ConfigLoader::reloadChangedFile);
 }
 
-QVariantMap ConfigLoader::load(const QString &overridePath)
+terminal::Config ConfigLoader::load(const QString &overridePath)
 {
     const QString path = locateConfigFile(overridePath.isEmpty() ? m_defaultPath : overridePath);
 
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return {};
+    // Watched even when it does not parse, so fixing a broken file (possibly
+    // saved by rename, which drops the old watch) still triggers a reload.
+    if (QFile::exists(path)) {
+        watchFile(path);
+        m_activePath = path;
+    }
+
+    terminal::Config config = m_current;
+    if (!readFile(path, config) && m_loaded) {
+        return m_current;
     }
 
-    const QByteArray data = file.readAll();
-    QVariantMap config = parseToml(data);
-    config.insert("_path", path);
-    watchFile(path);
-    m_activePath = path;
-    emit configurationChanged(config);
+    const QStringList changedKeys = m_loaded ? terminal::changedConfigKeys(m_current, config) : terminal::configKeys();
+    m_current = config;
+    m_loaded = true;
+    if (!changedKeys.isEmpty()) {
+        emit configurationChanged(config, changedKeys);
+    }
     return config;
 }
 
-QVariantMap ConfigLoader::parseToml(const QByteArray &data) const
+bool ConfigLoader::readFile(const QString &path, terminal::Config &config) const
 {
-    QVariantMap config;
-
-    const QList<QByteArray> lines = data.split('\n');
-    for (QByteArray lineBytes : lines) {
-        QString line = QString::fromUtf8(lineBytes).trimmed();
-        if (line.isEmpty() || line.startsWith('#')) {
-            continue;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Cannot read configuration {}: {}", path.toStdString(), file.errorString().toStdString());
         }
+        return false;
+    }
 
-        const auto parts = line.split('=');
-        if (parts.size() < 2) {
-            continue;
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    if (!terminal::parseToml(file.readAll(), document, error)) {
+        if (auto logger = terminalLogger()) {
+            logger->error("{}:{}: {}", path.toStdString(), error.line, error.message.toStdString());
         }
-
-        const QString key = parts.first().trimmed();
-        const QString value = parts.mid(1).join("=").trimmed();
-        config.insert(key, convertValue(value));
+        return false;
     }
 
-    return config;
+    QVector<terminal::ConfigDiagnostic> diagnostics;
+    config = terminal::configFromToml(document, diagnostics);
+    config.path = path;
+    if (auto logger = terminalLogger()) {
+        for (const terminal::ConfigDiagnostic &diagnostic : std::as_const(diagnostics)) {
+            logger->warn("{}:{}: {}", path.toStdString(), diagnostic.line, diagnostic.message.toStdString());
+        }
+    }
+    return true;
 }
 
 void ConfigLoader::watchFile(const QString &path)
@@ -109,7 +106,8 @@ void ConfigLoader::watchFile(const QString &path)
         m_watcher = std::make_unique<QFileSystemWatcher>(this);
         connect(m_watcher.get(), &QFileSystemWatcher::fileChanged, this, [this](const QString &changedPath) {
             if (changedPath == m_activePath) {
-                load(m_activePath);
+                m_missingFileRetries = 0;
+                m_reloadTimer.start();
             }
         });
     }
@@ -118,3 +116,16 @@ void ConfigLoader::watchFile(const QString &path)
         m_watcher->addPath(path);
     }
 }
+
+void ConfigLoader::reloadChangedFile()
+{
+    if (!QFile::exists(m_activePath)) {
+        if (m_missingFileRetries++ < kMaxMissingFileRetries) {
+            m_reloadTimer.start();
+        }
+        return;
+    }
+    // Saving by rename replaces the inode and the watcher silently drops it;
+    // load() adds the path back.
+    load(m_activePath);
+}
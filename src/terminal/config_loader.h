@@ -3,7 +3,10 @@
 
 #include <QFileSystemWatcher>
 #include <QObject>
-#include <QVariantMap>
+#include <QStringList>
+#include <QTimer>
+
+#include "config.h"
 
 #include <memory>
 
@@ -14,17 +17,29 @@ class ConfigLoader : public QObject
 public:
     explicit ConfigLoader(QObject *parent = nullptr);
 
-    QVariantMap load(const QString &overridePath = QString());
+    // Problems in the file are logged with their line numbers. A file that is
+    // missing or does not parse keeps the previous configuration (the
+    // defaults on the first load).
+    terminal::Config load(const QString &overridePath = QString());
+    const terminal::Config &current() const { return m_current; }
 
 signals:
-    void configurationChanged(const QVariantMap &config);
+    // Emitted only when something differs from the previous load; changedKeys
+    // lists the schema keys given a new value (every key on the first load).
+    void configurationChanged(const terminal::Config &config, const QStringList &changedKeys);
 
 private:
-    QVariantMap parseToml(const QByteArray &data) const;
+    bool readFile(const QString &path, terminal::Config &config) const;
     void watchFile(const QString &path);
+    void reloadChangedFile();
 
     QString m_defaultPath;
     std::unique_ptr<QFileSystemWatcher> m_watcher;
+    // Editors write a file in several steps; reload once they are done.
+    QTimer m_reloadTimer;
+    int m_missingFileRetries = 0;
     QString m_activePath;
+    terminal::Config m_current;
+    bool m_loaded = false;
 };
 #endif
@@ -0,0 +1,34 @@
+#include "emulation_engine.h"
+
+#include "native_engine.h"
+
+#if defined(KEITH_CONSOLE_LIBVTERM)
+#include "vterm_engine.h"
+#endif
+
+namespace terminal
+{
+
+std::unique_ptr<EmulationEngine> createEmulationEngine(const QString &name, int rows, int columns)
+{
+    if (name == QLatin1String("native")) {
+        return std::make_unique<NativeEngine>(rows, columns);
+    }
+#if defined(KEITH_CONSOLE_LIBVTERM)
+    if (name == QLatin1String("libvterm")) {
+        return std::make_unique<VtermEngine>(rows, columns);
+    }
+#endif
+    return nullptr;
+}
+
+QStringList emulationEngineNames()
+{
+    QStringList names{QStringLiteral("native")};
+#if defined(KEITH_CONSOLE_LIBVTERM)
+    names.append(QStringLiteral("libvterm"));
+#endif
+    return names;
+}
+
+}
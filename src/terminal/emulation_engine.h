@@ -0,0 +1,50 @@
+#ifndef TERMINAL_EMULATION_ENGINE_H
+#define TERMINAL_EMULATION_ENGINE_H
+
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+namespace terminal
+{
+
+class PromptIndex;
+class ScreenBuffer;
+class Scrollback;
+
+// Turns the pty byte stream into screen contents. TerminalBridge and the
+// tools only use this interface, so the in-house parser can be swapped for a
+// reference implementation and the two compared on the same input.
+class EmulationEngine
+{
+public:
+    virtual ~EmulationEngine() = default;
+
+    virtual QString name() const = 0;
+
+    // Rows that scroll off the top of the primary screen are pushed here.
+    virtual void setScrollback(Scrollback *scrollback) = 0;
+    // OSC 133 shell integration marks on the primary screen are recorded here.
+    virtual void setPromptIndex(PromptIndex *index) = 0;
+    virtual void feed(const char *data, int length) = 0;
+    virtual void resize(int rows, int columns) = 0;
+
+    // The renderer reads rows and takes damage from the active screen.
+    virtual ScreenBuffer &activeScreen() = 0;
+    virtual const ScreenBuffer &activeScreen() const = 0;
+    virtual bool alternateScreenActive() const = 0;
+
+    // DEC private modes set by the application.
+    virtual bool applicationCursorKeys() const = 0;
+    virtual bool cursorVisible() const = 0;
+    virtual bool bracketedPaste() const = 0;
+};
+
+// "native" is VtParser and ScreenBuffer; "libvterm" is available when the
+// build found libvterm. Returns nullptr for any other name.
+std::unique_ptr<EmulationEngine> createEmulationEngine(const QString &name, int rows, int columns);
+QStringList emulationEngineNames();
+
+}
+#endif
@@ -0,0 +1,191 @@
+#include "key_encoder.h"
+
+namespace terminal
+{
+
+namespace {
+
+enum class SequenceKind : quint8 {
+    // ESC [ final, or ESC O final in application cursor mode.
+    Cursor,
+    // ESC O final (F1-F4).
+    Ss3,
+    // ESC [ number ~
+    Tilde,
+};
+
+struct KeySequence
+{
+    int key;
+    SequenceKind kind;
+    char final;
+    quint8 number;
+};
+
+constexpr KeySequence kKeySequences[] = {
+    {Qt::Key_Up, SequenceKind::Cursor, 'A', 0},
+    {Qt::Key_Down, SequenceKind::Cursor, 'B', 0},
+    {Qt::Key_Right, SequenceKind::Cursor, 'C', 0},
+    {Qt::Key_Left, SequenceKind::Cursor, 'D', 0},
+    {Qt::Key_Home, SequenceKind::Cursor, 'H', 0},
+    {Qt::Key_End, SequenceKind::Cursor, 'F', 0},
+    {Qt::Key_F1, SequenceKind::Ss3, 'P', 0},
+    {Qt::Key_F2, SequenceKind::Ss3, 'Q', 0},
+    {Qt::Key_F3, SequenceKind::Ss3, 'R', 0},
+    {Qt::Key_F4, SequenceKind::Ss3, 'S', 0},
+    {Qt::Key_Insert, SequenceKind::Tilde, '~', 2},
+    {Qt::Key_Delete, SequenceKind::Tilde, '~', 3},
+    {Qt::Key_PageUp, SequenceKind::Tilde, '~', 5},
+    {Qt::Key_PageDown, SequenceKind::Tilde, '~', 6},
+    {Qt::Key_F5, SequenceKind::Tilde, '~', 15},
+    {Qt::Key_F6, SequenceKind::Tilde, '~', 17},
+    {Qt::Key_F7, SequenceKind::Tilde, '~', 18},
+    {Qt::Key_F8, SequenceKind::Tilde, '~', 19},
+    {Qt::Key_F9, SequenceKind::Tilde, '~', 20},
+    {Qt::Key_F10, SequenceKind::Tilde, '~', 21},
+    {Qt::Key_F11, SequenceKind::Tilde, '~', 23},
+    {Qt::Key_F12, SequenceKind::Tilde, '~', 24},
+};
+
+// Ctrl with punctuation keys, beyond the letters.
+struct ControlKey
+{
+    int key;
+    char byte;
+};
+
+constexpr ControlKey kControlKeys[] = {
+    {Qt::Key_At, 0x00},
+    {Qt::Key_Space, 0x00},
+    {Qt::Key_2, 0x00},
+    {Qt::Key_BracketLeft, 0x1B},
+    {Qt::Key_3, 0x1B},
+    {Qt::Key_Backslash, 0x1C},
+    {Qt::Key_4, 0x1C},
+    {Qt::Key_BracketRight, 0x1D},
+    {Qt::Key_5, 0x1D},
+    {Qt::Key_AsciiCircum, 0x1E},
+    {Qt::Key_6, 0x1E},
+    {Qt::Key_Underscore, 0x1F},
+    {Qt::Key_Minus, 0x1F},
+    {Qt::Key_7, 0x1F},
+    {Qt::Key_Slash, 0x1F},
+    {Qt::Key_Question, 0x7F},
+    {Qt::Key_8, 0x7F},
+};
+
+constexpr char kEscape = 0x1B;
+
+// xterm's modifier parameter: 1 + Shift(1) + Alt(2) + Ctrl(4) + Meta(8).
+int modifierParameter(Qt::KeyboardModifiers modifiers)
+{
+    int parameter = 1;
+    if (modifiers.testFlag(Qt::ShiftModifier)) {
+        parameter += 1;
+    }
+    if (modifiers.testFlag(Qt::AltModifier)) {
+        parameter += 2;
+    }
+    if (modifiers.testFlag(Qt::ControlModifier)) {
+        parameter += 4;
+    }
+    if (modifiers.testFlag(Qt::MetaModifier)) {
+        parameter += 8;
+    }
+    return parameter;
+}
+
+void appendSequence(const KeySequence &sequence, int modifier, bool applicationCursorKeys, QByteArray &output)
+{
+    output.append(kEscape);
+    if (modifier == 1 && (sequence.kind == SequenceKind::Ss3
+                          || (sequence.kind == SequenceKind::Cursor && applicationCursorKeys))) {
+        output.append('O');
+        output.append(sequence.final);
+        return;
+    }
+    output.append('[');
+    if (sequence.kind == SequenceKind::Tilde) {
+        output.append(QByteArray::number(sequence.number));
+    } else if (modifier != 1) {
+        output.append('1');
+    }
+    if (modifier != 1) {
+        output.append(';');
+        output.append(QByteArray::number(modifier));
+    }
+    output.append(sequence.final);
+}
+
+bool controlByte(int key, char *byte)
+{
+    if (key >= Qt::Key_A && key <= Qt::Key_Z) {
+        *byte = static_cast<char>(key - Qt::Key_A + 1);
+        return true;
+    }
+    for (const ControlKey &control : kControlKeys) {
+        if (control.key == key) {
+            *byte = control.byte;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+bool encodeKey(int key, Qt::KeyboardModifiers modifiers, const QString &text, const KeyboardModes &modes,
+               QByteArray &output)
+{
+    const bool alt = modifiers.testFlag(Qt::AltModifier);
+    const bool control = modifiers.testFlag(Qt::ControlModifier);
+
+    for (const KeySequence &sequence : kKeySequences) {
+        if (sequence.key == key) {
+            appendSequence(sequence, modifierParameter(modifiers), modes.applicationCursorKeys, output);
+            return true;
+        }
+    }
+
+    // Everything below is a single byte or text, which Alt prefixes with ESC.
+    const qsizetype prefix = output.size();
+    if (alt) {
+        output.append(kEscape);
+    }
+
+    char byte = 0;
+    switch (key) {
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        output.append('\r');
+        return true;
+    case Qt::Key_Backspace:
+        output.append(control ? '\x08' : '\x7F');
+        return true;
+    case Qt::Key_Tab:
+        output.append('\t');
+        return true;
+    case Qt::Key_Backtab:
+        output.append("\x1B[Z");
+        return true;
+    case Qt::Key_Escape:
+        output.append(kEscape);
+        return true;
+    default:
+        break;
+    }
+
+    if (control && controlByte(key, &byte)) {
+        output.append(byte);
+        return true;
+    }
+    if (!text.isEmpty()) {
+        output.append(text.toUtf8());
+        return true;
+    }
+
+    output.truncate(prefix);
+    return false;
+}
+
+}
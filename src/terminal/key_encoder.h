@@ -0,0 +1,26 @@
+#ifndef TERMINAL_KEY_ENCODER_H
+#define TERMINAL_KEY_ENCODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <Qt>
+
+namespace terminal
+{
+
+// Terminal modes that change what keys send, as set by the application.
+struct KeyboardModes
+{
+    // DECCKM: unmodified cursor keys send SS3 instead of CSI sequences.
+    bool applicationCursorKeys = false;
+};
+
+// Appends the bytes xterm sends for a key press to output: the fixed
+// sequences for cursor, editing and function keys (with the xterm modifier
+// parameter), C0 controls for Ctrl combinations, an ESC prefix for Alt, and
+// the event text as UTF-8 otherwise. Returns false if the key sends nothing.
+bool encodeKey(int key, Qt::KeyboardModifiers modifiers, const QString &text, const KeyboardModes &modes,
+               QByteArray &output);
+
+}
+#endif
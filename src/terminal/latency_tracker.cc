@@ -0,0 +1,195 @@
+#include "latency_tracker.h"
+
+#include "trace.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <chrono>
+
+namespace terminal
+{
+
+namespace {
+
+// Keys that never reach the PTY (modifiers, unbound keys) or output that never
+// comes back (echo off) must not pin samples forever.
+constexpr qint64 kSampleTimeoutNs = 2'000'000'000;
+constexpr size_t kMaxOpenSamples = 256;
+constexpr size_t kDurationsPerStage = 4096;
+
+qint64 percentile(std::vector<qint64> &values, double fraction)
+{
+    const auto index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+    return values[index];
+}
+
+}
+
+qint64 LatencyTracker::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char *LatencyTracker::stageName(Stage stage)
+{
+    switch (stage) {
+    case InputDispatch:
+        return "input dispatch";
+    case PtyWrite:
+        return "pty write";
+    case EchoRead:
+        return "echo read";
+    case Parse:
+        return "parse";
+    case FramePresent:
+        return "frame present";
+    case Total:
+        return "key to photon";
+    case StageCount:
+        break;
+    }
+    return "";
+}
+
+void LatencyTracker::keyPressed(qint64 timestamp)
+{
+    while (!m_open.empty()
+           && (m_open.size() >= kMaxOpenSamples || timestamp - m_open.front().at[Pressed] > kSampleTimeoutNs)) {
+        m_open.pop_front();
+    }
+    // A press that produced no input is superseded by the next one.
+    if (!m_open.empty() && m_open.back().reached == Pressed) {
+        m_open.pop_back();
+    }
+    Sample sample;
+    sample.at[Pressed] = timestamp;
+    m_open.push_back(sample);
+}
+
+void LatencyTracker::inputDispatched()
+{
+    if (!m_open.empty() && m_open.back().reached == Pressed) {
+        m_open.back().at[Dispatched] = now();
+        m_open.back().reached = Dispatched;
+    }
+}
+
+void LatencyTracker::ptyWritten()
+{
+    advance(Dispatched, Written, now());
+}
+
+void LatencyTracker::echoRead(qint64 timestamp)
+{
+    advance(Written, Read, timestamp);
+}
+
+void LatencyTracker::parsed()
+{
+    advance(Read, Parsed, now());
+}
+
+void LatencyTracker::frameTaken()
+{
+    advance(Parsed, InFrame, now());
+}
+
+void LatencyTracker::framePresented()
+{
+    if (m_open.empty()) {
+        return;
+    }
+    const qint64 presented = now();
+    auto it = m_open.begin();
+    while (it != m_open.end()) {
+        if (it->reached != InFrame) {
+            ++it;
+            continue;
+        }
+        const std::array<qint64, CheckpointCount> &at = it->at;
+        record(InputDispatch, at[Dispatched] - at[Pressed]);
+        record(PtyWrite, at[Written] - at[Dispatched]);
+        record(EchoRead, at[Read] - at[Written]);
+        record(Parse, at[Parsed] - at[Read]);
+        record(FramePresent, presented - at[Parsed]);
+        record(Total, presented - at[Pressed]);
+        trace(TraceEvent::KeyLatency, presented - at[Pressed]);
+        ++m_completed;
+        it = m_open.erase(it);
+    }
+}
+
+LatencyTracker::Percentiles LatencyTracker::percentiles(Stage stage) const
+{
+    Percentiles result;
+    std::vector<qint64> values = m_durations[stage];
+    if (values.empty()) {
+        return result;
+    }
+    result.samples = static_cast<int>(values.size());
+    result.p50 = percentile(values, 0.50);
+    result.p99 = percentile(values, 0.99);
+    return result;
+}
+
+QString LatencyTracker::report() const
+{
+    QStringList lines;
+    lines << QStringLiteral("%1 %2 %3 %4")
+                 .arg(QStringLiteral("stage"), -16)
+                 .arg(QStringLiteral("samples"), 8)
+                 .arg(QStringLiteral("p50 ms"), 9)
+                 .arg(QStringLiteral("p99 ms"), 9);
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const Percentiles values = percentiles(static_cast<Stage>(stage));
+        lines << QStringLiteral("%1 %2 %3 %4")
+                     .arg(QString::fromLatin1(stageName(static_cast<Stage>(stage))), -16)
+                     .arg(values.samples, 8)
+                     .arg(values.p50 / 1e6, 9, 'f', 3)
+                     .arg(values.p99 / 1e6, 9, 'f', 3);
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+void LatencyTracker::reset()
+{
+    m_open.clear();
+    for (std::vector<qint64> &durations : m_durations) {
+        durations.clear();
+    }
+    m_nextDuration.fill(0);
+    m_completed = 0;
+}
+
+void LatencyTracker::advance(Checkpoint from, Checkpoint to, qint64 timestamp)
+{
+    for (Sample &sample : m_open) {
+        if (sample.reached == from) {
+            sample.at[to] = timestamp;
+            sample.reached = to;
+        }
+    }
+}
+
+void LatencyTracker::record(Stage stage, qint64 duration)
+{
+    std::vector<qint64> &durations = m_durations[stage];
+    if (durations.size() < kDurationsPerStage) {
+        durations.push_back(duration);
+        return;
+    }
+    durations[m_nextDuration[stage]] = duration;
+    m_nextDuration[stage] = (m_nextDuration[stage] + 1) % kDurationsPerStage;
+}
+
+LatencyTracker &latencyTracker()
+{
+    static LatencyTracker tracker;
+    return tracker;
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef TERMINAL_LATENCY_TRACKER_H
+#define TERMINAL_LATENCY_TRACKER_H
+
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+#include <deque>
+#include <vector>
+
+namespace terminal
+{
+
+// Key-to-photon latency, split into the stages a keystroke passes through.
+// Each key press opens a sample; the pipeline stamps every open sample that
+// has reached the previous stage as it passes a checkpoint, and the first
+// frame presented after the renderer took the resulting damage closes them.
+// The first PTY read after a write is taken to be the echo.
+//
+// Only the GUI thread calls in, except frameTaken(), which the threaded scene
+// graph calls during sync while the GUI thread is blocked.
+class LatencyTracker
+{
+public:
+    enum Stage {
+        InputDispatch, // key event delivered -> bytes handed to the session
+        PtyWrite,      // -> write() to the PTY returned
+        EchoRead,      // -> first read() of output after the write
+        Parse,         // -> emulator finished with that output
+        FramePresent,  // -> frame showing the damage swapped
+        Total,
+        StageCount,
+    };
+
+    struct Percentiles
+    {
+        int samples = 0;
+        qint64 p50 = 0;
+        qint64 p99 = 0;
+    };
+
+    // Monotonic nanoseconds shared by every checkpoint.
+    static qint64 now();
+    static const char *stageName(Stage stage);
+
+    void keyPressed(qint64 timestamp);
+    void inputDispatched();
+    void ptyWritten();
+    void echoRead(qint64 timestamp);
+    void parsed();
+    void frameTaken();
+    void framePresented();
+
+    bool hasOpenSamples() const { return !m_open.empty(); }
+    int completedSamples() const { return m_completed; }
+    Percentiles percentiles(Stage stage) const;
+    // Table of samples, p50 and p99 in milliseconds per stage.
+    QString report() const;
+    void reset();
+
+private:
+    enum Checkpoint {
+        Pressed,
+        Dispatched,
+        Written,
+        Read,
+        Parsed,
+        InFrame,
+        CheckpointCount,
+    };
+
+    struct Sample
+    {
+        std::array<qint64, CheckpointCount> at{};
+        Checkpoint reached = Pressed;
+    };
+
+    void advance(Checkpoint from, Checkpoint to, qint64 timestamp);
+    void record(Stage stage, qint64 duration);
+
+    std::deque<Sample> m_open;
+    // Most recent durations per stage, used as a ring once full.
+    std::array<std::vector<qint64>, StageCount> m_durations;
+    std::array<size_t, StageCount> m_nextDuration{};
+    int m_completed = 0;
+};
+
+LatencyTracker &latencyTracker();
+
+}
+#endif
@@ -2,6 +2,7 @@
 
 #include <QDir>
 
+#include <spdlog/async.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/spdlog.h>
 
@@ -9,6 +10,7 @@ namespace {
 std::shared_ptr<spdlog::logger> g_logger;
 constexpr size_t kMaxLogSize = 5 * 1024 * 1024;
 constexpr size_t kMaxRotations = 3;
+constexpr size_t kQueueSize = 8192;
 }
 
 void initLogger(const QString &logDirectory)
@@ -19,12 +21,26 @@ void initLogger(const QString &logDirectory)
     }
 
     const QString logPath = dir.filePath("keith_console.log");
-    auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(logPath.toStdString(), kMaxLogSize, kMaxRotations);
-    g_logger = std::make_shared<spdlog::logger>("keith_console", sink);
+    spdlog::init_thread_pool(kQueueSize, 1);
+    // Only the single pool thread touches the sink, so it needs no mutex.
+    auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_st>(logPath.toStdString(), kMaxLogSize, kMaxRotations);
+    g_logger = std::make_shared<spdlog::async_logger>("keith_console", sink, spdlog::thread_pool(),
+                                                      spdlog::async_overflow_policy::overrun_oldest);
     g_logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%^%l%$] %v");
+    g_logger->flush_on(spdlog::level::err);
     spdlog::set_default_logger(g_logger);
 }
 
+void shutdownLogger()
+{
+    if (!g_logger) {
+        return;
+    }
+    g_logger->flush();
+    g_logger.reset();
+    spdlog::shutdown();
+}
+
 std::shared_ptr<spdlog::logger> terminalLogger()
 {
     return g_logger;
@@ -6,5 +6,10 @@
 
 #include <spdlog/spdlog.h>
 
+// The logger is asynchronous: callers only format the message and enqueue
+// it, and a background thread owns the file. When the queue is full the
+// oldest pending messages are dropped rather than blocking the caller.
 void initLogger(const QString &logDirectory);
+// Writes out pending messages and stops the background thread.
+void shutdownLogger();
 std::shared_ptr<spdlog::logger> terminalLogger();
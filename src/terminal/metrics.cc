@@ -0,0 +1,59 @@
+#include "metrics.h"
+
+namespace terminal
+{
+
+namespace {
+
+struct MetricInfo
+{
+    const char *name;
+    const char *type;
+    const char *help;
+    // Multiplier from the stored integer to the exported base unit.
+    double scale;
+};
+
+constexpr MetricInfo kMetricInfo[Metrics::Count] = {
+    {"keith_console_frames_total", "counter", "Frames presented.", 1.0},
+    {"keith_console_frame_time_seconds", "gauge", "Time from frame request to swap for the last frame.", 1e-9},
+    {"keith_console_pty_read_bytes_total", "counter", "Bytes read from the PTY.", 1.0},
+    {"keith_console_parsed_bytes_total", "counter", "Bytes run through the escape sequence parser.", 1.0},
+    {"keith_console_parse_seconds_total", "counter", "Time spent parsing PTY output.", 1e-9},
+    {"keith_console_dirty_cells_total", "counter", "Cells handed to a renderer as damage.", 1.0},
+    {"keith_console_scrollback_bytes", "gauge", "Memory held by scrollback pages.", 1.0},
+    {"keith_console_glyph_run_cache_hits_total", "counter", "Rows shaped from the glyph run cache.", 1.0},
+    {"keith_console_glyph_run_cache_misses_total", "counter", "Rows shaped cell by cell.", 1.0},
+    {"keith_console_glyph_lookups_total", "counter", "Cells resolved through the glyph atlas.", 1.0},
+    {"keith_console_glyphs_rasterised_total", "counter", "Glyphs rasterised into the atlas.", 1.0},
+};
+
+}
+
+QByteArray Metrics::prometheusText() const
+{
+    QByteArray text;
+    text.reserve(Count * 160);
+    for (int id = 0; id < Count; ++id) {
+        const MetricInfo &info = kMetricInfo[id];
+        const std::int64_t stored = value(static_cast<Id>(id));
+        text.append("# HELP ").append(info.name).append(' ').append(info.help).append('\n');
+        text.append("# TYPE ").append(info.name).append(' ').append(info.type).append('\n');
+        text.append(info.name).append(' ');
+        if (info.scale == 1.0) {
+            text.append(QByteArray::number(static_cast<qlonglong>(stored)));
+        } else {
+            text.append(QByteArray::number(static_cast<double>(stored) * info.scale, 'g', 9));
+        }
+        text.append('\n');
+    }
+    return text;
+}
+
+Metrics &metrics()
+{
+    static Metrics registry;
+    return registry;
+}
+
+}
@@ -0,0 +1,51 @@
+#ifndef TERMINAL_METRICS_H
+#define TERMINAL_METRICS_H
+
+#include <QByteArray>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace terminal
+{
+
+// Fixed registry of process-wide performance counters. Updates are single
+// relaxed atomic operations, so any thread can record from a hot path without
+// locking; readers (the HUD, the exporter) see each value torn-free but not a
+// consistent snapshot across values, which rates over seconds do not need.
+class Metrics
+{
+public:
+    enum Id {
+        FramesTotal,
+        FrameTimeNanoseconds, // gauge: polish to swap of the last frame
+        PtyBytesTotal,
+        ParsedBytesTotal,
+        ParseNanosecondsTotal,
+        DirtyCellsTotal,
+        ScrollbackBytes, // gauge
+        GlyphRunHitsTotal,
+        GlyphRunMissesTotal,
+        GlyphLookupsTotal,
+        GlyphsRasterisedTotal,
+        Count,
+    };
+
+    void add(Id id, std::int64_t amount) { m_values[id].fetch_add(amount, std::memory_order_relaxed); }
+    void set(Id id, std::int64_t value) { m_values[id].store(value, std::memory_order_relaxed); }
+    std::int64_t value(Id id) const { return m_values[id].load(std::memory_order_relaxed); }
+
+    // Prometheus text exposition format (version 0.0.4).
+    QByteArray prometheusText() const;
+
+private:
+    static_assert(std::atomic<std::int64_t>::is_always_lock_free, "metrics must be lock-free");
+
+    std::array<std::atomic<std::int64_t>, Count> m_values{};
+};
+
+Metrics &metrics();
+
+}
+#endif
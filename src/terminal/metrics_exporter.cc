@@ -0,0 +1,174 @@
+#include "metrics_exporter.h"
+
+#include "logger.h"
+#include "metrics.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+constexpr int kMinimumIntervalMs = 100;
+constexpr int kListenBacklog = 4;
+
+#if defined(MSG_NOSIGNAL)
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+}
+
+MetricsExporter::MetricsExporter(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_fileTimer, &QTimer::timeout, this, &MetricsExporter::writeFile);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    closeSocket();
+}
+
+void MetricsExporter::configure(const QString &filePath, const QString &socketPath, int intervalMs)
+{
+    m_filePath = filePath;
+    if (m_filePath.isEmpty()) {
+        m_fileTimer.stop();
+    } else {
+        m_fileTimer.start(qMax(kMinimumIntervalMs, intervalMs));
+    }
+
+    if (socketPath != m_socketPath) {
+        closeSocket();
+        if (!socketPath.isEmpty()) {
+            listen(socketPath);
+        }
+    }
+}
+
+void MetricsExporter::writeFile()
+{
+    // Replaced atomically so a scraper never reads half a file.
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(terminal::metrics().prometheusText()) < 0 || !file.commit()) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Cannot write metrics to {}: {}", m_filePath.toStdString(), file.errorString().toStdString());
+        }
+        m_fileTimer.stop();
+    }
+}
+
+void MetricsExporter::listen(const QString &socketPath)
+{
+    const QByteArray path = QFile::encodeName(socketPath);
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= static_cast<qsizetype>(sizeof(address.sun_path))) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Metrics socket path is too long: {}", path.toStdString());
+        }
+        return;
+    }
+    memcpy(address.sun_path, path.constData(), static_cast<size_t>(path.size()));
+
+    // A socket left behind by an earlier run would make bind() fail, but
+    // anything else at the path is the user's and stays where it is.
+    struct stat existing {};
+    if (::lstat(path.constData(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            if (auto logger = terminalLogger()) {
+                logger->warn("Not listening for metrics on {}: it exists and is not a socket", path.toStdString());
+            }
+            return;
+        }
+        ::unlink(path.constData());
+    }
+
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listenFd >= 0) {
+        ::fcntl(m_listenFd, F_SETFL, ::fcntl(m_listenFd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(m_listenFd, F_SETFD, FD_CLOEXEC);
+    }
+    struct stat created {};
+    if (m_listenFd < 0 || ::bind(m_listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0
+        || ::lstat(path.constData(), &created) < 0) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Cannot listen for metrics on {}: {}", path.toStdString(), strerror(errno));
+        }
+        closeSocket();
+        return;
+    }
+    // From here closeSocket() removes the socket file, and only this one.
+    m_socketPath = socketPath;
+    m_socketDevice = static_cast<quint64>(created.st_dev);
+    m_socketInode = static_cast<quint64>(created.st_ino);
+    if (::listen(m_listenFd, kListenBacklog) < 0) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Cannot listen for metrics on {}: {}", path.toStdString(), strerror(errno));
+        }
+        closeSocket();
+        return;
+    }
+
+    m_acceptNotifier = std::make_unique<QSocketNotifier>(m_listenFd, QSocketNotifier::Read, this);
+    connect(m_acceptNotifier.get(), &QSocketNotifier::activated, this, &MetricsExporter::handleConnections);
+}
+
+void MetricsExporter::closeSocket()
+{
+    m_acceptNotifier.reset();
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (!m_socketPath.isEmpty()) {
+        // Whatever replaced our socket at the path since is left alone.
+        const QByteArray path = QFile::encodeName(m_socketPath);
+        struct stat current {};
+        if (::lstat(path.constData(), &current) == 0 && S_ISSOCK(current.st_mode)
+            && static_cast<quint64>(current.st_dev) == m_socketDevice
+            && static_cast<quint64>(current.st_ino) == m_socketInode) {
+            ::unlink(path.constData());
+        }
+        m_socketPath.clear();
+    }
+}
+
+void MetricsExporter::handleConnections()
+{
+    for (;;) {
+        const int client = ::accept(m_listenFd, nullptr, nullptr);
+        if (client < 0) {
+            return;
+        }
+        // A scraper that hung up must not raise SIGPIPE, and one that stops
+        // reading must not block the GUI thread; either way it gets what fit.
+        ::fcntl(client, F_SETFL, ::fcntl(client, F_GETFL) | O_NONBLOCK);
+#if defined(SO_NOSIGPIPE)
+        const int noSigPipe = 1;
+        ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+        const QByteArray text = terminal::metrics().prometheusText();
+        qsizetype written = 0;
+        while (written < text.size()) {
+            const ssize_t result = ::send(client, text.constData() + written,
+                                          static_cast<size_t>(text.size() - written), kSendFlags);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                break;
+            }
+            written += result;
+        }
+        ::close(client);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QSocketNotifier>
+#include <QString>
+#include <QTimer>
+
+#include <memory>
+
+// Publishes terminal::metrics() in Prometheus text format, for watching a
+// running terminal without a profiler: rewritten to a file at a fixed
+// interval (node_exporter's textfile collector picks it up), and/or sent to
+// whoever connects to a Unix socket, e.g. `socat - UNIX-CONNECT:path`.
+class MetricsExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsExporter(QObject *parent = nullptr);
+    ~MetricsExporter() override;
+
+    // Empty paths disable the corresponding output.
+    void configure(const QString &filePath, const QString &socketPath, int intervalMs);
+
+private:
+    void writeFile();
+    void listen(const QString &socketPath);
+    void closeSocket();
+    void handleConnections();
+
+    QString m_filePath;
+    QTimer m_fileTimer;
+    // Set while listening; the device and inode identify the socket file
+    // this process created.
+    QString m_socketPath;
+    quint64 m_socketDevice = 0;
+    quint64 m_socketInode = 0;
+    int m_listenFd = -1;
+    std::unique_ptr<QSocketNotifier> m_acceptNotifier;
+};
@@ -0,0 +1,69 @@
+#include "native_engine.h"
+
+namespace terminal
+{
+
+NativeEngine::NativeEngine(int rows, int columns)
+    : m_primary(rows, columns)
+    , m_alternate(rows, columns)
+    , m_parser(m_primary, m_alternate)
+{
+}
+
+QString NativeEngine::name() const
+{
+    return QStringLiteral("native");
+}
+
+void NativeEngine::setScrollback(Scrollback *scrollback)
+{
+    m_primary.setScrollback(scrollback);
+}
+
+void NativeEngine::setPromptIndex(PromptIndex *index)
+{
+    m_parser.setPromptIndex(index);
+}
+
+void NativeEngine::feed(const char *data, int length)
+{
+    m_parser.feed(data, length);
+}
+
+void NativeEngine::resize(int rows, int columns)
+{
+    m_primary.resize(rows, columns);
+    m_alternate.resize(rows, columns);
+}
+
+ScreenBuffer &NativeEngine::activeScreen()
+{
+    return m_parser.activeScreen();
+}
+
+const ScreenBuffer &NativeEngine::activeScreen() const
+{
+    return m_parser.activeScreen();
+}
+
+bool NativeEngine::alternateScreenActive() const
+{
+    return m_parser.alternateScreenActive();
+}
+
+bool NativeEngine::applicationCursorKeys() const
+{
+    return m_parser.applicationCursorKeys();
+}
+
+bool NativeEngine::cursorVisible() const
+{
+    return m_parser.cursorVisible();
+}
+
+bool NativeEngine::bracketedPaste() const
+{
+    return m_parser.bracketedPaste();
+}
+
+}
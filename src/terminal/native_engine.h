@@ -0,0 +1,38 @@
+#ifndef TERMINAL_NATIVE_ENGINE_H
+#define TERMINAL_NATIVE_ENGINE_H
+
+#include "emulation_engine.h"
+#include "screen_buffer.h"
+#include "vt_parser.h"
+
+namespace terminal
+{
+
+// The in-house emulator: VtParser driving a primary and an alternate screen.
+class NativeEngine : public EmulationEngine
+{
+public:
+    NativeEngine(int rows, int columns);
+
+    QString name() const override;
+    void setScrollback(Scrollback *scrollback) override;
+    void setPromptIndex(PromptIndex *index) override;
+    void feed(const char *data, int length) override;
+    void resize(int rows, int columns) override;
+
+    ScreenBuffer &activeScreen() override;
+    const ScreenBuffer &activeScreen() const override;
+    bool alternateScreenActive() const override;
+
+    bool applicationCursorKeys() const override;
+    bool cursorVisible() const override;
+    bool bracketedPaste() const override;
+
+private:
+    ScreenBuffer m_primary;
+    ScreenBuffer m_alternate;
+    VtParser m_parser;
+};
+
+}
+#endif
@@ -0,0 +1,153 @@
+#include "output_triggers.h"
+
+#include "logger.h"
+#include "profiling.h"
+#include "terminal_bridge.h"
+
+#include <QProcess>
+
+#include <algorithm>
+
+namespace {
+constexpr qint64 kActionIntervalMs = 1000;
+}
+
+OutputTriggers::OutputTriggers(const TerminalBridge &terminal, QObject *parent)
+    : QObject(parent)
+    , m_terminal(terminal)
+{
+    m_clock.start();
+}
+
+void OutputTriggers::setTriggers(const QVector<terminal::TriggerConfig> &triggers)
+{
+    m_triggers = triggers;
+    m_matcher.build(triggers);
+    m_lastFired.fill(-kActionIntervalMs, triggers.size());
+    // Highlights from the old triggers no longer apply; lines from here on
+    // are matched against the new ones.
+    if (!m_lineColors.empty()) {
+        m_lineColors.clear();
+        m_damage.all = true;
+        emit highlightsChanged();
+    }
+}
+
+bool OutputTriggers::lineColor(quint64 lineNumber, quint32 *color) const
+{
+    const auto found = m_lineColors.find(lineNumber);
+    if (found == m_lineColors.end()) {
+        return false;
+    }
+    *color = found->second;
+    return true;
+}
+
+void OutputTriggers::handleOutput()
+{
+    // Full-screen applications redraw rows in place; their output is not a
+    // stream of lines.
+    if (m_matcher.isEmpty() || m_terminal.alternateScreenActive()) {
+        return;
+    }
+    PROFILE_FUNCTION();
+    const quint64 begin = m_terminal.historyBegin();
+    const quint64 completeEnd = m_terminal.historyEnd() + static_cast<quint64>(m_terminal.cursorRow());
+    bool changed = false;
+
+    const auto evicted = m_lineColors.lower_bound(begin);
+    if (evicted != m_lineColors.begin()) {
+        m_damage.addLines(m_lineColors.begin()->first, begin);
+        m_lineColors.erase(m_lineColors.begin(), evicted);
+        changed = true;
+    }
+    // The cursor moved back up without scrolling, after a clear for example:
+    // the rows from it down will be written again.
+    if (completeEnd < m_nextLine) {
+        const auto stale = m_lineColors.lower_bound(completeEnd);
+        if (stale != m_lineColors.end()) {
+            m_damage.addLines(stale->first, m_lineColors.rbegin()->first + 1);
+            m_lineColors.erase(stale, m_lineColors.end());
+            changed = true;
+        }
+        m_nextLine = completeEnd;
+    }
+
+    for (quint64 line = std::max(m_nextLine, begin); line < completeEnd; ++line) {
+        if (matchLine(line)) {
+            m_damage.addLines(line, line + 1);
+            changed = true;
+        }
+    }
+    m_nextLine = completeEnd;
+
+    if (changed) {
+        emit highlightsChanged();
+    }
+}
+
+bool OutputTriggers::matchLine(quint64 lineNumber)
+{
+    int length = 0;
+    const terminal::Cell *cells = m_terminal.lineData(lineNumber, &length);
+    m_hits.resize(0);
+    m_matcher.match(cells, length, m_hits);
+    bool highlighted = false;
+    for (const terminal::TriggerHit &hit : std::as_const(m_hits)) {
+        const terminal::TriggerConfig &trigger = m_triggers[hit.trigger];
+        switch (trigger.action) {
+        case terminal::TriggerConfig::Action::Highlight:
+            m_lineColors[lineNumber] = trigger.color;
+            highlighted = true;
+            break;
+        case terminal::TriggerConfig::Action::Notify:
+            if (!rateLimited(hit.trigger)) {
+                emit notify(trigger.pattern, lineText(cells, length));
+            }
+            break;
+        case terminal::TriggerConfig::Action::Command:
+            if (!rateLimited(hit.trigger)) {
+                runCommand(trigger, lineText(cells, length));
+            }
+            break;
+        }
+    }
+    return highlighted;
+}
+
+void OutputTriggers::runCommand(const terminal::TriggerConfig &trigger, const QString &line)
+{
+    // The line is passed as $1 rather than spliced into the command, so
+    // output can never inject shell syntax.
+    const QStringList arguments{QStringLiteral("-c"), trigger.command, QStringLiteral("keith_console"), line};
+    if (!QProcess::startDetached(QStringLiteral("/bin/sh"), arguments)) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Trigger '{}' could not run {}", trigger.pattern.toStdString(), trigger.command.toStdString());
+        }
+    }
+}
+
+bool OutputTriggers::rateLimited(int trigger)
+{
+    const qint64 now = m_clock.elapsed();
+    if (now - m_lastFired[trigger] < kActionIntervalMs) {
+        return true;
+    }
+    m_lastFired[trigger] = now;
+    return false;
+}
+
+QString OutputTriggers::lineText(const terminal::Cell *cells, int length)
+{
+    QString text;
+    for (int column = 0; column < length; ++column) {
+        const char32_t codepoint = cells[column].codepoint;
+        if (codepoint != terminal::kWideCharContinuation) {
+            text.append(QString::fromUcs4(&codepoint, 1));
+        }
+    }
+    while (text.endsWith(QLatin1Char(' '))) {
+        text.chop(1);
+    }
+    return text;
+}
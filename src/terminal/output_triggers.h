@@ -0,0 +1,63 @@
+#ifndef TERMINAL_OUTPUT_TRIGGERS_H
+#define TERMINAL_OUTPUT_TRIGGERS_H
+
+#include "config.h"
+#include "screen_buffer.h"
+#include "trigger_matcher.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <map>
+#include <utility>
+
+class TerminalBridge;
+
+// Runs the configured [[triggers]] over output lines once they are complete,
+// that is once the cursor has moved below them, by absolute line number (see
+// TerminalBridge::lineData()). Each line is matched once, whether it is still
+// on screen or has already scrolled into history. Notifications and commands
+// fire at most once a second per trigger, so a flood of matching lines cannot
+// spawn a process per line.
+class OutputTriggers : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OutputTriggers(const TerminalBridge &terminal, QObject *parent = nullptr);
+
+    void setTriggers(const QVector<terminal::TriggerConfig> &triggers);
+
+    // Background colour a highlight trigger gave a line, if any.
+    bool lineColor(quint64 lineNumber, quint32 *color) const;
+    // Lines whose background changed since the last call, so views redraw
+    // just those; everything after the triggers are replaced.
+    terminal::HighlightDamage takeDamage() { return std::exchange(m_damage, terminal::HighlightDamage()); }
+
+    // Called by the bridge after each chunk of output has been parsed.
+    void handleOutput();
+
+signals:
+    void notify(const QString &pattern, const QString &line);
+    void highlightsChanged();
+
+private:
+    bool matchLine(quint64 lineNumber);
+    void runCommand(const terminal::TriggerConfig &trigger, const QString &line);
+    bool rateLimited(int trigger);
+    static QString lineText(const terminal::Cell *cells, int length);
+
+    const TerminalBridge &m_terminal;
+    QVector<terminal::TriggerConfig> m_triggers;
+    terminal::TriggerMatcher m_matcher;
+    QVector<terminal::TriggerHit> m_hits;
+    // Lines before this one have been matched.
+    quint64 m_nextLine = 0;
+    std::map<quint64, quint32> m_lineColors;
+    terminal::HighlightDamage m_damage;
+    QElapsedTimer m_clock;
+    // Per trigger, m_clock time of its last notification or command.
+    QVector<qint64> m_lastFired;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "profiling.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::int64_t> g_ptyBytes{0};
+std::atomic<std::int64_t> g_dirtyRows{0};
+std::atomic<std::int64_t> g_allocations{0};
+
+void *allocate(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+// Counting replacements for the global allocator; the rest of the sized and
+// aligned forms fall back to these.
+void *operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace terminal
+{
+namespace profiling
+{
+
+void addPtyBytes(std::int64_t bytes)
+{
+    g_ptyBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void addDirtyRows(std::int64_t rows)
+{
+    g_dirtyRows.fetch_add(rows, std::memory_order_relaxed);
+}
+
+void frameFinished()
+{
+    using Clock = std::chrono::steady_clock;
+    static Clock::time_point lastFrame = Clock::now();
+
+    const Clock::time_point now = Clock::now();
+    const double seconds = std::chrono::duration<double>(now - lastFrame).count();
+    lastFrame = now;
+
+    const std::int64_t bytes = g_ptyBytes.exchange(0, std::memory_order_relaxed);
+    TracyPlot("pty bytes/s", seconds > 0.0 ? static_cast<double>(bytes) / seconds : 0.0);
+    TracyPlot("dirty rows/frame", g_dirtyRows.exchange(0, std::memory_order_relaxed));
+    TracyPlot("allocations/frame", g_allocations.exchange(0, std::memory_order_relaxed));
+    FrameMark;
+}
+
+}
+}
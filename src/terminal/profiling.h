@@ -0,0 +1,49 @@
+#ifndef TERMINAL_PROFILING_H
+#define TERMINAL_PROFILING_H
+
+// Tracy instrumentation, compiled in only with -DKEITH_CONSOLE_TRACY=ON.
+// Otherwise every macro expands to nothing, so instrumented code costs the
+// same as uninstrumented code.
+//
+//   PROFILE_FUNCTION()         zone named after the enclosing function
+//   PROFILE_ZONE("name")       zone with a literal name
+//   PROFILE_PTY_BYTES(n)       bytes read from the PTY
+//   PROFILE_DIRTY_ROWS(n)      rows of damage handed to a renderer
+//   PROFILE_FRAME()            frame mark; plots the counters above plus heap
+//                              allocations per frame
+
+#ifdef KEITH_CONSOLE_TRACY
+
+#include <tracy/Tracy.hpp>
+
+#include <cstdint>
+
+namespace terminal
+{
+namespace profiling
+{
+
+void addPtyBytes(std::int64_t bytes);
+void addDirtyRows(std::int64_t rows);
+void frameFinished();
+
+}
+}
+
+#define PROFILE_FUNCTION() ZoneScoped
+#define PROFILE_ZONE(name) ZoneScopedN(name)
+#define PROFILE_PTY_BYTES(bytes) ::terminal::profiling::addPtyBytes(bytes)
+#define PROFILE_DIRTY_ROWS(rows) ::terminal::profiling::addDirtyRows(rows)
+#define PROFILE_FRAME() ::terminal::profiling::frameFinished()
+
+#else
+
+#define PROFILE_FUNCTION()
+#define PROFILE_ZONE(name)
+#define PROFILE_PTY_BYTES(bytes) static_cast<void>(0)
+#define PROFILE_DIRTY_ROWS(rows) static_cast<void>(0)
+#define PROFILE_FRAME() static_cast<void>(0)
+
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#include "prompt_index.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+
+namespace terminal
+{
+
+namespace {
+
+bool promptBefore(const CommandRecord &record, quint64 line)
+{
+    return record.promptLine < line;
+}
+
+bool promptAfter(quint64 line, const CommandRecord &record)
+{
+    return line < record.promptLine;
+}
+
+}
+
+void PromptIndex::mark(ShellMark mark, quint64 line, int exitCode)
+{
+    ++m_revision;
+    if (mark == ShellMark::PromptStart) {
+        while (!m_records.empty() && m_records.back().promptLine >= line) {
+            m_records.pop_back();
+        }
+        CommandRecord record;
+        record.promptLine = line;
+        m_records.push_back(record);
+        return;
+    }
+
+    CommandRecord &record = current(line);
+    switch (mark) {
+    case ShellMark::PromptStart:
+        break;
+    case ShellMark::CommandStart:
+        record.commandLine = line;
+        break;
+    case ShellMark::OutputStart:
+        record.outputLine = line;
+        record.startedAt = QDateTime::currentMSecsSinceEpoch();
+        record.finishedLine = kNoLine;
+        record.exitCode = -1;
+        break;
+    case ShellMark::CommandFinished:
+        // Shells also send D after an empty command line; only a command that
+        // produced an output mark has a result worth keeping.
+        if (record.outputLine != kNoLine && !record.finished()) {
+            record.finishedLine = std::max(line, record.outputLine);
+            record.finishedAt = QDateTime::currentMSecsSinceEpoch();
+            record.exitCode = exitCode;
+        }
+        break;
+    }
+}
+
+void PromptIndex::handleShellMark(const QByteArray &payload, quint64 line)
+{
+    if (payload.isEmpty()) {
+        return;
+    }
+    switch (payload[0]) {
+    case 'A':
+        mark(ShellMark::PromptStart, line);
+        break;
+    case 'B':
+        mark(ShellMark::CommandStart, line);
+        break;
+    case 'C':
+        mark(ShellMark::OutputStart, line);
+        break;
+    case 'D': {
+        const QList<QByteArray> fields = payload.split(';');
+        bool ok = false;
+        const int exitCode = fields.size() > 1 ? fields[1].toInt(&ok) : 0;
+        mark(ShellMark::CommandFinished, line, ok ? exitCode : -1);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+CommandRecord &PromptIndex::current(quint64 line)
+{
+    // Shells that skip the prompt mark still get a record per command.
+    if (m_records.empty() || m_records.back().promptLine > line) {
+        mark(ShellMark::PromptStart, line);
+    }
+    return m_records.back();
+}
+
+void PromptIndex::evictBefore(quint64 line)
+{
+    while (!m_records.empty() && m_records.front().promptLine < line) {
+        m_records.pop_front();
+        ++m_revision;
+    }
+}
+
+int PromptIndex::commandAt(quint64 line) const
+{
+    const auto after = std::upper_bound(m_records.begin(), m_records.end(), line, promptAfter);
+    return static_cast<int>(after - m_records.begin()) - 1;
+}
+
+int PromptIndex::adjacentCommand(quint64 line, bool backwards) const
+{
+    if (backwards) {
+        const auto atOrAfter = std::lower_bound(m_records.begin(), m_records.end(), line, promptBefore);
+        return static_cast<int>(atOrAfter - m_records.begin()) - 1;
+    }
+    const auto after = std::upper_bound(m_records.begin(), m_records.end(), line, promptAfter);
+    return after == m_records.end() ? -1 : static_cast<int>(after - m_records.begin());
+}
+
+bool PromptIndex::outputRange(int index, quint64 limit, quint64 *first, quint64 *end) const
+{
+    if (index < 0 || index >= size() || at(index).outputLine == kNoLine) {
+        return false;
+    }
+    const CommandRecord &record = at(index);
+    quint64 last = limit;
+    if (record.finished()) {
+        last = record.finishedLine;
+    } else if (index + 1 < size()) {
+        last = at(index + 1).promptLine;
+    }
+    *first = record.outputLine;
+    *end = std::max(last, record.outputLine);
+    return true;
+}
+
+}
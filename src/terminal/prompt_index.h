@@ -0,0 +1,81 @@
+#ifndef TERMINAL_PROMPT_INDEX_H
+#define TERMINAL_PROMPT_INDEX_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <deque>
+#include <limits>
+
+namespace terminal
+{
+
+// Shell integration marks (OSC 133 A to D).
+enum class ShellMark {
+    PromptStart,
+    CommandStart,
+    OutputStart,
+    CommandFinished,
+};
+
+constexpr quint64 kNoLine = std::numeric_limits<quint64>::max();
+
+// One prompt and the command run from it, by absolute line number (see
+// TerminalBridge::lineData()). Marks the shell did not send stay kNoLine.
+struct CommandRecord
+{
+    quint64 promptLine = kNoLine;
+    quint64 commandLine = kNoLine;
+    quint64 outputLine = kNoLine;
+    quint64 finishedLine = kNoLine;
+    // Milliseconds since the epoch at the output and finished marks.
+    qint64 startedAt = 0;
+    qint64 finishedAt = 0;
+    // From "133;D;<code>"; -1 when the shell left it out.
+    int exitCode = -1;
+
+    bool finished() const { return finishedLine != kNoLine; }
+};
+
+// Commands of a session in prompt order. Absolute line numbers do not change
+// as rows scroll into history, so the records stay valid without updates and
+// lookups are binary searches however long the session runs. Records whose
+// prompt has left the scrollback are dropped from the front.
+class PromptIndex
+{
+public:
+    // Records a mark for the cursor's line; a prompt above the newest one
+    // (the screen was cleared and redrawn) replaces the records below it.
+    void mark(ShellMark mark, quint64 line, int exitCode = -1);
+    // Records the mark in an OSC 133 payload ("A", "B", "C" or "D;<code>"),
+    // as both emulation engines receive it; anything else is ignored.
+    void handleShellMark(const QByteArray &payload, quint64 line);
+    void evictBefore(quint64 line);
+    void clear()
+    {
+        m_records.clear();
+        ++m_revision;
+    }
+    // Changes whenever a record is added, updated or dropped.
+    quint32 revision() const { return m_revision; }
+
+    int size() const { return static_cast<int>(m_records.size()); }
+    const CommandRecord &at(int index) const { return m_records[static_cast<std::size_t>(index)]; }
+
+    // The command whose prompt is the last at or above line, or -1.
+    int commandAt(quint64 line) const;
+    // The nearest command whose prompt is strictly above (or below) line.
+    int adjacentCommand(quint64 line, bool backwards) const;
+    // Lines [first, end) of a command's output. Output of a command still
+    // running ends at limit, typically the cursor line.
+    bool outputRange(int index, quint64 limit, quint64 *first, quint64 *end) const;
+
+private:
+    CommandRecord &current(quint64 line);
+
+    std::deque<CommandRecord> m_records;
+    quint32 m_revision = 0;
+};
+
+}
+#endif
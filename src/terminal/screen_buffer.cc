@@ -1,37 +1,78 @@
 #include "screen_buffer.h"
 
+#include "char_width.h"
+#include "profiling.h"
+#include "scrollback.h"
+
 #include <QtGlobal>
 
+#include <algorithm>
+
 namespace terminal
 {
 
 namespace {
 
-constexpr char32_t kSpace = U' ';
-
-CellAttributes defaultAttributes()
-{
-    return {};
-}
+constexpr int kTabWidth = 8;
+// Beyond this many distinct scroll regions per frame a full redraw is cheaper.
+constexpr int kMaxScrollEvents = 16;
 
 Cell makeEmptyCell()
 {
-    Cell cell;
-    cell.glyphs.append(kSpace);
-    cell.attributes = defaultAttributes();
-    cell.isDirty = true;
-    return cell;
+    return {};
 }
 
 }
 
 ScreenBuffer::ScreenBuffer(int rows, int columns)
-    : m_rows(rows)
-    , m_columns(columns)
-    , m_cells(rows * columns, makeEmptyCell())
+    : m_rows(qMax(1, rows))
+    , m_columns(qMax(1, columns))
+    , m_cells(m_rows * m_columns, makeEmptyCell())
+    , m_wrapped(m_rows, false)
+    , m_dirtyFirstColumn(m_rows, m_columns)
+    , m_dirtyLastColumn(m_rows, -1)
     , m_marginTop(0)
-    , m_marginBottom(rows - 1)
+    , m_marginBottom(m_rows - 1)
+{
+    markAllDirty();
+}
+
+void ScreenBuffer::resize(int rows, int columns)
 {
+    rows = qMax(1, rows);
+    columns = qMax(1, columns);
+    if (rows == m_rows && columns == m_columns) {
+        return;
+    }
+
+    // Keep the rows nearest the cursor when shrinking, like most emulators do.
+    const int dropped = qMax(0, (m_cursorRow + 1) - rows);
+    if (m_scrollback) {
+        for (int row = 0; row < dropped; ++row) {
+            m_scrollback->push(m_cells.constData() + (row * m_columns), m_columns, m_wrapped[row]);
+        }
+    }
+    QVector<Cell> cells(rows * columns, makeEmptyCell());
+    QVector<bool> wrapped(rows, false);
+    const int copyRows = qMin(rows, m_rows - dropped);
+    const int copyColumns = qMin(columns, m_columns);
+    for (int row = 0; row < copyRows; ++row) {
+        const Cell *source = m_cells.constData() + ((row + dropped) * m_columns);
+        std::copy(source, source + copyColumns, cells.data() + (row * columns));
+        wrapped[row] = m_wrapped[row + dropped];
+    }
+
+    m_rows = rows;
+    m_columns = columns;
+    m_cells = std::move(cells);
+    m_wrapped = std::move(wrapped);
+    m_dirtyFirstColumn = QVector<int>(m_rows, m_columns);
+    m_dirtyLastColumn = QVector<int>(m_rows, -1);
+    m_dirtyRows.clear();
+    m_marginTop = 0;
+    m_marginBottom = m_rows - 1;
+    moveCursor(m_cursorRow - dropped, m_cursorColumn);
+    markAllDirty();
 }
 
 void ScreenBuffer::moveCursor(int row, int column)
@@ -45,6 +86,17 @@ void ScreenBuffer::carriageReturn()
     m_cursorColumn = 0;
 }
 
+void ScreenBuffer::backspace()
+{
+    m_cursorColumn = qMax(0, qMin(m_cursorColumn, m_columns - 1) - 1);
+}
+
+void ScreenBuffer::horizontalTab()
+{
+    const int next = ((m_cursorColumn / kTabWidth) + 1) * kTabWidth;
+    m_cursorColumn = qMin(next, m_columns - 1);
+}
+
 void ScreenBuffer::lineFeed(bool allowScroll)
 {
     if (m_cursorRow == m_marginBottom) {
@@ -56,6 +108,15 @@ void ScreenBuffer::lineFeed(bool allowScroll)
     }
 }
 
+void ScreenBuffer::reverseIndex()
+{
+    if (m_cursorRow == m_marginTop) {
+        scrollDown(1);
+    } else {
+        m_cursorRow = qMax(0, m_cursorRow - 1);
+    }
+}
+
 void ScreenBuffer::setMargin(int top, int bottom)
 {
     m_marginTop = qBound(0, top, m_rows - 1);
@@ -68,6 +129,7 @@ void ScreenBuffer::setMargin(int top, int bottom)
 
 void ScreenBuffer::clear()
 {
+    PROFILE_FUNCTION();
     for (int row = 0; row < m_rows; ++row) {
         clearRow(row);
     }
@@ -80,140 +142,290 @@ void ScreenBuffer::clearRow(int row)
         return;
     }
 
-    for (int column = 0; column < m_columns; ++column) {
-        const int index = (row * m_columns) + column;
-        m_cells[index] = makeEmptyCell();
-    }
+    Cell *begin = m_cells.data() + (row * m_columns);
+    std::fill(begin, begin + m_columns, makeEmptyCell());
+    m_wrapped[row] = false;
     markRowDirty(row);
 }
 
 void ScreenBuffer::clearFromCursor()
 {
-    for (int column = m_cursorColumn; column < m_columns; ++column) {
-        const int index = (m_cursorRow * m_columns) + column;
-        m_cells[index] = makeEmptyCell();
+    PROFILE_FUNCTION();
+    if (m_cursorColumn >= m_columns) {
+        return;
     }
-    markRowDirty(m_cursorRow);
+    Cell *begin = m_cells.data() + (m_cursorRow * m_columns);
+    std::fill(begin + m_cursorColumn, begin + m_columns, makeEmptyCell());
+    markCellsDirty(m_cursorRow, m_cursorColumn, m_columns - 1);
 }
 
 void ScreenBuffer::clearToCursor()
 {
-    for (int column = 0; column <= m_cursorColumn; ++column) {
-        const int index = (m_cursorRow * m_columns) + column;
-        m_cells[index] = makeEmptyCell();
+    PROFILE_FUNCTION();
+    const int lastColumn = qMin(m_cursorColumn, m_columns - 1);
+    Cell *begin = m_cells.data() + (m_cursorRow * m_columns);
+    std::fill(begin, begin + lastColumn + 1, makeEmptyCell());
+    markCellsDirty(m_cursorRow, 0, lastColumn);
+}
+
+void ScreenBuffer::insertCells(int count)
+{
+    const int column = qMin(m_cursorColumn, m_columns - 1);
+    count = qMin(count, m_columns - column);
+    if (count <= 0) {
+        return;
+    }
+    Cell *begin = m_cells.data() + (m_cursorRow * m_columns);
+    std::move_backward(begin + column, begin + m_columns - count, begin + m_columns);
+    std::fill(begin + column, begin + column + count, makeEmptyCell());
+    markCellsDirty(m_cursorRow, column, m_columns - 1);
+}
+
+void ScreenBuffer::deleteCells(int count)
+{
+    const int column = qMin(m_cursorColumn, m_columns - 1);
+    count = qMin(count, m_columns - column);
+    if (count <= 0) {
+        return;
+    }
+    Cell *begin = m_cells.data() + (m_cursorRow * m_columns);
+    std::move(begin + column + count, begin + m_columns, begin + column);
+    std::fill(begin + m_columns - count, begin + m_columns, makeEmptyCell());
+    markCellsDirty(m_cursorRow, column, m_columns - 1);
+}
+
+void ScreenBuffer::eraseCells(int count)
+{
+    const int column = qMin(m_cursorColumn, m_columns - 1);
+    count = qMin(count, m_columns - column);
+    if (count <= 0) {
+        return;
+    }
+    Cell *begin = m_cells.data() + (m_cursorRow * m_columns);
+    std::fill(begin + column, begin + column + count, makeEmptyCell());
+    markCellsDirty(m_cursorRow, column, column + count - 1);
+}
+
+void ScreenBuffer::insertLines(int count)
+{
+    if (count <= 0 || m_cursorRow < m_marginTop || m_cursorRow > m_marginBottom) {
+        return;
+    }
+    shiftRows(m_cursorRow, m_marginBottom, -qMin(count, (m_marginBottom - m_cursorRow) + 1));
+    m_cursorColumn = 0;
+}
+
+void ScreenBuffer::deleteLines(int count)
+{
+    if (count <= 0 || m_cursorRow < m_marginTop || m_cursorRow > m_marginBottom) {
+        return;
     }
-    markRowDirty(m_cursorRow);
+    shiftRows(m_cursorRow, m_marginBottom, qMin(count, (m_marginBottom - m_cursorRow) + 1));
+    m_cursorColumn = 0;
 }
 
 void ScreenBuffer::writeGlyph(char32_t codepoint, const CellAttributes &attributes)
 {
-    const int index = (m_cursorRow * m_columns) + m_cursorColumn;
-    if (index < 0 || index >= m_cells.size()) {
+    // Combining marks are not composed yet; dropping them keeps columns aligned.
+    const int width = characterWidth(codepoint);
+    if (width == 0) {
         return;
     }
 
-    Cell &cell = m_cells[index];
-    cell.glyphs.clear();
-    cell.glyphs.append(codepoint);
+    // Deferred wrap: the cursor may sit one past the last column after a write.
+    wrapCursor();
+    if (width == 2 && m_cursorColumn == m_columns - 1 && m_columns > 1) {
+        if (m_autoWrap) {
+            // A wide character never straddles the margin; it wraps whole.
+            Cell &padding = m_cells[(m_cursorRow * m_columns) + m_cursorColumn];
+            padding = makeEmptyCell();
+            markCellsDirty(m_cursorRow, m_cursorColumn, m_cursorColumn);
+            m_cursorColumn = m_columns;
+            wrapCursor();
+        } else {
+            // Without autowrap it takes the last two cells instead.
+            m_cursorColumn = m_columns - 2;
+        }
+    }
+
+    Cell &cell = m_cells[(m_cursorRow * m_columns) + m_cursorColumn];
+    cell.codepoint = codepoint;
     cell.attributes = attributes;
-    cell.isDirty = true;
-    markRowDirty(m_cursorRow);
+    int lastColumn = m_cursorColumn;
+    if (width == 2 && m_cursorColumn + 1 < m_columns) {
+        Cell &continuation = m_cells[(m_cursorRow * m_columns) + m_cursorColumn + 1];
+        continuation.codepoint = kWideCharContinuation;
+        continuation.attributes = attributes;
+        lastColumn += 1;
+    }
+    markCellsDirty(m_cursorRow, m_cursorColumn, lastColumn);
 
-    m_cursorColumn += 1;
-    wrapCursor();
+    m_cursorColumn = lastColumn + 1;
 }
 
 void ScreenBuffer::writeText(const QString &text, const CellAttributes &attributes)
 {
-    for (const QChar &character : text) {
-        writeGlyph(character.unicode(), attributes);
+    for (const char32_t codepoint : text.toUcs4()) {
+        writeGlyph(codepoint, attributes);
     }
 }
 
+void ScreenBuffer::setCell(int row, int column, const Cell &cell)
+{
+    if (row < 0 || row >= m_rows || column < 0 || column >= m_columns) {
+        return;
+    }
+    m_cells[(row * m_columns) + column] = cell;
+    markCellsDirty(row, column, column);
+}
+
 void ScreenBuffer::scrollUp(int lines)
 {
+    PROFILE_FUNCTION();
     if (lines <= 0) {
         return;
     }
 
     const int regionHeight = (m_marginBottom - m_marginTop) + 1;
     const int clampedLines = qMin(lines, regionHeight);
-    if (clampedLines == regionHeight) {
-        for (int row = m_marginTop; row <= m_marginBottom; ++row) {
-            clearRow(row);
-        }
-        return;
-    }
 
-    for (int row = m_marginTop; row <= m_marginBottom - clampedLines; ++row) {
-        const int sourceRow = row + clampedLines;
-        for (int column = 0; column < m_columns; ++column) {
-            const int destIndex = (row * m_columns) + column;
-            const int srcIndex = (sourceRow * m_columns) + column;
-            m_cells[destIndex] = m_cells[srcIndex];
-            m_cells[destIndex].isDirty = true;
+    if (m_scrollback && m_marginTop == 0) {
+        for (int row = 0; row < clampedLines; ++row) {
+            m_scrollback->push(m_cells.constData() + (row * m_columns), m_columns, m_wrapped[row]);
         }
-        markRowDirty(row);
-    }
-
-    for (int row = m_marginBottom - clampedLines + 1; row <= m_marginBottom; ++row) {
-        clearRow(row);
     }
+    shiftRows(m_marginTop, m_marginBottom, clampedLines);
 }
 
 void ScreenBuffer::scrollDown(int lines)
 {
+    PROFILE_FUNCTION();
     if (lines <= 0) {
         return;
     }
 
     const int regionHeight = (m_marginBottom - m_marginTop) + 1;
-    const int clampedLines = qMin(lines, regionHeight);
-    if (clampedLines == regionHeight) {
-        for (int row = m_marginTop; row <= m_marginBottom; ++row) {
-            clearRow(row);
-        }
-        return;
-    }
+    shiftRows(m_marginTop, m_marginBottom, -qMin(lines, regionHeight));
+}
 
-    for (int row = m_marginBottom; row >= m_marginTop + clampedLines; --row) {
-        const int sourceRow = row - clampedLines;
-        for (int column = 0; column < m_columns; ++column) {
-            const int destIndex = (row * m_columns) + column;
-            const int srcIndex = (sourceRow * m_columns) + column;
-            m_cells[destIndex] = m_cells[srcIndex];
-            m_cells[destIndex].isDirty = true;
+const Cell *ScreenBuffer::rowData(int row) const
+{
+    Q_ASSERT(row >= 0 && row < m_rows);
+    return m_cells.constData() + (row * m_columns);
+}
+
+QString ScreenBuffer::rowText(int row) const
+{
+    const Cell *cells = rowData(row);
+    QString text;
+    text.reserve(m_columns);
+    for (int column = 0; column < m_columns; ++column) {
+        const char32_t codepoint = cells[column].codepoint;
+        if (codepoint == kWideCharContinuation) {
+            continue;
+        }
+        if (QChar::requiresSurrogates(codepoint)) {
+            text.append(QChar::highSurrogate(codepoint));
+            text.append(QChar::lowSurrogate(codepoint));
+        } else {
+            text.append(QChar(static_cast<char16_t>(codepoint)));
         }
-        markRowDirty(row);
     }
+    return text;
+}
 
-    for (int row = m_marginTop; row < m_marginTop + clampedLines; ++row) {
-        clearRow(row);
+QVector<DamageSpan> ScreenBuffer::damage() const
+{
+    QVector<DamageSpan> spans;
+    spans.reserve(m_dirtyRows.size());
+    for (int row : m_dirtyRows) {
+        spans.append({row, m_dirtyFirstColumn[row], m_dirtyLastColumn[row]});
     }
+    return spans;
 }
 
-const QVector<Cell> &ScreenBuffer::rowData(int row) const
+void ScreenBuffer::markAllDirty()
 {
-    Q_ASSERT(row >= 0 && row < m_rows);
-    return *reinterpret_cast<const QVector<Cell> const *>(&m_cells) + (row * m_columns);
+    // Every row gets repainted, so pending pixel copies would be wasted work.
+    m_scrollEvents.clear();
+    for (int row = 0; row < m_rows; ++row) {
+        markRowDirty(row);
+    }
 }
 
 void ScreenBuffer::resetDirty()
 {
     for (int row : std::as_const(m_dirtyRows)) {
-        for (int column = 0; column < m_columns; ++column) {
-            const int index = (row * m_columns) + column;
-            m_cells[index].isDirty = false;
-        }
+        m_dirtyFirstColumn[row] = m_columns;
+        m_dirtyLastColumn[row] = -1;
     }
     m_dirtyRows.clear();
+    m_scrollEvents.clear();
 }
 
 void ScreenBuffer::markRowDirty(int row)
 {
-    if (!m_dirtyRows.contains(row)) {
+    markCellsDirty(row, 0, m_columns - 1);
+}
+
+void ScreenBuffer::markCellsDirty(int row, int firstColumn, int lastColumn)
+{
+    if (m_dirtyLastColumn[row] < 0) {
         m_dirtyRows.append(row);
     }
+    m_dirtyFirstColumn[row] = qMin(m_dirtyFirstColumn[row], firstColumn);
+    m_dirtyLastColumn[row] = qMax(m_dirtyLastColumn[row], lastColumn);
+}
+
+void ScreenBuffer::copyRow(int sourceRow, int destinationRow)
+{
+    const Cell *source = m_cells.constData() + (sourceRow * m_columns);
+    std::copy(source, source + m_columns, m_cells.data() + (destinationRow * m_columns));
+    m_wrapped[destinationRow] = m_wrapped[sourceRow];
+    // Pending damage travels with the row; recordScroll() fixes up m_dirtyRows.
+    m_dirtyFirstColumn[destinationRow] = m_dirtyFirstColumn[sourceRow];
+    m_dirtyLastColumn[destinationRow] = m_dirtyLastColumn[sourceRow];
+}
+
+void ScreenBuffer::shiftRows(int top, int bottom, int lines)
+{
+    if (lines > 0) {
+        for (int row = top; row <= bottom - lines; ++row) {
+            copyRow(row + lines, row);
+        }
+        for (int row = bottom - lines + 1; row <= bottom; ++row) {
+            clearRow(row);
+        }
+    } else {
+        const int count = -lines;
+        for (int row = bottom; row >= top + count; --row) {
+            copyRow(row - count, row);
+        }
+        for (int row = top; row < top + count; ++row) {
+            clearRow(row);
+        }
+    }
+    recordScroll(top, bottom, lines);
+}
+
+void ScreenBuffer::recordScroll(int top, int bottom, int lines)
+{
+    m_dirtyRows.clear();
+    for (int row = 0; row < m_rows; ++row) {
+        if (m_dirtyLastColumn[row] >= 0) {
+            m_dirtyRows.append(row);
+        }
+    }
+
+    if (!m_scrollEvents.isEmpty() && m_scrollEvents.last().top == top && m_scrollEvents.last().bottom == bottom) {
+        m_scrollEvents.last().lines += lines;
+        return;
+    }
+    if (m_scrollEvents.size() >= kMaxScrollEvents) {
+        markAllDirty();
+        return;
+    }
+    m_scrollEvents.append({top, bottom, lines});
 }
 
 void ScreenBuffer::wrapCursor()
@@ -221,7 +433,12 @@ void ScreenBuffer::wrapCursor()
     if (m_cursorColumn < m_columns) {
         return;
     }
+    if (!m_autoWrap) {
+        m_cursorColumn = m_columns - 1;
+        return;
+    }
     m_cursorColumn = 0;
+    m_wrapped[m_cursorRow] = true;
     if (m_cursorRow == m_marginBottom) {
         scrollUp(1);
     } else {
@@ -229,4 +446,39 @@ void ScreenBuffer::wrapCursor()
     }
 }
 
+void HighlightDamage::addLines(quint64 begin, quint64 end)
+{
+    if (all || begin >= end) {
+        return;
+    }
+    // First range that ends at or after begin; it and any that follow up to
+    // end touch the new one and are merged into it.
+    auto first = std::lower_bound(lines.begin(), lines.end(), begin,
+                                  [](const LineRange &range, quint64 line) { return range.end < line; });
+    auto last = first;
+    while (last != lines.end() && last->begin <= end) {
+        begin = std::min(begin, last->begin);
+        end = std::max(end, last->end);
+        ++last;
+    }
+    if (first == last) {
+        lines.insert(first, LineRange{begin, end});
+        return;
+    }
+    *first = LineRange{begin, end};
+    lines.erase(first + 1, last);
+}
+
+void HighlightDamage::add(const HighlightDamage &other)
+{
+    all |= other.all;
+    if (all) {
+        lines.clear();
+        return;
+    }
+    for (const LineRange &range : other.lines) {
+        addLines(range.begin, range.end);
+    }
+}
+
 }
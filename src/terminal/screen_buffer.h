@@ -21,13 +21,61 @@ struct CellAttributes
     bool invisible = false;
 };
 
+// Codepoint of the second cell of a double-width character. Renderers draw
+// the right half of the glyph in the cell before it there.
+constexpr char32_t kWideCharContinuation = 0;
+
 struct Cell
 {
-    QVector<char32_t> glyphs;
+    char32_t codepoint = U' ';
     CellAttributes attributes;
-    bool isDirty = true;
 };
 
+// Inclusive column range of one row that changed since the last resetDirty().
+struct DamageSpan
+{
+    int row;
+    int firstColumn;
+    int lastColumn;
+};
+
+// Rows top..bottom shifted by lines (positive: content moved up). Rows that
+// merely moved are not reported dirty, so renderers can copy their pixels.
+struct ScrollEvent
+{
+    int top;
+    int bottom;
+    int lines;
+};
+
+// Everything a renderer needs to bring the previous frame up to date.
+struct FrameDamage
+{
+    QVector<ScrollEvent> scrolls;
+    QVector<DamageSpan> spans;
+};
+
+// Absolute lines [begin, end) whose highlighting (search matches, line
+// backgrounds) changed since a view last drew them.
+struct LineRange
+{
+    quint64 begin;
+    quint64 end;
+};
+
+// Highlight changes, kept sorted and merged so each line appears once. all is
+// set when any line may have changed, for a new or cleared search say.
+struct HighlightDamage
+{
+    bool all = false;
+    QVector<LineRange> lines;
+
+    void addLines(quint64 begin, quint64 end);
+    void add(const HighlightDamage &other);
+};
+
+class Scrollback;
+
 class ScreenBuffer
 {
 public:
@@ -35,39 +83,93 @@ public:
 
     int rows() const { return m_rows; }
     int columns() const { return m_columns; }
+    int cursorRow() const { return m_cursorRow; }
+    int cursorColumn() const { return m_cursorColumn; }
+    int marginTop() const { return m_marginTop; }
+    int marginBottom() const { return m_marginBottom; }
+
+    void resize(int rows, int columns);
+
+    // Rows scrolled off the top of the full-height region are appended here.
+    void setScrollback(Scrollback *scrollback) { m_scrollback = scrollback; }
+    const Scrollback *scrollback() const { return m_scrollback; }
 
     void moveCursor(int row, int column);
     void carriageReturn();
+    void backspace();
+    void horizontalTab();
     void lineFeed(bool allowScroll = true);
+    // Moves the cursor up a row, scrolling the region down at its top (RI).
+    void reverseIndex();
     void setMargin(int top, int bottom);
+    // DECAWM. When off, output reaching the right margin overwrites the
+    // last column instead of continuing on the next row.
+    bool autoWrap() const { return m_autoWrap; }
+    void setAutoWrap(bool enabled) { m_autoWrap = enabled; }
 
     void clear();
     void clearRow(int row);
     void clearFromCursor();
     void clearToCursor();
+    // Editing within the cursor row (ICH, DCH, ECH); cells pushed past the
+    // right margin are lost and vacated cells are blank.
+    void insertCells(int count);
+    void deleteCells(int count);
+    void eraseCells(int count);
+    // Inserts or deletes rows at the cursor within the scroll region (IL,
+    // DL); does nothing while the cursor is outside it.
+    void insertLines(int count);
+    void deleteLines(int count);
     void writeGlyph(char32_t codepoint, const CellAttributes &attributes);
     void writeText(const QString &text, const CellAttributes &attributes);
+    // Stores a cell as is, for engines that keep their own screen model and
+    // mirror it here.
+    void setCell(int row, int column, const Cell &cell);
 
     void scrollUp(int lines = 1);
     void scrollDown(int lines = 1);
 
+    // Row access for renderers; rowData points at columns() consecutive cells.
+    const Cell *rowData(int row) const;
+    QString rowText(int row) const;
+    // True if the row's text continues on the next row because the cursor
+    // wrapped at the right margin, rather than at a line feed.
+    bool rowWrapped(int row) const { return m_wrapped[row]; }
+
+    // Damage since the last resetDirty(). Scroll events replay in order before
+    // the spans, which are already expressed in post-scroll row positions.
     const QVector<int> &dirtyRows() const { return m_dirtyRows; }
-    const QVector<Cell> &rowData(int row) const;
+    QVector<DamageSpan> damage() const;
+    const QVector<ScrollEvent> &scrollEvents() const { return m_scrollEvents; }
+    void markAllDirty();
     void resetDirty();
 
 private:
     void markRowDirty(int row);
+    void markCellsDirty(int row, int firstColumn, int lastColumn);
+    void copyRow(int sourceRow, int destinationRow);
+    // Moves rows top..bottom up by lines (down if negative), blanking the
+    // vacated rows; lines is within the region's height.
+    void shiftRows(int top, int bottom, int lines);
+    void recordScroll(int top, int bottom, int lines);
     void wrapCursor();
 
     int m_rows;
     int m_columns;
     QVector<Cell> m_cells;
+    QVector<bool> m_wrapped;
     QVector<int> m_dirtyRows;
+    // Per-row dirty column range; firstColumn > lastColumn means clean.
+    QVector<int> m_dirtyFirstColumn;
+    QVector<int> m_dirtyLastColumn;
+    QVector<ScrollEvent> m_scrollEvents;
+    Scrollback *m_scrollback = nullptr;
 
     int m_cursorRow = 0;
     int m_cursorColumn = 0;
     int m_marginTop = 0;
     int m_marginBottom;
+    bool m_autoWrap = true;
 };
 
 }
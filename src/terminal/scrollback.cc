@@ -0,0 +1,114 @@
+#include "scrollback.h"
+
+#include <QtGlobal>
+
+namespace terminal
+{
+
+namespace {
+
+// Lines per page; pages are the unit of allocation and of eviction.
+constexpr int kLinesPerPage = 1024;
+
+bool isBlank(const Cell &cell)
+{
+    const Cell blank;
+    return cell.codepoint == blank.codepoint && cell.attributes.background == blank.attributes.background
+        && !cell.attributes.inverse && !cell.attributes.underline;
+}
+
+template<typename Page>
+qsizetype pageBytes(const Page &page)
+{
+    return static_cast<qsizetype>(page.cells.capacity() * sizeof(Cell) + page.offsets.capacity() * sizeof(int)
+                                  + page.wrapped.capacity() / 8);
+}
+
+}
+
+Scrollback::Scrollback(int maxLines)
+    : m_maxLines(qMax(0, maxLines))
+{
+}
+
+void Scrollback::setMaxLines(int maxLines)
+{
+    m_maxLines = qMax(0, maxLines);
+    trim();
+}
+
+void Scrollback::push(const Cell *cells, int columns, bool wrapped)
+{
+    if (m_maxLines == 0) {
+        ++m_end;
+        clear();
+        return;
+    }
+
+    while (columns > 0 && isBlank(cells[columns - 1])) {
+        --columns;
+    }
+
+    if (m_pages.empty() || static_cast<int>(m_pages.back().offsets.size()) > kLinesPerPage) {
+        Page page;
+        page.offsets.reserve(kLinesPerPage + 1);
+        page.offsets.push_back(0);
+        page.wrapped.reserve(kLinesPerPage);
+        m_pages.push_back(std::move(page));
+    }
+    Page &page = m_pages.back();
+    m_memoryBytes -= pageBytes(page);
+    page.cells.insert(page.cells.end(), cells, cells + columns);
+    page.offsets.push_back(static_cast<int>(page.cells.size()));
+    page.wrapped.push_back(wrapped);
+    m_memoryBytes += pageBytes(page);
+    ++m_end;
+    trim();
+}
+
+void Scrollback::clear()
+{
+    m_pages.clear();
+    m_memoryBytes = 0;
+    m_begin = m_end;
+    m_pagesBegin = m_end;
+}
+
+const Cell *Scrollback::line(quint64 lineNumber, int *length, bool *wrapped) const
+{
+    if (lineNumber < m_begin || lineNumber >= m_end) {
+        *length = 0;
+        if (wrapped) {
+            *wrapped = false;
+        }
+        return nullptr;
+    }
+    const quint64 index = lineNumber - m_pagesBegin;
+    const Page &page = m_pages[static_cast<size_t>(index / kLinesPerPage)];
+    const int offset = static_cast<int>(index % kLinesPerPage);
+    *length = page.offsets[offset + 1] - page.offsets[offset];
+    if (wrapped) {
+        *wrapped = page.wrapped[static_cast<size_t>(offset)];
+    }
+    return page.cells.data() + page.offsets[offset];
+}
+
+void Scrollback::trim()
+{
+    if (m_maxLines == 0) {
+        // No partial page may survive to take lines once the limit is raised.
+        clear();
+        return;
+    }
+    // Lines before m_begin stay in memory until their whole page can go.
+    if (static_cast<quint64>(size()) > static_cast<quint64>(m_maxLines)) {
+        m_begin = m_end - static_cast<quint64>(m_maxLines);
+    }
+    while (!m_pages.empty() && m_pagesBegin + kLinesPerPage <= m_begin) {
+        m_memoryBytes -= pageBytes(m_pages.front());
+        m_pages.pop_front();
+        m_pagesBegin += kLinesPerPage;
+    }
+}
+
+}
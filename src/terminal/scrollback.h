@@ -0,0 +1,63 @@
+#ifndef TERMINAL_SCROLLBACK_H
+#define TERMINAL_SCROLLBACK_H
+
+#include "screen_buffer.h"
+
+#include <deque>
+#include <vector>
+
+namespace terminal
+{
+
+// Lines that scrolled off the top of the primary screen, oldest first. Lines
+// are numbered absolutely from the start of the session, so a position stays
+// valid while new output arrives; the oldest lines are dropped a page at a
+// time once the history exceeds maxLines(). Trailing blanks are not stored.
+class Scrollback
+{
+public:
+    explicit Scrollback(int maxLines);
+
+    int maxLines() const { return m_maxLines; }
+    void setMaxLines(int maxLines);
+
+    // Absolute number of the oldest retained line, and one past the newest;
+    // the first screen row is line end().
+    quint64 begin() const { return m_begin; }
+    quint64 end() const { return m_end; }
+    int size() const { return static_cast<int>(m_end - m_begin); }
+
+    // Heap held by the pages, including lines awaiting eviction. Kept as a
+    // running total, so reading it costs nothing per page.
+    qsizetype memoryBytes() const { return m_memoryBytes; }
+
+    // wrapped: the line continues on the next one (autowrap, not a newline).
+    void push(const Cell *cells, int columns, bool wrapped = false);
+    void clear();
+
+    // Cells of an absolute line in [begin(), end()); length receives the
+    // stored width, which may be shorter than the screen.
+    const Cell *line(quint64 lineNumber, int *length, bool *wrapped = nullptr) const;
+
+private:
+    struct Page
+    {
+        std::vector<Cell> cells;
+        // Start of each line in cells, plus one trailing end offset.
+        std::vector<int> offsets;
+        std::vector<bool> wrapped;
+    };
+
+    void trim();
+
+    std::deque<Page> m_pages;
+    int m_maxLines;
+    // Absolute number of the first line of m_pages.front().
+    quint64 m_pagesBegin = 0;
+    quint64 m_begin = 0;
+    quint64 m_end = 0;
+    qsizetype m_memoryBytes = 0;
+};
+
+}
+#endif
@@ -0,0 +1,215 @@
+#include "scrollback_search.h"
+
+#include "profiling.h"
+#include "terminal_bridge.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+namespace {
+// Time one scan slice may take before yielding to the event loop.
+constexpr qint64 kSliceBudgetNs = 4000000;
+// The clock is only read every this many lines.
+constexpr int kLinesPerClockCheck = 256;
+// The history scan stops once this many matches are known.
+constexpr int kMaxMatches = 100000;
+}
+
+ScrollbackSearch::ScrollbackSearch(const TerminalBridge &terminal, QObject *parent)
+    : QObject(parent)
+    , m_terminal(terminal)
+{
+    m_scanTimer.setInterval(0);
+    connect(&m_scanTimer, &QTimer::timeout, this, &ScrollbackSearch::scanSlice);
+}
+
+bool ScrollbackSearch::start(const QString &pattern, bool caseSensitive, bool regex, QString *error)
+{
+    clear();
+    if (!m_matcher.setPattern(pattern, caseSensitive, regex, error)) {
+        return false;
+    }
+    if (m_matcher.isEmpty()) {
+        return true;
+    }
+    m_active = true;
+    m_scanNext = m_terminal.historyEnd();
+    m_liveFrom = m_terminal.historyEnd();
+    // The screen is what the user is looking at; report it straight away.
+    rescanScreen();
+    m_scanTimer.start();
+    m_damage.all = true;
+    publish();
+    return true;
+}
+
+void ScrollbackSearch::clear()
+{
+    const bool hadMatches = matchCount() > 0 || m_active;
+    m_scanTimer.stop();
+    m_matcher.setPattern(QString(), true, false);
+    m_active = false;
+    m_historyMatches.clear();
+    m_screenMatches.clear();
+    m_historyMatchCount = 0;
+    m_screenMatchCount = 0;
+    if (hadMatches) {
+        m_damage.all = true;
+        publish();
+    }
+}
+
+const QVector<terminal::ColumnSpan> *ScrollbackSearch::matchesOnLine(quint64 lineNumber) const
+{
+    const LineMatches &matches = lineNumber >= m_terminal.historyEnd() ? m_screenMatches : m_historyMatches;
+    const auto found = matches.find(lineNumber);
+    return found == matches.end() ? nullptr : &found->second;
+}
+
+bool ScrollbackSearch::nextMatchLine(quint64 lineNumber, bool backwards, quint64 *found) const
+{
+    if (matchCount() == 0) {
+        return false;
+    }
+    // Screen lines all come after history lines, so the two maps behave as
+    // one ordered sequence.
+    const LineMatches *first = &m_historyMatches;
+    const LineMatches *second = &m_screenMatches;
+    if (backwards) {
+        for (const LineMatches *matches : {second, first}) {
+            const auto after = matches->lower_bound(lineNumber);
+            if (after != matches->begin()) {
+                *found = std::prev(after)->first;
+                return true;
+            }
+        }
+        *found = (m_screenMatches.empty() ? m_historyMatches : m_screenMatches).rbegin()->first;
+        return true;
+    }
+    for (const LineMatches *matches : {first, second}) {
+        const auto after = matches->upper_bound(lineNumber);
+        if (after != matches->end()) {
+            *found = after->first;
+            return true;
+        }
+    }
+    *found = (m_historyMatches.empty() ? m_screenMatches : m_historyMatches).begin()->first;
+    return true;
+}
+
+void ScrollbackSearch::handleOutput()
+{
+    if (!m_active) {
+        return;
+    }
+    PROFILE_FUNCTION();
+    const quint64 begin = m_terminal.historyBegin();
+    const quint64 end = m_terminal.historyEnd();
+    bool changed = false;
+
+    // Evicted history takes its matches with it. While the alternate screen
+    // hides history, begin == end and nothing is evicted.
+    if (begin < end) {
+        if (!m_historyMatches.empty() && m_historyMatches.begin()->first < begin) {
+            m_damage.addLines(m_historyMatches.begin()->first, begin);
+            changed = true;
+        }
+        while (!m_historyMatches.empty() && m_historyMatches.begin()->first < begin) {
+            m_historyMatchCount -= static_cast<int>(m_historyMatches.begin()->second.size());
+            m_historyMatches.erase(m_historyMatches.begin());
+        }
+        m_scanNext = std::max(m_scanNext, begin);
+    }
+
+    // History never changes once written, so lines that scrolled in since the
+    // last chunk are matched once and for all.
+    for (quint64 line = std::max(m_liveFrom, begin); line < end; ++line) {
+        if (scanLine(line, m_historyMatches, m_historyMatchCount)) {
+            m_damage.addLines(line, line + 1);
+            changed = true;
+        }
+    }
+    m_liveFrom = std::max(m_liveFrom, end);
+
+    changed |= rescanScreen();
+    if (changed) {
+        publish();
+    }
+}
+
+void ScrollbackSearch::scanSlice()
+{
+    PROFILE_FUNCTION();
+    QElapsedTimer budget;
+    budget.start();
+    const quint64 begin = m_terminal.historyBegin();
+    const quint64 scannedEnd = m_scanNext;
+    bool changed = false;
+    int lines = 0;
+    while (m_scanNext > begin && m_historyMatchCount < kMaxMatches) {
+        --m_scanNext;
+        changed |= scanLine(m_scanNext, m_historyMatches, m_historyMatchCount);
+        if (++lines % kLinesPerClockCheck == 0 && budget.nsecsElapsed() > kSliceBudgetNs) {
+            break;
+        }
+    }
+    if (changed) {
+        m_damage.addLines(m_scanNext, scannedEnd);
+    }
+    const bool finished = m_scanNext <= begin || m_historyMatchCount >= kMaxMatches;
+    if (finished) {
+        m_scanTimer.stop();
+    }
+    if (changed || finished) {
+        publish();
+    }
+}
+
+bool ScrollbackSearch::scanLine(quint64 lineNumber, LineMatches &matches, int &count)
+{
+    int length = 0;
+    const terminal::Cell *cells = m_terminal.lineData(lineNumber, &length);
+    m_spans.resize(0);
+    m_matcher.match(cells, length, m_spans);
+    if (m_spans.isEmpty()) {
+        return false;
+    }
+    count += static_cast<int>(m_spans.size());
+    matches[lineNumber] = m_spans;
+    return true;
+}
+
+bool ScrollbackSearch::rescanScreen()
+{
+    LineMatches screen;
+    int count = 0;
+    const quint64 end = m_terminal.historyEnd();
+    for (int row = 0; row < m_terminal.rows(); ++row) {
+        scanLine(end + static_cast<quint64>(row), screen, count);
+    }
+    if (screen == m_screenMatches) {
+        return false;
+    }
+    // Only rows whose matches differ need redrawing, including those that
+    // lost theirs.
+    for (const auto &[line, spans] : screen) {
+        const auto before = m_screenMatches.find(line);
+        if (before == m_screenMatches.end() || before->second != spans) {
+            m_damage.addLines(line, line + 1);
+        }
+    }
+    for (const auto &[line, spans] : m_screenMatches) {
+        if (screen.find(line) == screen.end()) {
+            m_damage.addLines(line, line + 1);
+        }
+    }
+    m_screenMatches.swap(screen);
+    m_screenMatchCount = count;
+    return true;
+}
+
+void ScrollbackSearch::publish()
+{
+    emit resultsChanged();
+}
@@ -0,0 +1,78 @@
+#ifndef TERMINAL_SCROLLBACK_SEARCH_H
+#define TERMINAL_SCROLLBACK_SEARCH_H
+
+#include "screen_buffer.h"
+#include "text_matcher.h"
+
+#include <QObject>
+#include <QTimer>
+
+#include <map>
+#include <utility>
+
+class TerminalBridge;
+
+// Find in history and on screen, by absolute line number (see
+// TerminalBridge::lineData()). History is scanned from the newest line back
+// in short slices on the event loop, so matches appear while the scan is
+// still running and a long history never holds up input or frames. Lines
+// that scroll into history later are matched as they arrive and the screen
+// is rescanned after each chunk of output, which keeps highlights live
+// during a flood.
+class ScrollbackSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScrollbackSearch(const TerminalBridge &terminal, QObject *parent = nullptr);
+
+    // An empty pattern clears the search. Returns false, with error set, for
+    // an invalid regular expression.
+    bool start(const QString &pattern, bool caseSensitive, bool regex, QString *error = nullptr);
+    void clear();
+
+    bool isActive() const { return m_active; }
+    // True while older history is still being scanned.
+    bool isScanning() const { return m_scanTimer.isActive(); }
+    int matchCount() const { return m_historyMatchCount + m_screenMatchCount; }
+
+    // Matches on a line, or nullptr; valid until the next output or slice.
+    const QVector<terminal::ColumnSpan> *matchesOnLine(quint64 lineNumber) const;
+    // The nearest line with a match after (or before) lineNumber, wrapping
+    // round at either end; false if there are no matches.
+    bool nextMatchLine(quint64 lineNumber, bool backwards, quint64 *found) const;
+    // Lines whose matches changed since the last call, so views redraw just
+    // those; everything after a new or cleared search.
+    terminal::HighlightDamage takeDamage() { return std::exchange(m_damage, terminal::HighlightDamage()); }
+
+    // Called by the bridge after each chunk of output has been parsed.
+    void handleOutput();
+
+signals:
+    void resultsChanged();
+
+private:
+    using LineMatches = std::map<quint64, QVector<terminal::ColumnSpan>>;
+
+    void scanSlice();
+    bool scanLine(quint64 lineNumber, LineMatches &matches, int &count);
+    bool rescanScreen();
+    void publish();
+
+    const TerminalBridge &m_terminal;
+    terminal::TextMatcher m_matcher;
+    QTimer m_scanTimer;
+    bool m_active = false;
+    // History below this line is still to be scanned, newest first.
+    quint64 m_scanNext = 0;
+    // History from this line on is scanned as output pushes it there.
+    quint64 m_liveFrom = 0;
+    LineMatches m_historyMatches;
+    LineMatches m_screenMatches;
+    int m_historyMatchCount = 0;
+    int m_screenMatchCount = 0;
+    terminal::HighlightDamage m_damage;
+    QVector<terminal::ColumnSpan> m_spans;
+};
+
+#endif
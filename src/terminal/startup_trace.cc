@@ -0,0 +1,72 @@
+#include "startup_trace.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <cstring>
+
+namespace terminal
+{
+
+void StartupTrace::start()
+{
+    QMutexLocker locker(&m_mutex);
+    m_clock.start();
+    m_phases.clear();
+}
+
+void StartupTrace::mark(const char *phase)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_clock.isValid()) {
+        m_clock.start();
+    }
+    for (const Phase &existing : std::as_const(m_phases)) {
+        if (std::strcmp(existing.name, phase) == 0) {
+            return;
+        }
+    }
+    m_phases.append({phase, m_clock.nsecsElapsed()});
+}
+
+bool StartupTrace::has(const char *phase) const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const Phase &existing : m_phases) {
+        if (std::strcmp(existing.name, phase) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 StartupTrace::elapsedMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_clock.isValid() ? m_clock.elapsed() : 0;
+}
+
+QString StartupTrace::report() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList lines;
+    lines << QStringLiteral("%1 %2 %3").arg(QStringLiteral("startup phase"), -28).arg(QStringLiteral("at ms"), 9).arg(
+        QStringLiteral("+ms"), 9);
+    qint64 previous = 0;
+    for (const Phase &phase : m_phases) {
+        lines << QStringLiteral("%1 %2 %3")
+                     .arg(QString::fromLatin1(phase.name), -28)
+                     .arg(phase.nanoseconds / 1e6, 9, 'f', 2)
+                     .arg((phase.nanoseconds - previous) / 1e6, 9, 'f', 2);
+        previous = phase.nanoseconds;
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+StartupTrace &startupTrace()
+{
+    static StartupTrace trace;
+    return trace;
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef TERMINAL_STARTUP_TRACE_H
+#define TERMINAL_STARTUP_TRACE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+namespace terminal
+{
+
+// Named checkpoints on the way from main() to a usable prompt, so cold start
+// can be held to a budget. Recording is always on and costs a clock read;
+// --trace-startup prints report(). Phases may be marked from any thread, and
+// each name is kept only the first time it is marked.
+class StartupTrace
+{
+public:
+    // Called first thing in main(); times are relative to it.
+    void start();
+    void mark(const char *phase);
+
+    bool has(const char *phase) const;
+    qint64 elapsedMs() const;
+    // One line per phase: time since start and since the previous phase.
+    QString report() const;
+
+private:
+    struct Phase
+    {
+        const char *name;
+        qint64 nanoseconds;
+    };
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    QVector<Phase> m_phases;
+};
+
+StartupTrace &startupTrace();
+
+}
+#endif
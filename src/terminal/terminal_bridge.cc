@@ -1,49 +1,348 @@
 #include "terminal_bridge.h"
 
 #include "config_loader.h"
+#include "emulation_engine.h"
+#include "key_encoder.h"
+#include "latency_tracker.h"
+#include "output_triggers.h"
+#include "prompt_index.h"
+#include "screen_buffer.h"
+#include "scrollback.h"
+#include "scrollback_search.h"
+#include "startup_trace.h"
 #include "terminal_session.h"
+#include "text_export.h"
+#include "trace.h"
 #include "logger.h"
+#include "metrics.h"
+#include "metrics_exporter.h"
+#include "profiling.h"
 
 #include <QDebug>
+#include <QClipboard>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QSaveFile>
 #include <QStringList>
 
+#include <algorithm>
+
 namespace {
-constexpr int kMaxBufferSize = 20000;
+constexpr int kDefaultColumns = 80;
+constexpr int kDefaultRows = 24;
+constexpr quint32 kSelectedOutputBackground = 0x00203048;
 }
 
 TerminalBridge::TerminalBridge(QObject *parent)
     : QObject(parent)
+    , m_scrollback(std::make_unique<terminal::Scrollback>(terminal::Config().scrollbackLines))
+    , m_engine(terminal::createEmulationEngine(terminal::Config().emulationEngine, kDefaultRows, kDefaultColumns))
+    , m_prompts(std::make_unique<terminal::PromptIndex>())
     , m_session(std::make_unique<TerminalSession>())
     , m_loader(std::make_unique<ConfigLoader>())
+    , m_metricsExporter(std::make_unique<MetricsExporter>())
+    , m_search(std::make_unique<ScrollbackSearch>(*this))
+    , m_triggers(std::make_unique<OutputTriggers>(*this))
 {
+    m_engine->setScrollback(m_scrollback.get());
+    m_engine->setPromptIndex(m_prompts.get());
     connect(m_session.get(), &TerminalSession::dataReceived, this, [this](const QByteArray &data) {
         appendData(data);
     });
     connect(m_session.get(), &TerminalSession::finished, this, [](int exitCode) {
         qDebug() << "Terminal session finished with code" << exitCode;
     });
-    connect(m_loader.get(), &ConfigLoader::configurationChanged, this, [this](const QVariantMap &config) {
-        m_config = config;
-        if (auto logger = terminalLogger()) {
-            logger->info("Configuration reloaded from {}", config.value("_path").toString().toStdString());
-        }
-        emit configChanged();
-        startSession();
+    connect(m_loader.get(), &ConfigLoader::configurationChanged, this,
+            [this](const terminal::Config &config, const QStringList &changedKeys) {
+                applyConfig(config, changedKeys);
+            });
+    connect(m_search.get(), &ScrollbackSearch::resultsChanged, this, [this]() {
+        emit searchChanged();
+        markDamaged();
     });
+    connect(m_triggers.get(), &OutputTriggers::highlightsChanged, this, &TerminalBridge::markDamaged);
+    connect(m_triggers.get(), &OutputTriggers::notify, this, &TerminalBridge::triggerNotification);
 
     reloadConfig();
 }
 
 TerminalBridge::~TerminalBridge() = default;
 
-QString TerminalBridge::buffer() const
+int TerminalBridge::rows() const
+{
+    return activeScreen().rows();
+}
+
+int TerminalBridge::columns() const
+{
+    return activeScreen().columns();
+}
+
+const terminal::Cell *TerminalBridge::rowData(int row) const
+{
+    return activeScreen().rowData(row);
+}
+
+QString TerminalBridge::rowText(int row) const
+{
+    return activeScreen().rowText(row);
+}
+
+int TerminalBridge::cursorRow() const
+{
+    return activeScreen().cursorRow();
+}
+
+int TerminalBridge::cursorColumn() const
+{
+    return activeScreen().cursorColumn();
+}
+
+bool TerminalBridge::cursorVisible() const
+{
+    return m_engine->cursorVisible();
+}
+
+bool TerminalBridge::alternateScreenActive() const
+{
+    return m_engine->alternateScreenActive();
+}
+
+quint64 TerminalBridge::historyBegin() const
+{
+    return m_engine->alternateScreenActive() ? m_scrollback->end() : m_scrollback->begin();
+}
+
+quint64 TerminalBridge::historyEnd() const
+{
+    return m_scrollback->end();
+}
+
+const terminal::Cell *TerminalBridge::lineData(quint64 lineNumber, int *length, bool *wrapped) const
+{
+    if (wrapped) {
+        *wrapped = false;
+    }
+    const quint64 end = m_scrollback->end();
+    if (lineNumber < end) {
+        if (m_engine->alternateScreenActive()) {
+            *length = 0;
+            return nullptr;
+        }
+        return m_scrollback->line(lineNumber, length, wrapped);
+    }
+    const quint64 row = lineNumber - end;
+    if (row >= static_cast<quint64>(rows())) {
+        *length = 0;
+        return nullptr;
+    }
+    *length = columns();
+    if (wrapped) {
+        *wrapped = activeScreen().rowWrapped(static_cast<int>(row));
+    }
+    return rowData(static_cast<int>(row));
+}
+
+terminal::FrameDamage TerminalBridge::takeDamage()
+{
+    m_pendingDamage = false;
+    terminal::latencyTracker().frameTaken();
+    terminal::ScreenBuffer &screen = m_engine->activeScreen();
+    PROFILE_DIRTY_ROWS(screen.dirtyRows().size());
+    terminal::FrameDamage damage{screen.scrollEvents(), screen.damage()};
+    screen.resetDirty();
+    qint64 dirtyCells = 0;
+    for (const terminal::DamageSpan &span : std::as_const(damage.spans)) {
+        dirtyCells += (span.lastColumn - span.firstColumn) + 1;
+    }
+    terminal::metrics().add(terminal::Metrics::DirtyCellsTotal, dirtyCells);
+    terminal::trace(terminal::TraceEvent::DirtyCells, dirtyCells);
+    return damage;
+}
+
+QString TerminalBridge::fontFamily() const
+{
+    return m_config.fontFamily;
+}
+
+qreal TerminalBridge::fontPointSize() const
+{
+    return m_config.fontSize;
+}
+
+QString TerminalBridge::fontFallback() const
+{
+    return m_config.fontFallback.join(QLatin1Char(','));
+}
+
+bool TerminalBridge::find(const QString &pattern, bool caseSensitive, bool regex)
+{
+    m_hasFindLine = false;
+    QString error;
+    if (!m_search->start(pattern, caseSensitive, regex, &error)) {
+        if (auto logger = terminalLogger()) {
+            logger->debug("Invalid search pattern {}: {}", pattern.toStdString(), error.toStdString());
+        }
+        return false;
+    }
+    return true;
+}
+
+void TerminalBridge::findNext(bool backwards)
+{
+    // The first step searches up from the bottom of the screen whichever way
+    // was asked for, so it lands on the newest match.
+    const bool first = !m_hasFindLine;
+    const quint64 from = first ? historyEnd() + static_cast<quint64>(rows()) : m_findLine;
+    quint64 found = 0;
+    if (!m_search->nextMatchLine(from, backwards || first, &found)) {
+        return;
+    }
+    m_findLine = found;
+    m_hasFindLine = true;
+    emit revealLine(found);
+}
+
+void TerminalBridge::clearFind()
+{
+    m_hasFindLine = false;
+    m_search->clear();
+}
+
+int TerminalBridge::searchMatchCount() const
+{
+    return m_search->matchCount();
+}
+
+bool TerminalBridge::searching() const
+{
+    return m_search->isScanning();
+}
+
+const QVector<terminal::ColumnSpan> *TerminalBridge::searchMatches(quint64 lineNumber) const
+{
+    return m_search->isActive() ? m_search->matchesOnLine(lineNumber) : nullptr;
+}
+
+bool TerminalBridge::lineBackground(quint64 lineNumber, quint32 *color) const
+{
+    quint64 first = 0;
+    quint64 end = 0;
+    if (m_prompts->outputRange(selectedCommand(), historyEnd() + static_cast<quint64>(cursorRow()), &first, &end)
+        && lineNumber >= first && lineNumber < end) {
+        *color = kSelectedOutputBackground;
+        return true;
+    }
+    return m_triggers->lineColor(lineNumber, color);
+}
+
+terminal::HighlightDamage TerminalBridge::takeHighlightDamage()
+{
+    terminal::HighlightDamage damage = m_search->takeDamage();
+    damage.add(m_triggers->takeDamage());
+    return damage;
+}
+
+int TerminalBridge::commandCount() const
+{
+    return m_prompts->size();
+}
+
+int TerminalBridge::selectedCommand() const
+{
+    if (!m_hasSelectedCommand) {
+        return -1;
+    }
+    const int index = m_prompts->commandAt(m_selectedPromptLine);
+    return index >= 0 && m_prompts->at(index).promptLine == m_selectedPromptLine ? index : -1;
+}
+
+bool TerminalBridge::selectAdjacentCommand(bool backwards)
+{
+    const int selected = selectedCommand();
+    const quint64 from = selected >= 0 ? m_selectedPromptLine : historyEnd() + static_cast<quint64>(cursorRow());
+    const int index = m_prompts->adjacentCommand(from, backwards);
+    if (index < 0) {
+        return false;
+    }
+    const quint64 promptLine = m_prompts->at(index).promptLine;
+    selectCommandAt(promptLine, true);
+    emit revealLine(promptLine);
+    return true;
+}
+
+void TerminalBridge::clearCommandSelection()
+{
+    selectCommandAt(0, false);
+}
+
+void TerminalBridge::selectCommandAt(quint64 promptLine, bool selected)
+{
+    if (m_hasSelectedCommand == selected && (!selected || m_selectedPromptLine == promptLine)) {
+        return;
+    }
+    m_hasSelectedCommand = selected;
+    m_selectedPromptLine = promptLine;
+    ++m_commandSelectionGeneration;
+    emit selectedCommandChanged();
+    markDamaged();
+}
+
+QVariantMap TerminalBridge::commandInfo(int index) const
 {
-    return m_buffer;
+    if (index < 0 || index >= m_prompts->size()) {
+        return {};
+    }
+    const terminal::CommandRecord &record = m_prompts->at(index);
+    const bool started = record.outputLine != terminal::kNoLine;
+    const qint64 until = record.finished() ? record.finishedAt : QDateTime::currentMSecsSinceEpoch();
+    return {
+        {QStringLiteral("exitCode"), record.exitCode},
+        {QStringLiteral("finished"), record.finished()},
+        {QStringLiteral("durationMs"), started ? until - record.startedAt : 0},
+        {QStringLiteral("startedAt"), started ? record.startedAt : 0},
+    };
+}
+
+bool TerminalBridge::copyCommandOutput(int index)
+{
+    quint64 first = 0;
+    quint64 end = 0;
+    if (!m_prompts->outputRange(index, historyEnd() + static_cast<quint64>(cursorRow()), &first, &end)) {
+        return false;
+    }
+    copyText({std::max(first, historyBegin()), 0, end, 0});
+    return true;
 }
 
-QVariantMap TerminalBridge::config() const
+void TerminalBridge::copyText(const terminal::TextRange &range)
 {
-    return m_config;
+    const auto lines = [this](quint64 lineNumber, int *length, bool *wrapped) {
+        return lineData(lineNumber, length, wrapped);
+    };
+    QGuiApplication::clipboard()->setText(terminal::rangeText(lines, range));
+}
+
+bool TerminalBridge::saveScrollback(const QUrl &file)
+{
+    const QString path = file.isLocalFile() ? file.toLocalFile() : file.toString();
+    QSaveFile output(path);
+    const auto lines = [this](quint64 lineNumber, int *length, bool *wrapped) {
+        return lineData(lineNumber, length, wrapped);
+    };
+    const quint64 cursorLine = historyEnd() + static_cast<quint64>(cursorRow());
+    const bool saved = output.open(QIODevice::WriteOnly)
+        && terminal::writeRangeText(lines, {historyBegin(), 0, cursorLine + 1, 0}, output) && output.commit();
+    if (auto logger = terminalLogger()) {
+        if (saved) {
+            logger->info("Saved scrollback to {}", path.toStdString());
+        } else {
+            logger->error("Could not save scrollback to {}: {}", path.toStdString(),
+                          output.errorString().toStdString());
+        }
+    }
+    return saved;
 }
 
 void TerminalBridge::sendText(const QString &text)
@@ -51,9 +350,25 @@ void TerminalBridge::sendText(const QString &text)
     if (!m_session) {
         return;
     }
+    terminal::latencyTracker().inputDispatched();
+    clearCommandSelection();
     m_session->writeData(text.toUtf8());
 }
 
+bool TerminalBridge::sendKey(int key, Qt::KeyboardModifiers modifiers, const QString &text)
+{
+    terminal::KeyboardModes modes;
+    modes.applicationCursorKeys = m_engine->applicationCursorKeys();
+    m_keyBytes.clear();
+    if (!terminal::encodeKey(key, modifiers, text, modes, m_keyBytes)) {
+        return false;
+    }
+    terminal::latencyTracker().inputDispatched();
+    clearCommandSelection();
+    m_session->writeData(m_keyBytes);
+    return true;
+}
+
 void TerminalBridge::reloadConfig()
 {
     if (!m_loader) {
@@ -62,23 +377,118 @@ void TerminalBridge::reloadConfig()
     m_loader->load();
 }
 
+void TerminalBridge::resize(int columns, int rows)
+{
+    if (columns <= 0 || rows <= 0 || (columns == this->columns() && rows == this->rows())) {
+        return;
+    }
+    m_engine->resize(rows, columns);
+    m_session->resize(columns, rows);
+    emit gridSizeChanged();
+    m_search->handleOutput();
+    markDamaged();
+}
+
+void TerminalBridge::setInBackground(bool background)
+{
+    m_session->setLowPriority(background);
+}
+
 void TerminalBridge::appendData(const QByteArray &data)
 {
-    m_buffer.append(QString::fromUtf8(data));
-    if (m_buffer.size() > kMaxBufferSize) {
-        m_buffer = m_buffer.right(kMaxBufferSize);
+    PROFILE_FUNCTION();
+    if (!m_receivedOutput) {
+        m_receivedOutput = true;
+        terminal::startupTrace().mark("first shell output");
+    }
+    const quint32 commandRevision = m_prompts->revision();
+    QElapsedTimer parseTimer;
+    parseTimer.start();
+    m_engine->feed(data.constData(), static_cast<int>(data.size()));
+    terminal::latencyTracker().parsed();
+    terminal::Metrics &metrics = terminal::metrics();
+    metrics.add(terminal::Metrics::ParsedBytesTotal, data.size());
+    const qint64 parseNanoseconds = parseTimer.nsecsElapsed();
+    metrics.add(terminal::Metrics::ParseNanosecondsTotal, parseNanoseconds);
+    terminal::trace(terminal::TraceEvent::Parse, parseNanoseconds);
+    metrics.set(terminal::Metrics::ScrollbackBytes, m_scrollback->memoryBytes());
+    m_prompts->evictBefore(m_scrollback->begin());
+    if (m_prompts->revision() != commandRevision) {
+        emit commandsChanged();
     }
-    emit bufferChanged();
+    m_search->handleOutput();
+    m_triggers->handleOutput();
+    markDamaged();
+}
+
+void TerminalBridge::markDamaged()
+{
+    if (m_pendingDamage) {
+        return;
+    }
+    m_pendingDamage = true;
+    emit damageAvailable();
+}
+
+const terminal::ScreenBuffer &TerminalBridge::activeScreen() const
+{
+    return m_engine->activeScreen();
+}
+
+void TerminalBridge::applyConfig(const terminal::Config &config, const QStringList &changedKeys)
+{
+    m_config = config;
+    if (changedKeys.contains("scrollback.lines")) {
+        m_scrollback->setMaxLines(config.scrollbackLines);
+    }
+    if (changedKeys.contains("triggers")) {
+        m_triggers->setTriggers(config.triggers);
+    }
+    if (changedKeys.contains("metrics.file") || changedKeys.contains("metrics.socket")
+        || changedKeys.contains("metrics.interval_ms")) {
+        m_metricsExporter->configure(config.metricsFile, config.metricsSocket, config.metricsIntervalMs);
+    }
+    if (auto logger = terminalLogger()) {
+        logger->info("Configuration loaded from {}, changed: {}",
+                     config.path.isEmpty() ? std::string("defaults") : config.path.toStdString(),
+                     changedKeys.join(", ").toStdString());
+    }
+    // Fonts follow through the QML bindings on the font properties.
+    emit configChanged();
+
+    // The running shell is never restarted for a config change; a new
+    // shell.command or emulation.engine is picked up by the next session.
+    if (!m_sessionStarted) {
+        startSession();
+        return;
+    }
+    for (const char *key : {"shell.command", "emulation.engine"}) {
+        if (changedKeys.contains(QLatin1String(key))) {
+            if (auto logger = terminalLogger()) {
+                logger->info("{} changed; it applies to new sessions", key);
+            }
+        }
+    }
+}
+
+void TerminalBridge::setCommandOverride(const QString &command)
+{
+    if (m_commandOverride == command) {
+        return;
+    }
+    m_commandOverride = command;
+    startSession();
 }
 
 void TerminalBridge::startSession()
 {
-    const QString command = m_config.value("shell.command", "/bin/sh").toString();
+    const QString command = m_commandOverride.isEmpty() ? m_config.shellCommand : m_commandOverride;
     QStringList args;
     if (command.endsWith("sh")) {
         args << "-l";
     }
     m_session->stop();
+    selectEngine();
     const bool started = m_session->start(command, args);
     if (!started) {
         qWarning() << "Failed to start terminal session";
@@ -87,7 +497,34 @@ void TerminalBridge::startSession()
         }
         return;
     }
+    m_sessionStarted = true;
+    terminal::startupTrace().mark("shell forked");
+    m_session->resize(columns(), rows());
     if (auto logger = terminalLogger()) {
         logger->info("Started terminal session using command {}", command.toStdString());
     }
 }
+
+void TerminalBridge::selectEngine()
+{
+    if (m_engine->name() == m_config.emulationEngine) {
+        return;
+    }
+    std::unique_ptr<terminal::EmulationEngine> engine =
+        terminal::createEmulationEngine(m_config.emulationEngine, rows(), columns());
+    if (!engine) {
+        if (auto logger = terminalLogger()) {
+            logger->warn("Emulation engine {} is not available (have {}); using {}",
+                         m_config.emulationEngine.toStdString(),
+                         terminal::emulationEngineNames().join(", ").toStdString(), m_engine->name().toStdString());
+        }
+        return;
+    }
+    engine->setScrollback(m_scrollback.get());
+    engine->setPromptIndex(m_prompts.get());
+    m_engine = std::move(engine);
+    if (auto logger = terminalLogger()) {
+        logger->info("Using the {} emulation engine", m_engine->name().toStdString());
+    }
+    markDamaged();
+}
@@ -1,41 +1,186 @@
 #ifndef TERMINAL_BRIDGE_H
 #define TERMINAL_BRIDGE_H
 
+#include <QByteArray>
 #include <QObject>
+#include <QStringList>
+#include <QUrl>
 #include <QVariantMap>
+#include <QVector>
 
 #include <memory>
 
+#include "config.h"
+
 class TerminalSession;
 class ConfigLoader;
+class MetricsExporter;
+class OutputTriggers;
+class ScrollbackSearch;
+
+namespace terminal
+{
+struct Cell;
+struct ColumnSpan;
+struct FrameDamage;
+struct HighlightDamage;
+struct TextRange;
+class EmulationEngine;
+class PromptIndex;
+class ScreenBuffer;
+class Scrollback;
+}
 
 class TerminalBridge : public QObject
 {
     Q_OBJECT
-    Q_PROPERTY(QString buffer READ buffer NOTIFY bufferChanged)
-    Q_PROPERTY(QVariantMap config READ config NOTIFY configChanged)
+    Q_PROPERTY(int rows READ rows NOTIFY gridSizeChanged)
+    Q_PROPERTY(int columns READ columns NOTIFY gridSizeChanged)
+    Q_PROPERTY(QString fontFamily READ fontFamily NOTIFY configChanged)
+    Q_PROPERTY(qreal fontPointSize READ fontPointSize NOTIFY configChanged)
+    Q_PROPERTY(QString fontFallback READ fontFallback NOTIFY configChanged)
+    Q_PROPERTY(int searchMatchCount READ searchMatchCount NOTIFY searchChanged)
+    Q_PROPERTY(bool searching READ searching NOTIFY searchChanged)
+    Q_PROPERTY(int selectedCommand READ selectedCommand NOTIFY selectedCommandChanged)
+    Q_PROPERTY(int commandCount READ commandCount NOTIFY commandsChanged)
 
 public:
     explicit TerminalBridge(QObject *parent = nullptr);
     ~TerminalBridge() override;
 
-    QString buffer() const;
-    QVariantMap config() const;
+    int rows() const;
+    int columns() const;
+    const terminal::Config &config() const { return m_config; }
+    QString fontFamily() const;
+    qreal fontPointSize() const;
+    // font.fallback as the comma-separated list the surfaces take.
+    QString fontFallback() const;
+
+    // Row access into the active screen; valid until the next PTY read.
+    const terminal::Cell *rowData(int row) const;
+    QString rowText(int row) const;
+    int cursorRow() const;
+    int cursorColumn() const;
+    // False while the application has hidden the cursor (DECTCEM).
+    bool cursorVisible() const;
+    bool alternateScreenActive() const;
+
+    // History and screen as one sequence of absolute line numbers: scrollback
+    // covers [historyBegin(), historyEnd()) and screen row r is line
+    // historyEnd() + r. The alternate screen has no history.
+    quint64 historyBegin() const;
+    quint64 historyEnd() const;
+    // Cells of a line, or nullptr outside that range; length receives the
+    // number of valid cells, which may differ from columns(). wrapped, if
+    // given, receives whether the line's text continues on the next line.
+    const terminal::Cell *lineData(quint64 lineNumber, int *length, bool *wrapped = nullptr) const;
+
+    // Frame handover: damage is accumulated between frames and damageAvailable
+    // fires only for the first chunk after the renderer last took the damage.
+    bool hasPendingDamage() const { return m_pendingDamage; }
+    terminal::FrameDamage takeDamage();
+
+    // Find in scrollback and on screen. find() starts a new search (an empty
+    // pattern clears it) and returns false for an invalid regex; findNext()
+    // steps through matching lines, wrapping round, and emits revealLine().
+    Q_INVOKABLE bool find(const QString &pattern, bool caseSensitive, bool regex);
+    Q_INVOKABLE void findNext(bool backwards);
+    Q_INVOKABLE void clearFind();
+    int searchMatchCount() const;
+    // True while older history is still being searched.
+    bool searching() const;
+    // Matches on a line for highlighting, or nullptr; valid until the next
+    // PTY read.
+    const QVector<terminal::ColumnSpan> *searchMatches(quint64 lineNumber) const;
+    // Background for a whole line: the selected command's output, else the
+    // colour a highlight trigger gave it.
+    bool lineBackground(quint64 lineNumber, quint32 *color) const;
+    // Changes whenever the selected command, and with it the tinted output,
+    // does.
+    quint32 highlightGeneration() const { return m_commandSelectionGeneration; }
+    // Lines whose search matches or trigger backgrounds changed since the
+    // last call.
+    terminal::HighlightDamage takeHighlightDamage();
+
+    // Commands recorded from OSC 133 shell integration marks. Selecting one
+    // reveals its prompt and tints its output; typing clears the selection.
+    const terminal::PromptIndex &prompts() const { return *m_prompts; }
+    // commandsChanged also fires when a mark updates an existing command, so
+    // bindings on commandInfo() stay current.
+    int commandCount() const;
+    int selectedCommand() const;
+    // Selects the command before (or after) the selected one, starting from
+    // the cursor; false if there is none.
+    Q_INVOKABLE bool selectAdjacentCommand(bool backwards);
+    Q_INVOKABLE void clearCommandSelection();
+    // exitCode (-1 if unknown), finished, durationMs and startedAt (ms since
+    // the epoch) of a command; empty for an invalid index.
+    Q_INVOKABLE QVariantMap commandInfo(int index) const;
+    Q_INVOKABLE bool copyCommandOutput(int index);
+
+    // Puts the text of range on the clipboard (see terminal::rangeText()).
+    void copyText(const terminal::TextRange &range);
+    // Writes history and screen up to the cursor line to file as UTF-8,
+    // streaming line by line; false, with the reason logged, on failure.
+    Q_INVOKABLE bool saveScrollback(const QUrl &file);
 
     Q_INVOKABLE void sendText(const QString &text);
+    // Encodes a key press for the current keyboard modes and queues it for
+    // the session; returns false if the key sends nothing.
+    bool sendKey(int key, Qt::KeyboardModifiers modifiers, const QString &text);
     Q_INVOKABLE void reloadConfig();
+    Q_INVOKABLE void resize(int columns, int rows);
+    // Set while no view of this terminal is on screen; output keeps being
+    // parsed, at low priority, so the screen is current when it comes back.
+    void setInBackground(bool background);
+
+    // Runs command instead of shell.command, now and on later restarts; an
+    // empty command goes back to the configured shell.
+    void setCommandOverride(const QString &command);
 
 signals:
-    void bufferChanged();
+    void damageAvailable();
+    void gridSizeChanged();
     void configChanged();
+    void searchChanged();
+    // Asks the views to scroll a line into sight.
+    void revealLine(quint64 lineNumber);
+    // A notify trigger matched line.
+    void triggerNotification(const QString &pattern, const QString &line);
+    void selectedCommandChanged();
+    void commandsChanged();
 
 private:
+    void applyConfig(const terminal::Config &config, const QStringList &changedKeys);
     void appendData(const QByteArray &data);
     void startSession();
+    void selectEngine();
+    void markDamaged();
+    void selectCommandAt(quint64 promptLine, bool selected);
+
+    const terminal::ScreenBuffer &activeScreen() const;
 
-    QString m_buffer;
-    QVariantMap m_config;
+    std::unique_ptr<terminal::Scrollback> m_scrollback;
+    std::unique_ptr<terminal::EmulationEngine> m_engine;
+    std::unique_ptr<terminal::PromptIndex> m_prompts;
+    // Prompt line of the selected command, which survives eviction of older
+    // records where an index would not.
+    quint64 m_selectedPromptLine = 0;
+    bool m_hasSelectedCommand = false;
+    quint32 m_commandSelectionGeneration = 0;
+    bool m_pendingDamage = false;
+    terminal::Config m_config;
+    QString m_commandOverride;
+    bool m_sessionStarted = false;
+    bool m_receivedOutput = false;
+    QByteArray m_keyBytes;
     std::unique_ptr<TerminalSession> m_session;
     std::unique_ptr<ConfigLoader> m_loader;
+    std::unique_ptr<MetricsExporter> m_metricsExporter;
+    std::unique_ptr<ScrollbackSearch> m_search;
+    std::unique_ptr<OutputTriggers> m_triggers;
+    // The line findNext() last revealed; none until the first step.
+    quint64 m_findLine = 0;
+    bool m_hasFindLine = false;
 };
 #endif
@@ -1,5 +1,10 @@
 #include "terminal_session.h"
 
+#include "latency_tracker.h"
+#include "metrics.h"
+#include "profiling.h"
+#include "trace.h"
+
 #include <QCoreApplication>
 #include <QSocketNotifier>
 #include <QTimer>
@@ -13,6 +18,8 @@
 #else
 #include <pty.h>
 #endif
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 
@@ -21,11 +28,22 @@
 namespace {
 constexpr int kDefaultColumns = 80;
 constexpr int kDefaultRows = 24;
+constexpr qsizetype kReadBytes = 4096;
+// A background session drains up to this much per wakeup, then sleeps.
+constexpr qsizetype kBackgroundBatchBytes = 1024 * 1024;
+constexpr int kBackgroundReadIntervalMs = 50;
 } // namespace
 
 TerminalSession::TerminalSession(QObject *parent)
     : QObject(parent)
 {
+    m_readPause.setSingleShot(true);
+    m_readPause.setInterval(kBackgroundReadIntervalMs);
+    connect(&m_readPause, &QTimer::timeout, this, [this]() {
+        if (m_readNotifier) {
+            m_readNotifier->setEnabled(true);
+        }
+    });
 }
 
 TerminalSession::~TerminalSession()
@@ -50,10 +68,7 @@ bool TerminalSession::start(const QString &command, const QStringList &arguments
     }
 
     if (pid == 0) {
-        QStringList args = arguments;
-        if (args.isEmpty()) {
-            args << "-l";
-        }
+        const QStringList &args = arguments;
         QByteArray cmd = command.toLocal8Bit();
         QList<QByteArray> argArray;
         argArray.reserve(args.size() + 1);
@@ -71,9 +86,13 @@ bool TerminalSession::start(const QString &command, const QStringList &arguments
 
     m_childPid = pid;
     m_masterFd = masterFd;
+    ::fcntl(m_masterFd, F_SETFL, ::fcntl(m_masterFd, F_GETFL) | O_NONBLOCK);
 
     m_readNotifier = std::make_unique<QSocketNotifier>(m_masterFd, QSocketNotifier::Read, this);
     connect(m_readNotifier.get(), &QSocketNotifier::activated, this, &TerminalSession::handleReadyRead);
+    m_writeNotifier = std::make_unique<QSocketNotifier>(m_masterFd, QSocketNotifier::Write, this);
+    m_writeNotifier->setEnabled(false);
+    connect(m_writeNotifier.get(), &QSocketNotifier::activated, this, &TerminalSession::flushWriteQueue);
 
     return true;
 }
@@ -83,7 +102,33 @@ void TerminalSession::writeData(const QByteArray &data)
     if (m_masterFd < 0) {
         return;
     }
-    ::write(m_masterFd, data.constData(), static_cast<size_t>(data.size()));
+    m_writeQueue.append(data);
+    flushWriteQueue();
+}
+
+void TerminalSession::flushWriteQueue()
+{
+    qsizetype written = 0;
+    while (written < m_writeQueue.size()) {
+        const ssize_t result = ::write(m_masterFd, m_writeQueue.constData() + written,
+                                       static_cast<size_t>(m_writeQueue.size() - written));
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // The child is gone; the read side reports the exit.
+                written = m_writeQueue.size();
+            }
+            break;
+        }
+        written += result;
+    }
+    if (written > 0) {
+        m_writeQueue.remove(0, written);
+        terminal::latencyTracker().ptyWritten();
+    }
+    m_writeNotifier->setEnabled(!m_writeQueue.isEmpty());
 }
 
 void TerminalSession::resize(int columns, int rows)
@@ -97,20 +142,69 @@ void TerminalSession::resize(int columns, int rows)
     ::ioctl(m_masterFd, TIOCSWINSZ, &ws);
 }
 
+void TerminalSession::setLowPriority(bool lowPriority)
+{
+    if (m_lowPriority == lowPriority) {
+        return;
+    }
+    m_lowPriority = lowPriority;
+    if (!lowPriority && m_readPause.isActive()) {
+        // Whatever piled up during the pause is read now, not at the timeout.
+        m_readPause.stop();
+        if (m_readNotifier) {
+            m_readNotifier->setEnabled(true);
+        }
+    }
+}
+
 void TerminalSession::handleReadyRead()
 {
+    PROFILE_FUNCTION();
     if (m_masterFd < 0) {
         return;
     }
 
-    QByteArray buffer(4096, Qt::Uninitialized);
-    const ssize_t bytesRead = ::read(m_masterFd, buffer.data(), static_cast<size_t>(buffer.size()));
-    if (bytesRead <= 0) {
+    // In the foreground this is a single read, so output reaches the screen
+    // as soon as it arrives.
+    const qsizetype limit = m_lowPriority ? kBackgroundBatchBytes : kReadBytes;
+    QByteArray buffer;
+    qsizetype total = 0;
+    bool exited = false;
+    while (total < limit) {
+        buffer.resize(total + kReadBytes);
+        const ssize_t bytesRead = ::read(m_masterFd, buffer.data() + total, static_cast<size_t>(kReadBytes));
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (bytesRead <= 0) {
+            exited = true;
+            break;
+        }
+        total += bytesRead;
+        if (!m_lowPriority) {
+            break;
+        }
+    }
+
+    if (total > 0) {
+        terminal::latencyTracker().echoRead(terminal::LatencyTracker::now());
+        buffer.resize(total);
+        PROFILE_PTY_BYTES(total);
+        terminal::metrics().add(terminal::Metrics::PtyBytesTotal, total);
+        terminal::trace(terminal::TraceEvent::PtyRead, total);
+        emit dataReceived(buffer);
+    }
+    if (exited) {
         handleChildExit();
         return;
     }
-    buffer.resize(static_cast<int>(bytesRead));
-    emit dataReceived(buffer);
+    if (m_lowPriority && total > 0 && m_readNotifier) {
+        m_readNotifier->setEnabled(false);
+        m_readPause.start();
+    }
 }
 
 void TerminalSession::handleChildExit()
@@ -137,10 +231,16 @@ void TerminalSession::stop()
 
 void TerminalSession::closePty()
 {
+    m_readPause.stop();
     if (m_readNotifier) {
         m_readNotifier->setEnabled(false);
         m_readNotifier.reset();
     }
+    if (m_writeNotifier) {
+        m_writeNotifier->setEnabled(false);
+        m_writeNotifier.reset();
+    }
+    m_writeQueue.clear();
     if (m_masterFd >= 0) {
         ::close(m_masterFd);
         m_masterFd = -1;
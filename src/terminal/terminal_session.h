@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QSocketNotifier>
 #include <QStringList>
+#include <QTimer>
 
 #include <memory>
 
@@ -15,9 +16,14 @@ public:
     ~TerminalSession() override;
 
     bool start(const QString &command, const QStringList &arguments = {});
+    // Writes as much as the PTY takes now and queues the rest, in order, for
+    // when it becomes writable again; never blocks the caller.
     void writeData(const QByteArray &data);
     void resize(int columns, int rows);
     void stop();
+    // For a terminal nobody is looking at: output is still read and parsed,
+    // but in large batches a few times a second instead of on every wakeup.
+    void setLowPriority(bool lowPriority);
 
 signals:
     void dataReceived(const QByteArray &data);
@@ -25,6 +31,7 @@ signals:
 
 private slots:
     void handleReadyRead();
+    void flushWriteQueue();
     void handleChildExit();
 
 private:
@@ -33,4 +40,9 @@ private:
     int m_masterFd = -1;
     pid_t m_childPid = -1;
     std::unique_ptr<QSocketNotifier> m_readNotifier;
+    std::unique_ptr<QSocketNotifier> m_writeNotifier;
+    QByteArray m_writeQueue;
+    // Keeps the read notifier off between low-priority batches.
+    QTimer m_readPause;
+    bool m_lowPriority = false;
 };
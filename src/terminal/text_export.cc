@@ -0,0 +1,142 @@
+#include "text_export.h"
+
+#include "profiling.h"
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <vector>
+
+namespace terminal
+{
+
+namespace {
+
+// Large enough that writes are not the bottleneck, small enough to stay in
+// cache while it fills.
+constexpr std::size_t kWriteBufferBytes = 1 << 20;
+
+class StringSink
+{
+public:
+    void append(char32_t codepoint)
+    {
+        if (QChar::requiresSurrogates(codepoint)) {
+            m_text.append(QChar(QChar::highSurrogate(codepoint)));
+            m_text.append(QChar(QChar::lowSurrogate(codepoint)));
+        } else {
+            m_text.append(QChar(static_cast<char16_t>(codepoint)));
+        }
+    }
+    bool flush() { return true; }
+    QString take() { return std::move(m_text); }
+
+private:
+    QString m_text;
+};
+
+class Utf8Sink
+{
+public:
+    explicit Utf8Sink(QIODevice &device)
+        : m_device(device)
+    {
+        m_buffer.reserve(kWriteBufferBytes);
+    }
+
+    void append(char32_t codepoint)
+    {
+        if (codepoint < 0x80) {
+            m_buffer.push_back(static_cast<char>(codepoint));
+        } else if (codepoint < 0x800) {
+            m_buffer.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+            m_buffer.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        } else if (codepoint < 0x10000) {
+            m_buffer.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+            m_buffer.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            m_buffer.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        } else {
+            m_buffer.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            m_buffer.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            m_buffer.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            m_buffer.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    // Called between lines; writes once the buffer is nearly full.
+    bool flush(bool force = false)
+    {
+        if (m_buffer.empty() || (!force && m_buffer.size() < kWriteBufferBytes - 4096)) {
+            return true;
+        }
+        const qint64 written = m_device.write(m_buffer.data(), static_cast<qint64>(m_buffer.size()));
+        const bool ok = written == static_cast<qint64>(m_buffer.size());
+        m_buffer.clear();
+        return ok;
+    }
+
+private:
+    QIODevice &m_device;
+    std::vector<char> m_buffer;
+};
+
+template <typename Sink>
+bool walk(const LineReader &lines, const TextRange &range, Sink &sink)
+{
+    // Blanks are held back until something follows them on the same line.
+    int pendingSpaces = 0;
+    for (quint64 line = range.firstLine; line <= range.endLine; ++line) {
+        if (line == range.endLine && range.endColumn <= 0) {
+            break;
+        }
+        int length = 0;
+        bool wrapped = false;
+        const Cell *cells = lines(line, &length, &wrapped);
+        const int first = line == range.firstLine ? std::max(range.firstColumn, 0) : 0;
+        const int last = line == range.endLine ? std::min(length, range.endColumn) : length;
+        for (int column = first; cells && column < last; ++column) {
+            const char32_t codepoint = cells[column].codepoint;
+            if (codepoint == kWideCharContinuation) {
+                continue;
+            }
+            if (codepoint == U' ') {
+                ++pendingSpaces;
+                continue;
+            }
+            for (; pendingSpaces > 0; --pendingSpaces) {
+                sink.append(U' ');
+            }
+            sink.append(codepoint);
+        }
+        if (line == range.endLine) {
+            break;
+        }
+        if (!wrapped) {
+            pendingSpaces = 0;
+            sink.append(U'\n');
+        }
+        if (!sink.flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+QString rangeText(const LineReader &lines, const TextRange &range)
+{
+    PROFILE_FUNCTION();
+    StringSink sink;
+    walk(lines, range, sink);
+    return sink.take();
+}
+
+bool writeRangeText(const LineReader &lines, const TextRange &range, QIODevice &device)
+{
+    PROFILE_FUNCTION();
+    Utf8Sink sink(device);
+    return walk(lines, range, sink) && sink.flush(true);
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef TERMINAL_TEXT_EXPORT_H
+#define TERMINAL_TEXT_EXPORT_H
+
+#include "screen_buffer.h"
+
+#include <QString>
+
+#include <functional>
+
+class QIODevice;
+
+namespace terminal
+{
+
+// From (firstLine, firstColumn) up to, not including, (endLine, endColumn),
+// by absolute line number. Whole lines [a, b) are {a, 0, b, 0}.
+struct TextRange
+{
+    quint64 firstLine;
+    int firstColumn;
+    quint64 endLine;
+    int endColumn;
+};
+
+// Reads a line as TerminalBridge::lineData() does.
+using LineReader = std::function<const Cell *(quint64 lineNumber, int *length, bool *wrapped)>;
+
+// Both exports read one line at a time straight from the screen or the
+// scrollback pages. Soft-wrapped lines are joined, other lines end in '\n'
+// and trailing blanks are dropped.
+//
+// The text as one string, built in a single pass for the clipboard.
+QString rangeText(const LineReader &lines, const TextRange &range);
+// Streams the text to device as UTF-8 through a fixed-size buffer, so memory
+// use does not grow with the range; false if a write fails.
+bool writeRangeText(const LineReader &lines, const TextRange &range, QIODevice &device);
+
+}
+#endif
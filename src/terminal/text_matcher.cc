@@ -0,0 +1,296 @@
+#include "text_matcher.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TERMINAL_HAVE_SSE2 1
+#endif
+
+namespace terminal
+{
+
+namespace {
+
+QVector<char32_t> toCodepoints(const QString &text, bool caseSensitive)
+{
+    QVector<char32_t> codepoints;
+    for (const uint codepoint : text.toUcs4()) {
+        codepoints.append(caseSensitive ? codepoint : foldCase(codepoint));
+    }
+    return codepoints;
+}
+
+// Escapes that match one character of a class, or assert a position.
+const QLatin1StringView kSingleCharacterEscapes("dDwWsShHvVbBAzZGntrfae");
+
+// The longest run of plain characters every match of pattern must contain,
+// or an empty string when that is not obvious (alternation, inline options,
+// numeric and property escapes).
+// Only runs outside groups count, and a character followed by a quantifier
+// that allows zero repeats is not part of a run.
+QString requiredLiteral(const QString &pattern)
+{
+    QString longest;
+    QString current;
+    const auto endRun = [&]() {
+        if (current.size() > longest.size()) {
+            longest = current;
+        }
+        current.clear();
+    };
+    const auto dropLast = [&]() {
+        if (!current.isEmpty()) {
+            current.chop(current.back().isLowSurrogate() && current.size() > 1 ? 2 : 1);
+        }
+    };
+
+    int depth = 0;
+    bool inClass = false;
+    for (qsizetype index = 0; index < pattern.size(); ++index) {
+        const QChar c = pattern[index];
+        if (inClass) {
+            if (c == QLatin1Char('\\')) {
+                ++index;
+            } else if (c == QLatin1Char('[') && index + 1 < pattern.size()
+                       && (pattern[index + 1] == QLatin1Char(':') || pattern[index + 1] == QLatin1Char('.')
+                           || pattern[index + 1] == QLatin1Char('='))) {
+                // [:alpha:] and friends end in their own "]".
+                const qsizetype close = pattern.indexOf(QString(pattern[index + 1]) + QLatin1Char(']'), index + 2);
+                if (close < 0) {
+                    return {};
+                }
+                index = close + 1;
+            } else if (c == QLatin1Char(']')) {
+                inClass = false;
+            }
+            continue;
+        }
+        switch (c.unicode()) {
+        case '|':
+            return {};
+        case '(':
+            // Inline options such as (?i) change how later literals match.
+            if (index + 2 < pattern.size() && pattern[index + 1] == QLatin1Char('?')
+                && pattern[index + 2].isLetter()) {
+                return {};
+            }
+            ++depth;
+            endRun();
+            continue;
+        case ')':
+            --depth;
+            endRun();
+            continue;
+        case '[':
+            inClass = true;
+            endRun();
+            // A "]" first in the class, after an optional "^", is a member.
+            if (index + 1 < pattern.size() && pattern[index + 1] == QLatin1Char('^')) {
+                ++index;
+            }
+            if (index + 1 < pattern.size() && pattern[index + 1] == QLatin1Char(']')) {
+                ++index;
+            }
+            continue;
+        case '*':
+        case '?':
+            dropLast();
+            endRun();
+            continue;
+        case '{':
+            dropLast();
+            endRun();
+            while (index < pattern.size() && pattern[index] != QLatin1Char('}')) {
+                ++index;
+            }
+            continue;
+        case '+':
+        case '.':
+        case '^':
+        case '$':
+            endRun();
+            continue;
+        case '\\':
+            // \. and friends are literal, and \d, \w, \b and the like stand
+            // for one character or none. Any other letter or digit starts an
+            // escape that may be longer (\x41, \101, \p{L}, \Q...\E) and may
+            // well match a literal, so there is no safe answer.
+            if (index + 1 >= pattern.size()) {
+                return {};
+            }
+            ++index;
+            if (!pattern[index].isLetterOrNumber()) {
+                if (depth == 0) {
+                    current.append(pattern[index]);
+                }
+            } else if (kSingleCharacterEscapes.contains(pattern[index])) {
+                endRun();
+            } else {
+                return {};
+            }
+            continue;
+        default:
+            if (depth == 0) {
+                current.append(c);
+            }
+            continue;
+        }
+    }
+    endRun();
+    return longest;
+}
+
+}
+
+bool TextMatcher::setPattern(const QString &pattern, bool caseSensitive, bool regex, QString *error)
+{
+    m_caseSensitive = caseSensitive;
+    m_regex = false;
+    m_literal.clear();
+    m_expression = QRegularExpression();
+    if (pattern.isEmpty()) {
+        return true;
+    }
+    if (!regex) {
+        m_literal = toCodepoints(pattern, caseSensitive);
+        return true;
+    }
+
+    QRegularExpression expression(pattern, caseSensitive ? QRegularExpression::NoPatternOption
+                                                         : QRegularExpression::CaseInsensitiveOption);
+    if (!expression.isValid()) {
+        if (error) {
+            *error = expression.errorString();
+        }
+        return false;
+    }
+    expression.optimize();
+    m_expression = expression;
+    m_regex = true;
+    m_literal = toCodepoints(requiredLiteral(pattern), caseSensitive);
+    return true;
+}
+
+void TextMatcher::match(const Cell *cells, int length, QVector<ColumnSpan> &spans)
+{
+    if (isEmpty() || !cells || length <= 0) {
+        return;
+    }
+    if (!m_literal.isEmpty()) {
+        gather(cells, length);
+        findLiteral(m_literal, m_positions);
+        if (m_positions.isEmpty()) {
+            return;
+        }
+    }
+    if (m_regex) {
+        matchRegex(cells, length, spans);
+        return;
+    }
+    const int literalLength = static_cast<int>(m_literal.size());
+    for (int position : std::as_const(m_positions)) {
+        const int column = m_columns[position];
+        spans.append({column, m_columns[position + literalLength] - column});
+    }
+}
+
+void TextMatcher::gather(const Cell *cells, int length)
+{
+    m_text.resize(0);
+    m_columns.resize(0);
+    m_text.reserve(length);
+    m_columns.reserve(length + 1);
+    for (int column = 0; column < length; ++column) {
+        const char32_t codepoint = cells[column].codepoint;
+        if (codepoint == kWideCharContinuation) {
+            continue;
+        }
+        m_text.append(m_caseSensitive ? codepoint : foldCase(codepoint));
+        m_columns.append(column);
+    }
+    m_columns.append(length);
+}
+
+void TextMatcher::findLiteral(const QVector<char32_t> &needle, QVector<int> &positions) const
+{
+    positions.resize(0);
+    const int textLength = static_cast<int>(m_text.size());
+    const int needleLength = static_cast<int>(needle.size());
+    if (needleLength == 0 || textLength < needleLength) {
+        return;
+    }
+
+    const char32_t *text = m_text.constData();
+    const char32_t first = needle.front();
+    const char32_t last = needle.back();
+    // Non-overlapping: a match can start no earlier than where the last ended.
+    int nextStart = 0;
+    const auto accept = [&](int start) {
+        if (start < nextStart
+            || (needleLength > 2
+                && std::memcmp(text + start + 1, needle.constData() + 1, sizeof(char32_t) * (needleLength - 2)) != 0)) {
+            return;
+        }
+        positions.append(start);
+        nextStart = start + needleLength;
+    };
+
+    int index = 0;
+#if defined(TERMINAL_HAVE_SSE2)
+    // Four candidate starts per step: their first and last characters must
+    // both match before the middle is compared.
+    const __m128i firstBlock = _mm_set1_epi32(static_cast<int>(first));
+    const __m128i lastBlock = _mm_set1_epi32(static_cast<int>(last));
+    for (; index + needleLength + 3 <= textLength; index += 4) {
+        const __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + index));
+        const __m128i tails = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + index + needleLength - 1));
+        const __m128i both = _mm_and_si128(_mm_cmpeq_epi32(heads, firstBlock), _mm_cmpeq_epi32(tails, lastBlock));
+        uint mask = static_cast<uint>(_mm_movemask_ps(_mm_castsi128_ps(both)));
+        while (mask != 0) {
+            accept(index + static_cast<int>(qCountTrailingZeroBits(mask)));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; index + needleLength <= textLength; ++index) {
+        if (text[index] == first && text[index + needleLength - 1] == last) {
+            accept(index);
+        }
+    }
+}
+
+void TextMatcher::matchRegex(const Cell *cells, int length, QVector<ColumnSpan> &spans)
+{
+    m_lineText.resize(0);
+    m_utf16Columns.resize(0);
+    for (int column = 0; column < length; ++column) {
+        const char32_t codepoint = cells[column].codepoint;
+        if (codepoint == kWideCharContinuation) {
+            continue;
+        }
+        if (QChar::requiresSurrogates(codepoint)) {
+            m_lineText.append(QChar(QChar::highSurrogate(codepoint)));
+            m_lineText.append(QChar(QChar::lowSurrogate(codepoint)));
+            m_utf16Columns.append(column);
+        } else {
+            m_lineText.append(QChar(static_cast<char16_t>(codepoint)));
+        }
+        m_utf16Columns.append(column);
+    }
+    m_utf16Columns.append(length);
+
+    QRegularExpressionMatchIterator matches = m_expression.globalMatch(m_lineText);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        if (match.capturedLength() == 0) {
+            continue;
+        }
+        const int column = m_utf16Columns[match.capturedStart()];
+        spans.append({column, m_utf16Columns[match.capturedEnd()] - column});
+    }
+}
+
+}
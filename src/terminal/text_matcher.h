@@ -0,0 +1,73 @@
+#ifndef TERMINAL_TEXT_MATCHER_H
+#define TERMINAL_TEXT_MATCHER_H
+
+#include "screen_buffer.h"
+
+#include <QChar>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+namespace terminal
+{
+
+// Columns [column, column + length) of one match within a line.
+struct ColumnSpan
+{
+    int column;
+    int length;
+
+    bool operator==(const ColumnSpan &other) const
+    {
+        return column == other.column && length == other.length;
+    }
+};
+
+// Case folding for case-insensitive matching, shared with TriggerMatcher.
+// ASCII is folded inline; everything else goes through Qt's tables.
+inline char32_t foldCase(char32_t codepoint)
+{
+    if (codepoint < 0x80) {
+        return (codepoint >= U'A' && codepoint <= U'Z') ? codepoint + (U'a' - U'A') : codepoint;
+    }
+    return QChar::toCaseFolded(codepoint);
+}
+
+// Finds a pattern in rows of cells. Plain text is matched directly on the
+// codepoints, comparing the first and last pattern character four cells at a
+// time before verifying candidates; regular expressions only run on lines
+// that contain their longest required literal, so most lines never become a
+// QString. Not thread-safe: the scratch buffers are reused across calls.
+class TextMatcher
+{
+public:
+    // Returns false, with error set, if a regular expression does not compile.
+    bool setPattern(const QString &pattern, bool caseSensitive, bool regex, QString *error = nullptr);
+    bool isEmpty() const { return m_literal.isEmpty() && !m_regex; }
+
+    // Appends the non-overlapping matches in cells[0, length) to spans.
+    void match(const Cell *cells, int length, QVector<ColumnSpan> &spans);
+
+private:
+    void gather(const Cell *cells, int length);
+    void findLiteral(const QVector<char32_t> &needle, QVector<int> &positions) const;
+    void matchRegex(const Cell *cells, int length, QVector<ColumnSpan> &spans);
+
+    bool m_caseSensitive = true;
+    bool m_regex = false;
+    // The pattern for plain searches, else the regex's required literal
+    // (possibly empty); case folded when matching ignores case.
+    QVector<char32_t> m_literal;
+    QRegularExpression m_expression;
+
+    // Codepoints of the current line with wide-character continuation cells
+    // left out, and the column each one came from (plus one past the end).
+    QVector<char32_t> m_text;
+    QVector<int> m_columns;
+    QVector<int> m_positions;
+    QString m_lineText;
+    QVector<int> m_utf16Columns;
+};
+
+}
+#endif
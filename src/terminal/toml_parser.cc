@@ -0,0 +1,790 @@
+#include "toml_parser.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+#include <QtNumeric>
+
+#include <cctype>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace terminal
+{
+
+namespace {
+
+// Built while parsing and converted to QVariants at the end, because the
+// redefinition rules need to know how each table came to exist.
+struct Node
+{
+    enum Kind {
+        Value,
+        Table,
+        Array,
+    };
+
+    explicit Node(Kind kind)
+        : kind(kind)
+    {
+    }
+
+    Kind kind;
+    QVariant value;
+    std::map<QString, std::unique_ptr<Node>> children;
+    std::vector<std::unique_ptr<Node>> items;
+    // Tables: named by a [header], created by a dotted key, or written inline
+    // (and therefore closed to later additions).
+    bool defined = false;
+    bool dotted = false;
+    bool sealed = false;
+    // Arrays: built up by [[header]] sections rather than written as a value.
+    bool tableArray = false;
+};
+
+QVariant toVariant(const Node &node)
+{
+    switch (node.kind) {
+    case Node::Table: {
+        QVariantMap map;
+        for (const auto &[key, child] : node.children) {
+            map.insert(key, toVariant(*child));
+        }
+        return map;
+    }
+    case Node::Array: {
+        QVariantList list;
+        list.reserve(static_cast<qsizetype>(node.items.size()));
+        for (const auto &item : node.items) {
+            list.append(toVariant(*item));
+        }
+        return list;
+    }
+    case Node::Value:
+        break;
+    }
+    return node.value;
+}
+
+QString joinPath(const QString &base, const QString &key)
+{
+    return base.isEmpty() ? key : base + QLatin1Char('.') + key;
+}
+
+bool isBareKeyChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+}
+
+bool isControl(char c)
+{
+    const auto byte = static_cast<unsigned char>(c);
+    return (byte < 0x20 && c != '\t') || byte == 0x7F;
+}
+
+bool isValueTerminator(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ']' || c == '}' || c == '#' || c == '\n' || c == '\r';
+}
+
+bool isDigitOfBase(char c, int base)
+{
+    switch (base) {
+    case 2:
+        return c == '0' || c == '1';
+    case 8:
+        return c >= '0' && c <= '7';
+    case 16:
+        return std::isxdigit(static_cast<unsigned char>(c)) != 0;
+    default:
+        return std::isdigit(static_cast<unsigned char>(c)) != 0;
+    }
+}
+
+bool parseNumber(const QByteArray &token, QVariant &out)
+{
+    const bool hasSign = token.startsWith('+') || token.startsWith('-');
+    const bool negative = token.startsWith('-');
+    const QByteArray body = hasSign ? token.mid(1) : token;
+    if (body == "inf") {
+        out = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return true;
+    }
+    if (body == "nan") {
+        out = qQNaN();
+        return true;
+    }
+    if (body.isEmpty() || !std::isdigit(static_cast<unsigned char>(body.front()))) {
+        return false;
+    }
+
+    // Underscores may only separate two digits of the number's base, so an
+    // exponent marker next to one (1_e5) is not taken for a hex digit.
+    int base = 10;
+    if (body.size() > 2 && body[0] == '0') {
+        base = body[1] == 'x' ? 16 : (body[1] == 'o' ? 8 : (body[1] == 'b' ? 2 : 10));
+    }
+    QByteArray digits;
+    digits.reserve(body.size());
+    for (qsizetype index = 0; index < body.size(); ++index) {
+        const char c = body[index];
+        if (c != '_') {
+            digits.append(c);
+            continue;
+        }
+        if (index == 0 || index + 1 == body.size()
+            || !isDigitOfBase(body[index - 1], base) || !isDigitOfBase(body[index + 1], base)) {
+            return false;
+        }
+    }
+
+    if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'o' || digits[1] == 'b')) {
+        if (hasSign) {
+            return false;
+        }
+        const QByteArray magnitude = digits.mid(2);
+        for (char c : magnitude) {
+            if (!isDigitOfBase(c, base)) {
+                return false;
+            }
+        }
+        bool ok = false;
+        const qulonglong value = magnitude.toULongLong(&ok, base);
+        if (!ok || value > static_cast<qulonglong>(std::numeric_limits<qint64>::max())) {
+            return false;
+        }
+        out = static_cast<qint64>(value);
+        return true;
+    }
+
+    // Decimal integers and the integer part of floats have no leading zeros.
+    if (digits.size() > 1 && digits[0] == '0' && std::isdigit(static_cast<unsigned char>(digits[1]))) {
+        return false;
+    }
+    const QByteArray signedDigits = negative ? '-' + digits : digits;
+    if (digits.contains('.') || digits.contains('e') || digits.contains('E')) {
+        for (char c : digits) {
+            if (!std::isdigit(static_cast<unsigned char>(c)) && c != '.' && c != 'e' && c != 'E' && c != '+'
+                && c != '-') {
+                return false;
+            }
+        }
+        const qsizetype dot = digits.indexOf('.');
+        if (dot >= 0 && (dot + 1 >= digits.size() || !std::isdigit(static_cast<unsigned char>(digits[dot + 1])))) {
+            return false;
+        }
+        bool ok = false;
+        const double value = signedDigits.toDouble(&ok);
+        if (!ok) {
+            return false;
+        }
+        out = value;
+        return true;
+    }
+
+    for (char c : digits) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    bool ok = false;
+    const qint64 value = signedDigits.toLongLong(&ok);
+    if (!ok) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+bool parseDateTime(const QByteArray &token, QVariant &out)
+{
+    QString text = QString::fromLatin1(token).toUpper();
+    if (text.size() > 10 && text[10] == QLatin1Char(' ')) {
+        text[10] = QLatin1Char('T');
+    }
+    if (text.size() == 10) {
+        const QDate date = QDate::fromString(text, Qt::ISODate);
+        if (date.isValid()) {
+            out = date;
+            return true;
+        }
+        return false;
+    }
+    if (text.size() >= 8 && text[2] == QLatin1Char(':')) {
+        const QTime time = QTime::fromString(text, Qt::ISODateWithMs);
+        if (time.isValid()) {
+            out = time;
+            return true;
+        }
+        return false;
+    }
+    if (text.size() > 10 && text[10] == QLatin1Char('T')) {
+        const QDateTime dateTime = QDateTime::fromString(text, Qt::ISODateWithMs);
+        if (dateTime.isValid()) {
+            out = dateTime;
+            return true;
+        }
+    }
+    return false;
+}
+
+class Parser
+{
+public:
+    Parser(const QByteArray &data, TomlDocument &document, TomlError &error)
+        : m_data(data)
+        , m_document(document)
+        , m_error(error)
+    {
+    }
+
+    bool parse()
+    {
+        if (m_data.startsWith("\xEF\xBB\xBF")) {
+            m_pos = 3;
+        }
+        while (!atEnd()) {
+            skipSpaces();
+            if (atEnd()) {
+                break;
+            }
+            const char c = peek();
+            if (c != '#' && c != '\n' && c != '\r') {
+                const bool parsed = c == '[' ? parseTableHeader() : parseKeyValue(*m_current, m_currentPath);
+                if (!parsed) {
+                    return false;
+                }
+            }
+            if (!expectLineEnd()) {
+                return false;
+            }
+        }
+        m_document.root = toVariant(m_root).toMap();
+        return true;
+    }
+
+private:
+    bool fail(const QString &message, int line = 0)
+    {
+        m_error.line = line > 0 ? line : m_line;
+        m_error.message = message;
+        return false;
+    }
+
+    bool atEnd() const
+    {
+        return m_pos >= m_data.size();
+    }
+
+    char peek(qsizetype offset = 0) const
+    {
+        return m_pos + offset < m_data.size() ? m_data[m_pos + offset] : '\0';
+    }
+
+    bool startsWith(const char *token) const
+    {
+        for (qsizetype offset = 0; token[offset] != '\0'; ++offset) {
+            if (peek(offset) != token[offset]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void skipSpaces()
+    {
+        while (peek() == ' ' || peek() == '\t') {
+            ++m_pos;
+        }
+    }
+
+    bool consumeNewline()
+    {
+        if (peek() == '\n') {
+            ++m_pos;
+        } else if (peek() == '\r' && peek(1) == '\n') {
+            m_pos += 2;
+        } else {
+            return false;
+        }
+        ++m_line;
+        return true;
+    }
+
+    void skipComment()
+    {
+        while (!atEnd() && peek() != '\n' && peek() != '\r') {
+            ++m_pos;
+        }
+    }
+
+    // Whitespace, comments and newlines, as allowed between array elements.
+    void skipBlankLines()
+    {
+        for (;;) {
+            skipSpaces();
+            if (peek() == '#') {
+                skipComment();
+            }
+            if (!consumeNewline()) {
+                return;
+            }
+        }
+    }
+
+    bool expectLineEnd()
+    {
+        skipSpaces();
+        if (peek() == '#') {
+            skipComment();
+        }
+        if (atEnd() || consumeNewline()) {
+            return true;
+        }
+        return fail(QStringLiteral("unexpected '%1' at end of line").arg(QChar::fromLatin1(peek())));
+    }
+
+    bool parseKey(QStringList &segments)
+    {
+        for (;;) {
+            skipSpaces();
+            QString segment;
+            if (startsWith("\"\"\"") || startsWith("'''")) {
+                return fail(QStringLiteral("multi-line strings cannot be keys"));
+            }
+            if (peek() == '"') {
+                if (!parseBasicString(segment)) {
+                    return false;
+                }
+            } else if (peek() == '\'') {
+                if (!parseLiteralString(segment)) {
+                    return false;
+                }
+            } else {
+                const qsizetype start = m_pos;
+                while (isBareKeyChar(peek())) {
+                    ++m_pos;
+                }
+                if (m_pos == start) {
+                    return fail(QStringLiteral("expected a key"));
+                }
+                segment = QString::fromLatin1(m_data.constData() + start, m_pos - start);
+            }
+            segments.append(segment);
+            skipSpaces();
+            if (peek() != '.') {
+                return true;
+            }
+            ++m_pos;
+        }
+    }
+
+    bool parseKeyValue(Node &table, const QString &tablePath)
+    {
+        const int line = m_line;
+        QStringList keys;
+        if (!parseKey(keys)) {
+            return false;
+        }
+        if (peek() != '=') {
+            return fail(QStringLiteral("expected '=' after key '%1'").arg(keys.join(QLatin1Char('.'))));
+        }
+        ++m_pos;
+        skipSpaces();
+
+        Node *target = &table;
+        QString path = tablePath;
+        for (qsizetype index = 0; index + 1 < keys.size(); ++index) {
+            path = joinPath(path, keys[index]);
+            std::unique_ptr<Node> &slot = target->children[keys[index]];
+            if (!slot) {
+                slot = std::make_unique<Node>(Node::Table);
+                slot->dotted = true;
+                m_document.keyLines.insert(path, line);
+            } else if (slot->kind != Node::Table || slot->defined || slot->sealed) {
+                return fail(QStringLiteral("cannot add keys to '%1'").arg(path), line);
+            }
+            target = slot.get();
+        }
+
+        path = joinPath(path, keys.last());
+        if (target->children.count(keys.last()) != 0) {
+            return fail(QStringLiteral("duplicate key '%1'").arg(path), line);
+        }
+        std::unique_ptr<Node> value;
+        if (!parseValue(value, path)) {
+            return false;
+        }
+        target->children[keys.last()] = std::move(value);
+        m_document.keyLines.insert(path, line);
+        return true;
+    }
+
+    bool parseTableHeader()
+    {
+        const int line = m_line;
+        const bool array = startsWith("[[");
+        m_pos += array ? 2 : 1;
+        QStringList keys;
+        if (!parseKey(keys)) {
+            return false;
+        }
+        if (array ? !startsWith("]]") : peek() != ']') {
+            return fail(QStringLiteral("expected '%1' to close the table header").arg(array ? "]]" : "]"));
+        }
+        m_pos += array ? 2 : 1;
+
+        Node *table = &m_root;
+        QString path;
+        for (qsizetype index = 0; index + 1 < keys.size(); ++index) {
+            path = joinPath(path, keys[index]);
+            std::unique_ptr<Node> &slot = table->children[keys[index]];
+            if (!slot) {
+                slot = std::make_unique<Node>(Node::Table);
+            }
+            Node *next = slot.get();
+            if (next->kind == Node::Array && next->tableArray) {
+                next = next->items.back().get();
+            } else if (next->kind != Node::Table || next->sealed) {
+                return fail(QStringLiteral("'%1' is not a table").arg(path), line);
+            }
+            table = next;
+        }
+
+        path = joinPath(path, keys.last());
+        std::unique_ptr<Node> &slot = table->children[keys.last()];
+        if (array) {
+            if (!slot) {
+                slot = std::make_unique<Node>(Node::Array);
+                slot->tableArray = true;
+            } else if (slot->kind != Node::Array || !slot->tableArray) {
+                return fail(QStringLiteral("'%1' is not an array of tables").arg(path), line);
+            }
+            slot->items.push_back(std::make_unique<Node>(Node::Table));
+            m_current = slot->items.back().get();
+        } else {
+            if (!slot) {
+                slot = std::make_unique<Node>(Node::Table);
+            } else if (slot->kind != Node::Table || slot->defined || slot->dotted || slot->sealed) {
+                return fail(QStringLiteral("table '%1' is defined twice").arg(path), line);
+            }
+            slot->defined = true;
+            m_current = slot.get();
+        }
+        m_currentPath = path;
+        if (!m_document.keyLines.contains(path)) {
+            m_document.keyLines.insert(path, line);
+        }
+        return true;
+    }
+
+    bool parseValue(std::unique_ptr<Node> &out, const QString &path)
+    {
+        const char c = peek();
+        if (c == '[') {
+            return parseArray(out, path);
+        }
+        if (c == '{') {
+            return parseInlineTable(out, path);
+        }
+        QVariant value;
+        if (c == '"' || c == '\'') {
+            QString text;
+            bool parsed = false;
+            if (startsWith("\"\"\"")) {
+                parsed = parseMultilineString('"', text);
+            } else if (startsWith("'''")) {
+                parsed = parseMultilineString('\'', text);
+            } else {
+                parsed = c == '"' ? parseBasicString(text) : parseLiteralString(text);
+            }
+            if (!parsed) {
+                return false;
+            }
+            value = text;
+        } else if (!parseScalar(value)) {
+            return false;
+        }
+        out = std::make_unique<Node>(Node::Value);
+        out->value = value;
+        return true;
+    }
+
+    bool parseEscape(QByteArray &bytes)
+    {
+        const char code = peek(1);
+        m_pos += 2;
+        switch (code) {
+        case 'b':
+            bytes.append('\b');
+            return true;
+        case 't':
+            bytes.append('\t');
+            return true;
+        case 'n':
+            bytes.append('\n');
+            return true;
+        case 'f':
+            bytes.append('\f');
+            return true;
+        case 'r':
+            bytes.append('\r');
+            return true;
+        case '"':
+            bytes.append('"');
+            return true;
+        case '\\':
+            bytes.append('\\');
+            return true;
+        case 'u':
+            return parseUnicodeEscape(4, bytes);
+        case 'U':
+            return parseUnicodeEscape(8, bytes);
+        default:
+            return fail(QStringLiteral("invalid escape '\\%1'").arg(QChar::fromLatin1(code)));
+        }
+    }
+
+    bool parseUnicodeEscape(int digits, QByteArray &bytes)
+    {
+        char32_t codepoint = 0;
+        for (int index = 0; index < digits; ++index) {
+            const char c = peek(index);
+            if (!std::isxdigit(static_cast<unsigned char>(c))) {
+                return fail(QStringLiteral("expected %1 hex digits in unicode escape").arg(digits));
+            }
+            const int nibble = std::isdigit(static_cast<unsigned char>(c))
+                ? c - '0'
+                : (std::tolower(static_cast<unsigned char>(c)) - 'a') + 10;
+            codepoint = (codepoint << 4) | static_cast<char32_t>(nibble);
+        }
+        if (codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+            return fail(QStringLiteral("unicode escape is not a scalar value"));
+        }
+        m_pos += digits;
+        bytes.append(QString::fromUcs4(&codepoint, 1).toUtf8());
+        return true;
+    }
+
+    bool parseBasicString(QString &out)
+    {
+        ++m_pos;
+        QByteArray bytes;
+        for (;;) {
+            if (atEnd() || peek() == '\n' || peek() == '\r') {
+                return fail(QStringLiteral("unterminated string"));
+            }
+            const char c = peek();
+            if (c == '"') {
+                ++m_pos;
+                break;
+            }
+            if (c == '\\') {
+                if (!parseEscape(bytes)) {
+                    return false;
+                }
+                continue;
+            }
+            if (isControl(c)) {
+                return fail(QStringLiteral("control character in string"));
+            }
+            bytes.append(c);
+            ++m_pos;
+        }
+        out = QString::fromUtf8(bytes);
+        return true;
+    }
+
+    bool parseLiteralString(QString &out)
+    {
+        const qsizetype start = ++m_pos;
+        while (peek() != '\'') {
+            if (atEnd() || peek() == '\n' || peek() == '\r') {
+                return fail(QStringLiteral("unterminated string"));
+            }
+            if (isControl(peek())) {
+                return fail(QStringLiteral("control character in string"));
+            }
+            ++m_pos;
+        }
+        out = QString::fromUtf8(m_data.constData() + start, m_pos - start);
+        ++m_pos;
+        return true;
+    }
+
+    // """basic""" (with escapes) or '''literal''' strings spanning lines.
+    bool parseMultilineString(char delimiter, QString &out)
+    {
+        const int line = m_line;
+        const bool basic = delimiter == '"';
+        m_pos += 3;
+        // A newline right after the opening delimiter is not part of the string.
+        consumeNewline();
+        QByteArray bytes;
+        for (;;) {
+            if (atEnd()) {
+                return fail(QStringLiteral("unterminated multi-line string"), line);
+            }
+            const char c = peek();
+            if (c == delimiter && peek(1) == delimiter && peek(2) == delimiter) {
+                // Up to two quotes may sit right before the closing delimiter.
+                int quotes = 3;
+                while (quotes < 5 && peek(quotes) == delimiter) {
+                    ++quotes;
+                }
+                bytes.append(quotes - 3, delimiter);
+                m_pos += quotes;
+                break;
+            }
+            if (consumeNewline()) {
+                bytes.append('\n');
+                continue;
+            }
+            if (basic && c == '\\') {
+                // A backslash ending a line swallows the line break and any
+                // blank space up to the next content.
+                qsizetype ahead = 1;
+                while (peek(ahead) == ' ' || peek(ahead) == '\t') {
+                    ++ahead;
+                }
+                if (peek(ahead) == '\n' || (peek(ahead) == '\r' && peek(ahead + 1) == '\n')) {
+                    m_pos += ahead;
+                    do {
+                        skipSpaces();
+                    } while (consumeNewline());
+                    continue;
+                }
+                if (!parseEscape(bytes)) {
+                    return false;
+                }
+                continue;
+            }
+            if (isControl(c)) {
+                return fail(QStringLiteral("control character in string"));
+            }
+            bytes.append(c);
+            ++m_pos;
+        }
+        out = QString::fromUtf8(bytes);
+        return true;
+    }
+
+    bool parseArray(std::unique_ptr<Node> &out, const QString &path)
+    {
+        const int line = m_line;
+        ++m_pos;
+        auto array = std::make_unique<Node>(Node::Array);
+        for (;;) {
+            skipBlankLines();
+            if (peek() == ']') {
+                ++m_pos;
+                break;
+            }
+            if (atEnd()) {
+                return fail(QStringLiteral("unterminated array"), line);
+            }
+            std::unique_ptr<Node> item;
+            if (!parseValue(item, path)) {
+                return false;
+            }
+            array->items.push_back(std::move(item));
+            skipBlankLines();
+            if (peek() == ',') {
+                ++m_pos;
+                continue;
+            }
+            if (peek() == ']') {
+                ++m_pos;
+                break;
+            }
+            return fail(QStringLiteral("expected ',' or ']' in array"));
+        }
+        out = std::move(array);
+        return true;
+    }
+
+    bool parseInlineTable(std::unique_ptr<Node> &out, const QString &path)
+    {
+        ++m_pos;
+        auto table = std::make_unique<Node>(Node::Table);
+        skipSpaces();
+        if (peek() == '}') {
+            ++m_pos;
+        } else {
+            for (;;) {
+                if (!parseKeyValue(*table, path)) {
+                    return false;
+                }
+                skipSpaces();
+                if (peek() == ',') {
+                    ++m_pos;
+                    skipSpaces();
+                    if (peek() == '}') {
+                        return fail(QStringLiteral("trailing comma in inline table"));
+                    }
+                    continue;
+                }
+                if (peek() == '}') {
+                    ++m_pos;
+                    break;
+                }
+                return fail(QStringLiteral("expected ',' or '}' in inline table"));
+            }
+        }
+        table->sealed = true;
+        out = std::move(table);
+        return true;
+    }
+
+    // Booleans, numbers and date-times: everything up to the next delimiter.
+    bool parseScalar(QVariant &out)
+    {
+        const qsizetype start = m_pos;
+        while (!atEnd() && !isValueTerminator(peek())) {
+            ++m_pos;
+        }
+        // A date-time may separate its date and time with a space.
+        if (m_pos - start == 10 && m_data[start + 4] == '-' && peek() == ' '
+            && std::isdigit(static_cast<unsigned char>(peek(1)))) {
+            ++m_pos;
+            while (!atEnd() && !isValueTerminator(peek())) {
+                ++m_pos;
+            }
+        }
+        const QByteArray token = m_data.mid(start, m_pos - start);
+        if (token.isEmpty()) {
+            return fail(QStringLiteral("expected a value"));
+        }
+        if (token == "true" || token == "false") {
+            out = token == "true";
+            return true;
+        }
+        if (parseNumber(token, out) || parseDateTime(token, out)) {
+            return true;
+        }
+        return fail(QStringLiteral("invalid value '%1'").arg(QString::fromUtf8(token)));
+    }
+
+    const QByteArray &m_data;
+    qsizetype m_pos = 0;
+    int m_line = 1;
+    Node m_root{Node::Table};
+    Node *m_current = &m_root;
+    QString m_currentPath;
+    TomlDocument &m_document;
+    TomlError &m_error;
+};
+
+}
+
+bool parseToml(const QByteArray &data, TomlDocument &document, TomlError &error)
+{
+    document = {};
+    error = {};
+    Parser parser(data, document, error);
+    return parser.parse();
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef TERMINAL_TOML_PARSER_H
+#define TERMINAL_TOML_PARSER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+
+namespace terminal
+{
+
+// A parsed TOML document. Tables are QVariantMaps and arrays QVariantLists;
+// leaves are QString, qint64, double, bool, or QDateTime/QDate/QTime for the
+// date-time types.
+struct TomlDocument
+{
+    QVariantMap root;
+    // Line (1-based) on which each key was defined, by dotted path, e.g.
+    // "font.size" for `size` under [font]. Quoted keys appear unquoted.
+    QHash<QString, int> keyLines;
+};
+
+struct TomlError
+{
+    int line = 0;
+    QString message;
+};
+
+// Parses a TOML 1.0 document from UTF-8. Stops at the first syntax or
+// redefinition error and returns false with error filled in.
+bool parseToml(const QByteArray &data, TomlDocument &document, TomlError &error);
+
+}
+#endif
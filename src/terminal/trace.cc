@@ -0,0 +1,202 @@
+#include "trace.h"
+
+#include <QFile>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace terminal
+{
+
+namespace detail
+{
+std::atomic<bool> g_traceEnabled{false};
+}
+
+namespace {
+
+// Power of two so the slot index is a mask of the sequence number.
+constexpr std::uint64_t kRingSize = 1 << 16;
+constexpr auto kDrainInterval = std::chrono::milliseconds(20);
+constexpr char kMagic[8] = {'K', 'C', 'T', 'R', 'A', 'C', 'E', '1'};
+
+// On-disk record, little-endian.
+struct FileRecord
+{
+    std::uint64_t timestamp;
+    std::uint32_t event;
+    std::uint32_t reserved;
+    std::int64_t value;
+};
+static_assert(sizeof(FileRecord) == 24, "trace records are 24 bytes on disk");
+
+struct Slot
+{
+    // Ticket of the record in the slot plus one; 0 while never written. A
+    // writer stores it last, so a reader that sees the same ticket before and
+    // after copying the payload has a consistent record.
+    std::atomic<std::uint64_t> ticket{0};
+    std::atomic<std::uint64_t> timestamp{0};
+    std::atomic<std::uint32_t> event{0};
+    std::atomic<std::int64_t> value{0};
+};
+
+class TraceRing
+{
+public:
+    void push(TraceEvent event, std::int64_t value)
+    {
+        const std::uint64_t ticket = m_head.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = m_slots[ticket & (kRingSize - 1)];
+        // Invalidate first so a reader racing this overwrite discards the slot.
+        slot.ticket.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.timestamp.store(now(), std::memory_order_relaxed);
+        slot.event.store(static_cast<std::uint32_t>(event), std::memory_order_relaxed);
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.ticket.store(ticket + 1, std::memory_order_release);
+    }
+
+    // Copies out records in order from the reader's position; returns how many
+    // were written to output and adds overwritten ones to dropped.
+    size_t drain(FileRecord *output, size_t capacity, std::uint64_t *dropped)
+    {
+        size_t count = 0;
+        const std::uint64_t head = m_head.load(std::memory_order_acquire);
+        if (head - m_tail > kRingSize) {
+            *dropped += (head - m_tail) - kRingSize;
+            m_tail = head - kRingSize;
+        }
+        while (m_tail < head && count < capacity) {
+            Slot &slot = m_slots[m_tail & (kRingSize - 1)];
+            const std::uint64_t ticket = slot.ticket.load(std::memory_order_acquire);
+            if (ticket < m_tail + 1) {
+                // Claimed but not yet published; pick it up next time.
+                break;
+            }
+            FileRecord record{};
+            record.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+            record.event = slot.event.load(std::memory_order_relaxed);
+            record.value = slot.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (ticket != m_tail + 1 || slot.ticket.load(std::memory_order_relaxed) != ticket) {
+                // Overwritten by a producer that lapped the reader.
+                ++*dropped;
+            } else {
+                output[count++] = record;
+            }
+            ++m_tail;
+        }
+        return count;
+    }
+
+    static std::uint64_t now()
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count());
+    }
+
+private:
+    std::array<Slot, kRingSize> m_slots;
+    std::atomic<std::uint64_t> m_head{0};
+    // Only the writer thread touches the tail.
+    std::uint64_t m_tail = 0;
+};
+
+class TraceWriter
+{
+public:
+    TraceWriter(std::FILE *file, TraceRing &ring)
+        : m_file(file)
+        , m_ring(ring)
+        , m_thread([this]() { run(); })
+    {
+    }
+
+    ~TraceWriter()
+    {
+        m_running.store(false, std::memory_order_relaxed);
+        m_thread.join();
+        std::fclose(m_file);
+    }
+
+private:
+    void run()
+    {
+        while (m_running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(kDrainInterval);
+            drain();
+        }
+        drain();
+        std::fflush(m_file);
+    }
+
+    void drain()
+    {
+        std::uint64_t dropped = 0;
+        size_t count = 0;
+        while ((count = m_ring.drain(m_buffer.data(), m_buffer.size(), &dropped)) > 0) {
+            std::fwrite(m_buffer.data(), sizeof(FileRecord), count, m_file);
+        }
+        if (dropped > 0) {
+            const FileRecord record{TraceRing::now(), static_cast<std::uint32_t>(TraceEvent::Dropped), 0,
+                                    static_cast<std::int64_t>(dropped)};
+            std::fwrite(&record, sizeof(record), 1, m_file);
+        }
+    }
+
+    std::FILE *m_file;
+    TraceRing &m_ring;
+    std::array<FileRecord, 4096> m_buffer{};
+    std::atomic<bool> m_running{true};
+    std::thread m_thread;
+};
+
+TraceRing &ring()
+{
+    static const auto instance = std::make_unique<TraceRing>();
+    return *instance;
+}
+
+std::unique_ptr<TraceWriter> g_writer;
+
+}
+
+bool startTrace(const QString &path)
+{
+    stopTrace();
+    std::FILE *file = std::fopen(QFile::encodeName(path).constData(), "wb");
+    if (!file) {
+        return false;
+    }
+    // Header: magic, then the record size so the decoder can check layout.
+    const std::uint32_t recordSize = sizeof(FileRecord);
+    std::fwrite(kMagic, sizeof(kMagic), 1, file);
+    std::fwrite(&recordSize, sizeof(recordSize), 1, file);
+    g_writer = std::make_unique<TraceWriter>(file, ring());
+    detail::g_traceEnabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void stopTrace()
+{
+    detail::g_traceEnabled.store(false, std::memory_order_relaxed);
+    g_writer.reset();
+}
+
+namespace detail
+{
+
+void recordTrace(TraceEvent event, std::int64_t value)
+{
+    ring().push(event, value);
+}
+
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef TERMINAL_TRACE_H
+#define TERMINAL_TRACE_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+namespace terminal
+{
+
+// Compact binary trace of high-frequency events, for production sessions
+// where text logging per event would cost too much. Recording is a handful
+// of stores into a fixed lock-free ring; a background thread drains the ring
+// to the trace file. When producers outrun the writer the oldest records are
+// overwritten and counted as dropped (a lower bound: records overwritten
+// while still being written are lost without a count). Decode files with
+// scripts/decode_trace.py.
+enum class TraceEvent : std::uint32_t {
+    PtyRead = 1,      // bytes
+    Parse = 2,        // nanoseconds
+    DirtyCells = 3,   // cells handed to the renderer
+    FrameTime = 4,    // nanoseconds from frame request to swap
+    KeyLatency = 5,   // nanoseconds from key press to photon
+    Dropped = 255,    // records lost to overruns since the last one
+};
+
+// Starts recording into path, replacing any earlier file; false if the file
+// cannot be created.
+bool startTrace(const QString &path);
+// Flushes what is queued and closes the file.
+void stopTrace();
+
+namespace detail
+{
+extern std::atomic<bool> g_traceEnabled;
+void recordTrace(TraceEvent event, std::int64_t value);
+}
+
+inline void trace(TraceEvent event, std::int64_t value)
+{
+    if (detail::g_traceEnabled.load(std::memory_order_relaxed)) {
+        detail::recordTrace(event, value);
+    }
+}
+
+}
+#endif
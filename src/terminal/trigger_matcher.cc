@@ -0,0 +1,146 @@
+#include "trigger_matcher.h"
+
+#include "text_matcher.h"
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace terminal
+{
+
+void TriggerMatcher::build(const QVector<TriggerConfig> &triggers)
+{
+    m_patterns.clear();
+    m_classCount = 1;
+    m_asciiClasses.fill(0);
+    m_otherClasses.clear();
+
+    // Input classes: 0 for characters no pattern uses, then one per folded
+    // character. ASCII upper case maps straight to the lower-case class.
+    QVector<QVector<int>> classStrings;
+    for (const TriggerConfig &trigger : triggers) {
+        Pattern pattern{{}, trigger.caseSensitive};
+        QVector<int> classes;
+        for (const uint codepoint : trigger.pattern.toUcs4()) {
+            pattern.codepoints.append(codepoint);
+            const char32_t folded = foldCase(codepoint);
+            int cls = classOf(folded);
+            if (cls == 0) {
+                cls = m_classCount++;
+                if (folded < 0x80) {
+                    m_asciiClasses[folded] = static_cast<quint16>(cls);
+                    if (folded >= U'a' && folded <= U'z') {
+                        m_asciiClasses[folded - (U'a' - U'A')] = static_cast<quint16>(cls);
+                    }
+                } else {
+                    m_otherClasses.insert(folded, cls);
+                }
+            }
+            classes.append(cls);
+        }
+        m_patterns.append(pattern);
+        classStrings.append(classes);
+    }
+
+    // The trie, one node per distinct pattern prefix.
+    std::vector<std::map<int, int>> children(1);
+    std::vector<QVector<int>> outputs(1);
+    for (int index = 0; index < classStrings.size(); ++index) {
+        int state = 0;
+        for (const int cls : std::as_const(classStrings[index])) {
+            const auto found = children[state].find(cls);
+            if (found != children[state].end()) {
+                state = found->second;
+                continue;
+            }
+            const int next = static_cast<int>(children.size());
+            children[state].emplace(cls, next);
+            children.emplace_back();
+            outputs.emplace_back();
+            state = next;
+        }
+        if (!classStrings[index].isEmpty()) {
+            outputs[state].append(index);
+        }
+    }
+
+    // Breadth first, so a state's failure link (always shallower) is complete
+    // before the state itself: missing edges borrow the failure state's, and
+    // outputs include everything that ends at a suffix of the state.
+    const int stateCount = static_cast<int>(children.size());
+    m_transitions.fill(0, stateCount * m_classCount);
+    std::vector<int> failure(stateCount, 0);
+    std::vector<int> queue;
+    queue.reserve(stateCount);
+    queue.push_back(0);
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        const int state = queue[head];
+        for (int cls = 0; cls < m_classCount; ++cls) {
+            const auto child = children[state].find(cls);
+            const int borrowed = state == 0 ? 0 : m_transitions[failure[state] * m_classCount + cls];
+            if (child == children[state].end()) {
+                m_transitions[state * m_classCount + cls] = borrowed;
+                continue;
+            }
+            const int next = child->second;
+            failure[next] = borrowed;
+            outputs[next] += outputs[borrowed];
+            m_transitions[state * m_classCount + cls] = next;
+            queue.push_back(next);
+        }
+    }
+
+    m_outputBegin.clear();
+    m_outputs.clear();
+    for (const QVector<int> &stateOutputs : outputs) {
+        m_outputBegin.append(static_cast<int>(m_outputs.size()));
+        m_outputs += stateOutputs;
+    }
+    m_outputBegin.append(static_cast<int>(m_outputs.size()));
+}
+
+int TriggerMatcher::classOf(char32_t folded) const
+{
+    if (folded < 0x80) {
+        return m_asciiClasses[folded];
+    }
+    return m_otherClasses.value(folded, 0);
+}
+
+void TriggerMatcher::match(const Cell *cells, int length, QVector<TriggerHit> &hits)
+{
+    if (isEmpty() || !cells) {
+        return;
+    }
+    m_text.resize(0);
+    m_columns.resize(0);
+    int state = 0;
+    for (int column = 0; column < length; ++column) {
+        const char32_t codepoint = cells[column].codepoint;
+        if (codepoint == kWideCharContinuation) {
+            continue;
+        }
+        m_text.append(codepoint);
+        m_columns.append(column);
+        const int cls = codepoint < 0x80 ? m_asciiClasses[codepoint] : classOf(foldCase(codepoint));
+        state = m_transitions[state * m_classCount + cls];
+
+        const int outputEnd = m_outputBegin[state + 1];
+        for (int output = m_outputBegin[state]; output < outputEnd; ++output) {
+            const Pattern &pattern = m_patterns[m_outputs[output]];
+            const int patternLength = static_cast<int>(pattern.codepoints.size());
+            const int start = static_cast<int>(m_text.size()) - patternLength;
+            if (pattern.caseSensitive
+                && std::memcmp(m_text.constData() + start, pattern.codepoints.constData(),
+                               sizeof(char32_t) * patternLength) != 0) {
+                continue;
+            }
+            const bool wide = column + 1 < length && cells[column + 1].codepoint == kWideCharContinuation;
+            const int endColumn = column + (wide ? 2 : 1);
+            hits.append({m_outputs[output], m_columns[start], endColumn - m_columns[start]});
+        }
+    }
+}
+
+}
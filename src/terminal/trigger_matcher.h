@@ -0,0 +1,62 @@
+#ifndef TERMINAL_TRIGGER_MATCHER_H
+#define TERMINAL_TRIGGER_MATCHER_H
+
+#include "config.h"
+#include "screen_buffer.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <array>
+
+namespace terminal
+{
+
+// Trigger index and the columns [column, column + length) it matched.
+struct TriggerHit
+{
+    int trigger;
+    int column;
+    int length;
+};
+
+// All trigger patterns compiled into one Aho-Corasick automaton, so a line is
+// read once however many triggers there are. Characters that occur in no
+// pattern share one input class, which keeps the transition table to a few
+// dozen columns; case is folded on the way in and case-sensitive patterns are
+// checked against the original text when they hit.
+class TriggerMatcher
+{
+public:
+    void build(const QVector<TriggerConfig> &triggers);
+    bool isEmpty() const { return m_patterns.isEmpty(); }
+
+    // Appends every occurrence of every pattern in cells[0, length) to hits.
+    void match(const Cell *cells, int length, QVector<TriggerHit> &hits);
+
+private:
+    int classOf(char32_t folded) const;
+
+    struct Pattern
+    {
+        QVector<char32_t> codepoints;
+        bool caseSensitive;
+    };
+
+    QVector<Pattern> m_patterns;
+    int m_classCount = 1;
+    std::array<quint16, 128> m_asciiClasses{};
+    QHash<char32_t, int> m_otherClasses;
+    // State s on class c goes to m_transitions[s * m_classCount + c].
+    QVector<int> m_transitions;
+    // Patterns ending in state s: m_outputs[m_outputBegin[s], m_outputBegin[s + 1]).
+    QVector<int> m_outputBegin;
+    QVector<int> m_outputs;
+
+    // The current line without continuation cells, and their columns.
+    QVector<char32_t> m_text;
+    QVector<int> m_columns;
+};
+
+}
+#endif
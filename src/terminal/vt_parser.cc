@@ -1,5 +1,10 @@
 #include "vt_parser.h"
 
+#include "char_width.h"
+#include "profiling.h"
+#include "prompt_index.h"
+#include "scrollback.h"
+
 #include <QtGlobal>
 
 namespace terminal
@@ -17,9 +22,45 @@ bool isParameter(char byte)
     return byte >= 0x30 && byte <= 0x3F;
 }
 
-bool isUtf8Start(char byte)
+constexpr char32_t kReplacementCharacter = 0xFFFD;
+constexpr int kTabWidth = 8;
+// Bounds on what a CSI sequence may carry; the excess is dropped. The
+// parameter count matches the width of the sub-parameter mask.
+constexpr qsizetype kMaxParams = 32;
+constexpr int kMaxParamValue = 65535;
+
+// DEC special graphics for 0x60..0x7E, as drawn by xterm.
+constexpr char32_t kDecSpecialGraphics[] = {
+    0x25C6, 0x2592, 0x2409, 0x240C, 0x240D, 0x240A, 0x00B0, 0x00B1,
+    0x2424, 0x240B, 0x2518, 0x2510, 0x250C, 0x2514, 0x253C, 0x23BA,
+    0x23BB, 0x2500, 0x23BC, 0x23BD, 0x251C, 0x2524, 0x2534, 0x252C,
+    0x2502, 0x2264, 0x2265, 0x03C0, 0x2260, 0x00A3, 0x00B7,
+};
+
+// xterm's 256-colour palette as 0x00RRGGBB.
+quint32 paletteColor(int index)
+{
+    static constexpr quint32 kBaseColors[16] = {
+        0x000000, 0xCD0000, 0x00CD00, 0xCDCD00, 0x0000EE, 0xCD00CD, 0x00CDCD, 0xE5E5E5,
+        0x7F7F7F, 0xFF0000, 0x00FF00, 0xFFFF00, 0x5C5CFF, 0xFF00FF, 0x00FFFF, 0xFFFFFF,
+    };
+    index = qBound(0, index, 255);
+    if (index < 16) {
+        return kBaseColors[index];
+    }
+    if (index < 232) {
+        const auto level = [](int value) { return static_cast<quint32>(value == 0 ? 0 : 55 + (value * 40)); };
+        const int cube = index - 16;
+        return (level(cube / 36) << 16) | (level((cube / 6) % 6) << 8) | level(cube % 6);
+    }
+    const auto grey = static_cast<quint32>(8 + ((index - 232) * 10));
+    return (grey << 16) | (grey << 8) | grey;
+}
+
+quint32 rgbColor(int red, int green, int blue)
 {
-    return static_cast<unsigned char>(byte) >= 0xC2;
+    return (static_cast<quint32>(qBound(0, red, 255)) << 16) | (static_cast<quint32>(qBound(0, green, 255)) << 8)
+        | static_cast<quint32>(qBound(0, blue, 255));
 }
 
 }
@@ -35,16 +76,28 @@ void VtParser::reset()
 {
     m_state = ParserState::Ground;
     m_params.clear();
+    m_subParamMask = 0;
     m_intermediates.clear();
+    m_privateMarker = 0;
     m_oscData.clear();
     m_dcsData.clear();
-    m_utf8Buffer.clear();
+    m_utf8Codepoint = 0;
+    m_utf8Remaining = 0;
+    m_attributes = {};
+    m_lastPrinted = 0;
+    m_g0LineDrawing = false;
+    m_g1LineDrawing = false;
+    m_shiftOut = false;
     m_savedRow = 0;
     m_savedColumn = 0;
+    m_savedAttributes = {};
     m_originMode = false;
-    m_autoWrap = true;
+    m_primary.get().setAutoWrap(true);
+    m_alternate.get().setAutoWrap(true);
     m_insertMode = false;
     m_bracketedPaste = false;
+    m_applicationCursorKeys = false;
+    m_cursorVisible = true;
     m_useAlternateScreen = false;
 }
 
@@ -55,13 +108,20 @@ void VtParser::feed(const QByteArray &data)
 
 void VtParser::feed(const char *data, int length)
 {
+    PROFILE_FUNCTION();
     for (int i = 0; i < length; ++i) {
         const char byte = data[i];
+        // CAN and SUB abandon any sequence in progress.
+        if (m_state != ParserState::Ground && (byte == 0x18 || byte == 0x1A)) {
+            m_state = ParserState::Ground;
+            continue;
+        }
         switch (m_state) {
         case ParserState::Ground:
             handleGround(byte);
             break;
         case ParserState::Escape:
+        case ParserState::EscapeIntermediate:
             handleEscape(byte);
             break;
         case ParserState::CsiEntry:
@@ -94,57 +154,120 @@ void VtParser::feed(const char *data, int length)
 
 void VtParser::handleGround(char byte)
 {
-    if (byte == 0x1B) { // ESC
+    const auto value = static_cast<unsigned char>(byte);
+    if (value == 0x1B) { // ESC
         flushUtf8Buffer();
-        m_state = ParserState::Escape;
+        enterEscape();
         return;
     }
 
-    if (byte <= 0x1F || byte == 0x7F) {
+    if (value <= 0x1F || value == 0x7F) {
         flushUtf8Buffer();
         executeControl(byte);
         return;
     }
 
-    if (isUtf8Start(byte) || !m_utf8Buffer.isEmpty()) {
-        m_utf8Buffer.append(byte);
-        if (QByteArray::fromRawData(m_utf8Buffer.constData(), m_utf8Buffer.size()).isEmpty()) {
+    printByte(value);
+}
+
+void VtParser::printByte(unsigned char byte)
+{
+    // Incremental UTF-8 decoding: sequences split across reads resume here on
+    // the next feed() instead of being decoded chunk by chunk.
+    if (m_utf8Remaining > 0) {
+        if ((byte & 0xC0) == 0x80) {
+            m_utf8Codepoint = (m_utf8Codepoint << 6) | (byte & 0x3F);
+            if (--m_utf8Remaining == 0) {
+                const bool valid = m_utf8Codepoint <= 0x10FFFF
+                    && (m_utf8Codepoint < 0xD800 || m_utf8Codepoint > 0xDFFF);
+                print(valid ? m_utf8Codepoint : kReplacementCharacter);
+            }
             return;
         }
+        flushUtf8Buffer();
+    }
+
+    if (byte < 0x80) {
+        print(byte);
+    } else if (byte >= 0xC2 && byte <= 0xDF) {
+        m_utf8Codepoint = byte & 0x1F;
+        m_utf8Remaining = 1;
+    } else if (byte >= 0xE0 && byte <= 0xEF) {
+        m_utf8Codepoint = byte & 0x0F;
+        m_utf8Remaining = 2;
+    } else if (byte >= 0xF0 && byte <= 0xF4) {
+        m_utf8Codepoint = byte & 0x07;
+        m_utf8Remaining = 3;
     } else {
-        m_utf8Buffer.append(byte);
+        print(kReplacementCharacter);
     }
+}
 
-    flushUtf8Buffer();
+void VtParser::print(char32_t codepoint)
+{
+    if (codepoint >= 0x60 && codepoint <= 0x7E && (m_shiftOut ? m_g1LineDrawing : m_g0LineDrawing)) {
+        codepoint = kDecSpecialGraphics[codepoint - 0x60];
+    }
+    ScreenBuffer &screen = activeScreen();
+    if (m_insertMode) {
+        screen.insertCells(characterWidth(codepoint));
+    }
+    screen.writeGlyph(codepoint, m_attributes);
+    m_lastPrinted = codepoint;
+}
+
+void VtParser::enterEscape()
+{
+    m_intermediates.clear();
+    m_state = ParserState::Escape;
 }
 
 void VtParser::handleEscape(char byte)
 {
-    if (byte == '[') {
-        m_params.clear();
-        m_intermediates.clear();
-        m_state = ParserState::CsiEntry;
+    const auto value = static_cast<unsigned char>(byte);
+    if (value == 0x1B) {
+        enterEscape();
         return;
     }
-
-    if (byte == ']') {
-        m_oscData.clear();
-        m_state = ParserState::OscString;
+    if (value <= 0x1F) {
+        executeControl(byte);
         return;
     }
-
-    if (byte == 'P') {
-        m_dcsData.clear();
-        m_state = ParserState::DcsEntry;
+    if (isIntermediate(byte)) {
+        collectIntermediate(byte);
+        m_state = ParserState::EscapeIntermediate;
         return;
     }
 
-    if (byte == 'X' || byte == '^' || byte == '_') {
-        m_state = ParserState::SosPmApcString;
-        return;
+    if (m_state == ParserState::Escape) {
+        if (byte == '[') {
+            m_params.clear();
+            m_subParamMask = 0;
+            m_intermediates.clear();
+            m_privateMarker = 0;
+            m_state = ParserState::CsiEntry;
+            return;
+        }
+
+        if (byte == ']') {
+            m_oscData.clear();
+            m_state = ParserState::OscString;
+            return;
+        }
+
+        if (byte == 'P') {
+            m_dcsData.clear();
+            m_state = ParserState::DcsEntry;
+            return;
+        }
+
+        if (byte == 'X' || byte == '^' || byte == '_') {
+            m_state = ParserState::SosPmApcString;
+            return;
+        }
     }
 
-    executeControl(byte);
+    dispatchEscape(byte);
     m_state = ParserState::Ground;
 }
 
@@ -183,13 +306,13 @@ void VtParser::handleCsi(char byte)
     }
 
     if (byte >= 0x40 && byte <= 0x7E) {
-        dispatchCsi();
+        dispatchCsi(byte);
         m_state = ParserState::Ground;
         return;
     }
 
     if (byte == 0x1B) {
-        m_state = ParserState::Escape;
+        enterEscape();
         return;
     }
 
@@ -206,8 +329,10 @@ void VtParser::handleOsc(char byte)
         return;
     }
 
+    // ESC starts the ST terminator; the backslash after it is ignored.
     if (byte == 0x1B) {
-        m_state = ParserState::Escape;
+        dispatchOsc();
+        enterEscape();
         return;
     }
 
@@ -248,7 +373,7 @@ void VtParser::handleDcs(char byte)
     }
 
     if (byte == 0x1B) {
-        m_state = ParserState::Escape;
+        enterEscape();
         return;
     }
 
@@ -264,30 +389,66 @@ void VtParser::handleDcs(char byte)
 
 void VtParser::flushUtf8Buffer()
 {
-    if (m_utf8Buffer.isEmpty()) {
+    if (m_utf8Remaining == 0) {
         return;
     }
 
-    const QString text = QString::fromUtf8(m_utf8Buffer.constData(), m_utf8Buffer.size());
-    m_utf8Buffer.clear();
-
-    CellAttributes attrs;
-    activeScreen().writeText(text, attrs);
+    // An interrupted sequence is rendered as a single replacement character.
+    m_utf8Remaining = 0;
+    m_utf8Codepoint = 0;
+    print(kReplacementCharacter);
 }
 
 void VtParser::executeControl(char byte)
 {
-    Q_UNUSED(byte);
-    // TODO: Implement C0/C1 control handling (BEL, BS, HT, LF, CR, etc.).
+    ScreenBuffer &screen = activeScreen();
+    switch (byte) {
+    case 0x08: // BS
+        screen.backspace();
+        break;
+    case 0x09: // HT
+        screen.horizontalTab();
+        break;
+    case 0x0A: // LF
+    case 0x0B: // VT
+    case 0x0C: // FF
+        screen.lineFeed();
+        break;
+    case 0x0D: // CR
+        screen.carriageReturn();
+        break;
+    case 0x0E: // SO
+        m_shiftOut = true;
+        break;
+    case 0x0F: // SI
+        m_shiftOut = false;
+        break;
+    default:
+        // NUL, ENQ, BEL and the rest leave the screen alone: there is no
+        // answerback and no bell. 8-bit C1 controls never get here, since in
+        // UTF-8 those bytes are continuation bytes.
+        break;
+    }
 }
 
 void VtParser::collectParam(char byte)
 {
-    if (byte == ';') {
+    if (byte >= '<' && byte <= '?') {
+        if (m_params.isEmpty()) {
+            m_privateMarker = byte;
+        }
+        return;
+    }
+    if (byte == ';' || byte == ':') {
         if (m_params.isEmpty()) {
             m_params.append(0);
         }
-        m_params.append(0);
+        if (m_params.size() < kMaxParams) {
+            if (byte == ':') {
+                m_subParamMask |= 1u << m_params.size();
+            }
+            m_params.append(0);
+        }
         return;
     }
 
@@ -295,7 +456,7 @@ void VtParser::collectParam(char byte)
         m_params.append(0);
     }
 
-    m_params.last() = (m_params.last() * 10) + (byte - '0');
+    m_params.last() = qMin(kMaxParamValue, (m_params.last() * 10) + (byte - '0'));
 }
 
 void VtParser::collectIntermediate(char byte)
@@ -313,29 +474,482 @@ void VtParser::collectDcs(char byte)
     m_dcsData.append(byte);
 }
 
-void VtParser::dispatchCsi()
+void VtParser::dispatchEscape(char finalByte)
 {
-    // TODO: Interpret CSI sequences using m_params, m_intermediates, and the final byte.
+    if (!m_intermediates.isEmpty()) {
+        // ESC ( 0 and ESC ) 0 designate line drawing into G0 and G1; any
+        // other final byte there means ASCII. G2/G3, DECALN and the like
+        // are not supported.
+        if (m_intermediates == "(") {
+            m_g0LineDrawing = finalByte == '0';
+        } else if (m_intermediates == ")") {
+            m_g1LineDrawing = finalByte == '0';
+        }
+        return;
+    }
+
+    ScreenBuffer &screen = activeScreen();
+    switch (finalByte) {
+    case '7': // DECSC
+        saveCursor();
+        break;
+    case '8': // DECRC
+        restoreCursor();
+        break;
+    case 'D': // IND
+        screen.lineFeed();
+        break;
+    case 'E': // NEL
+        screen.carriageReturn();
+        screen.lineFeed();
+        break;
+    case 'M': // RI
+        screen.reverseIndex();
+        break;
+    case 'c': // RIS
+        fullReset();
+        break;
+    default:
+        // Keypad modes (ESC =, ESC >) and the ST ending a string change
+        // nothing on screen.
+        break;
+    }
+}
+
+void VtParser::dispatchCsi(char finalByte)
+{
+    PROFILE_FUNCTION();
+    if (m_privateMarker == '?' && m_intermediates.isEmpty() && (finalByte == 'h' || finalByte == 'l')) {
+        for (const int mode : std::as_const(m_params)) {
+            setPrivateMode(mode, finalByte == 'h');
+        }
+        return;
+    }
+    // Other private and intermediate forms (cursor style, XTVERSION, ...)
+    // do not affect the screen. Only SGR defines ':' sub-parameters; any
+    // other sequence carrying them is malformed and dropped whole.
+    if (m_privateMarker != 0 || !m_intermediates.isEmpty() || (m_subParamMask != 0 && finalByte != 'm')) {
+        return;
+    }
+
+    ScreenBuffer &screen = activeScreen();
+    const int row = screen.cursorRow();
+    // The cursor may sit one past the last column with a wrap pending.
+    const int column = qMin(screen.cursorColumn(), screen.columns() - 1);
+    const int count = param(0, 1);
+    switch (finalByte) {
+    case 'A': { // CUU
+        const int top = row >= screen.marginTop() ? screen.marginTop() : 0;
+        screen.moveCursor(qMax(top, row - count), column);
+        break;
+    }
+    case 'B': { // CUD
+        const int bottom = row <= screen.marginBottom() ? screen.marginBottom() : screen.rows() - 1;
+        screen.moveCursor(qMin(bottom, row + count), column);
+        break;
+    }
+    case 'C': // CUF
+        screen.moveCursor(row, column + count);
+        break;
+    case 'D': // CUB
+        screen.moveCursor(row, column - count);
+        break;
+    case 'E': // CNL
+        screen.moveCursor(row + count, 0);
+        break;
+    case 'F': // CPL
+        screen.moveCursor(row - count, 0);
+        break;
+    case 'G': // CHA
+    case '`': // HPA
+        screen.moveCursor(row, count - 1);
+        break;
+    case 'H': // CUP
+    case 'f': // HVP
+        cursorTo(count - 1, param(1, 1) - 1);
+        break;
+    case 'd': // VPA
+        cursorTo(count - 1, column);
+        break;
+    case 'I': // CHT
+        for (int tab = 0; tab < count && screen.cursorColumn() < screen.columns() - 1; ++tab) {
+            screen.horizontalTab();
+        }
+        break;
+    case 'Z': { // CBT
+        int target = column;
+        for (int tab = 0; tab < count && target > 0; ++tab) {
+            target = ((target - 1) / kTabWidth) * kTabWidth;
+        }
+        screen.moveCursor(row, target);
+        break;
+    }
+    case 'J': // ED
+        switch (param(0, 0)) {
+        case 0:
+            screen.clearFromCursor();
+            for (int below = row + 1; below < screen.rows(); ++below) {
+                screen.clearRow(below);
+            }
+            break;
+        case 1:
+            screen.clearToCursor();
+            for (int above = 0; above < row; ++above) {
+                screen.clearRow(above);
+            }
+            break;
+        case 2:
+            for (int any = 0; any < screen.rows(); ++any) {
+                screen.clearRow(any);
+            }
+            break;
+        default:
+            // ED 3 would erase the scrollback; history is only ever dropped
+            // by its size limit, so search results and command marks stay
+            // valid.
+            break;
+        }
+        break;
+    case 'K': // EL
+        switch (param(0, 0)) {
+        case 0:
+            screen.clearFromCursor();
+            break;
+        case 1:
+            screen.clearToCursor();
+            break;
+        case 2:
+            screen.clearRow(row);
+            break;
+        default:
+            break;
+        }
+        break;
+    case '@': // ICH
+        screen.insertCells(count);
+        break;
+    case 'P': // DCH
+        screen.deleteCells(count);
+        break;
+    case 'X': // ECH
+        screen.eraseCells(count);
+        break;
+    case 'L': // IL
+        screen.insertLines(count);
+        break;
+    case 'M': // DL
+        screen.deleteLines(count);
+        break;
+    case 'S': // SU
+        screen.scrollUp(count);
+        break;
+    case 'T': // SD
+        screen.scrollDown(count);
+        break;
+    case 'b': // REP
+        if (m_lastPrinted != 0) {
+            const int repeats = qMin(count, screen.rows() * screen.columns());
+            for (int repeat = 0; repeat < repeats; ++repeat) {
+                screen.writeGlyph(m_lastPrinted, m_attributes);
+            }
+        }
+        break;
+    case 'r': // DECSTBM
+        screen.setMargin(count - 1, param(1, screen.rows()) - 1);
+        cursorTo(0, 0);
+        break;
+    case 's':
+        saveCursor();
+        break;
+    case 'u':
+        restoreCursor();
+        break;
+    case 'h': // SM
+    case 'l': // RM
+        for (const int mode : std::as_const(m_params)) {
+            if (mode == 4) { // IRM
+                m_insertMode = finalByte == 'h';
+            }
+        }
+        break;
+    case 'm':
+        dispatchSgr();
+        break;
+    default:
+        // Reports (DSR, DA, window ops) would need a way to answer on the
+        // PTY, which the parser does not have; they are ignored.
+        break;
+    }
+}
+
+void VtParser::dispatchSgr()
+{
+    if (m_params.isEmpty()) {
+        m_attributes = {};
+        return;
+    }
+    const CellAttributes defaults;
+    for (qsizetype index = 0; index < m_params.size(); ++index) {
+        const int code = m_params[index];
+        if (const qsizetype subParams = subParamCount(index)) {
+            dispatchSgrSubParams(code, index + 1, subParams);
+            index += subParams;
+            continue;
+        }
+        switch (code) {
+        case 0:
+            m_attributes = defaults;
+            break;
+        case 1:
+            m_attributes.bold = true;
+            break;
+        case 3:
+            m_attributes.italic = true;
+            break;
+        case 4:
+        case 21:
+            m_attributes.underline = true;
+            break;
+        case 5:
+        case 6:
+            m_attributes.blink = true;
+            break;
+        case 7:
+            m_attributes.inverse = true;
+            break;
+        case 8:
+            m_attributes.invisible = true;
+            break;
+        case 22:
+            m_attributes.bold = false;
+            break;
+        case 23:
+            m_attributes.italic = false;
+            break;
+        case 24:
+            m_attributes.underline = false;
+            break;
+        case 25:
+            m_attributes.blink = false;
+            break;
+        case 27:
+            m_attributes.inverse = false;
+            break;
+        case 28:
+            m_attributes.invisible = false;
+            break;
+        case 38:
+        case 48: {
+            quint32 color = 0;
+            const int used = extendedColor(index + 1, &color);
+            if (used < 0) {
+                // A malformed colour leaves the rest of the list ambiguous.
+                return;
+            }
+            (code == 38 ? m_attributes.foreground : m_attributes.background) = color;
+            index += used;
+            break;
+        }
+        case 39:
+            m_attributes.foreground = defaults.foreground;
+            break;
+        case 49:
+            m_attributes.background = defaults.background;
+            break;
+        default:
+            if (code >= 30 && code <= 37) {
+                m_attributes.foreground = paletteColor(code - 30);
+            } else if (code >= 40 && code <= 47) {
+                m_attributes.background = paletteColor(code - 40);
+            } else if (code >= 90 && code <= 97) {
+                m_attributes.foreground = paletteColor(code - 90 + 8);
+            } else if (code >= 100 && code <= 107) {
+                m_attributes.background = paletteColor(code - 100 + 8);
+            }
+            // Faint, framed, overline and the like are not drawn.
+            break;
+        }
+    }
+}
+
+// The ':' forms: 4:n picks an underline style (0 is none), and 38/48 take
+// 5:n, 2:r:g:b or 2:colorspace:r:g:b. Sub-parameters of other codes are
+// skipped along with the code.
+void VtParser::dispatchSgrSubParams(int code, qsizetype first, qsizetype count)
+{
+    if (code == 4) {
+        m_attributes.underline = m_params[first] != 0;
+        return;
+    }
+    if (code != 38 && code != 48) {
+        return;
+    }
+    quint32 color = 0;
+    if (m_params[first] == 5 && count == 2) {
+        color = paletteColor(m_params[first + 1]);
+    } else if (m_params[first] == 2 && (count == 4 || count == 5)) {
+        const qsizetype red = first + count - 3;
+        color = rgbColor(m_params[red], m_params[red + 1], m_params[red + 2]);
+    } else {
+        return;
+    }
+    (code == 38 ? m_attributes.foreground : m_attributes.background) = color;
+}
+
+// Reads "5;n" or "2;r;g;b" at index; returns how many parameters that took,
+// or -1 if they do not form a colour.
+int VtParser::extendedColor(qsizetype index, quint32 *color) const
+{
+    const qsizetype available = m_params.size() - index;
+    if (available >= 2 && m_params[index] == 5) {
+        *color = paletteColor(m_params[index + 1]);
+        return 2;
+    }
+    if (available >= 4 && m_params[index] == 2) {
+        *color = rgbColor(m_params[index + 1], m_params[index + 2], m_params[index + 3]);
+        return 4;
+    }
+    return -1;
+}
+
+qsizetype VtParser::subParamCount(qsizetype index) const
+{
+    qsizetype count = 0;
+    while (index + count + 1 < m_params.size() && (m_subParamMask & (1u << (index + count + 1))) != 0) {
+        ++count;
+    }
+    return count;
+}
+
+int VtParser::param(qsizetype index, int fallback) const
+{
+    return index < m_params.size() && m_params[index] > 0 ? m_params[index] : fallback;
+}
+
+void VtParser::cursorTo(int row, int column)
+{
+    // In origin mode rows count from the top margin and stay inside the region.
+    ScreenBuffer &screen = activeScreen();
+    if (m_originMode) {
+        row = qBound(screen.marginTop(), row + screen.marginTop(), screen.marginBottom());
+    }
+    screen.moveCursor(row, column);
+}
+
+void VtParser::saveCursor()
+{
+    const ScreenBuffer &screen = activeScreen();
+    m_savedRow = screen.cursorRow();
+    m_savedColumn = screen.cursorColumn();
+    m_savedAttributes = m_attributes;
+}
+
+void VtParser::restoreCursor()
+{
+    activeScreen().moveCursor(m_savedRow, m_savedColumn);
+    m_attributes = m_savedAttributes;
+}
+
+void VtParser::fullReset()
+{
+    reset();
+    for (ScreenBuffer *screen : {&m_primary.get(), &m_alternate.get()}) {
+        screen->setMargin(0, screen->rows() - 1);
+        screen->clear();
+    }
+}
+
+void VtParser::setPrivateMode(int mode, bool enabled)
+{
+    switch (mode) {
+    case 1: // DECCKM
+        m_applicationCursorKeys = enabled;
+        break;
+    case 6: // DECOM
+        m_originMode = enabled;
+        cursorTo(0, 0);
+        break;
+    case 7: // DECAWM
+        m_primary.get().setAutoWrap(enabled);
+        m_alternate.get().setAutoWrap(enabled);
+        break;
+    case 25: // DECTCEM
+        m_cursorVisible = enabled;
+        break;
+    case 47:
+        switchScreen(enabled, false, false);
+        break;
+    case 1047:
+        switchScreen(enabled, !enabled, false);
+        break;
+    case 1049:
+        switchScreen(enabled, enabled, true);
+        break;
+    case 2004:
+        m_bracketedPaste = enabled;
+        break;
+    default:
+        break;
+    }
+}
+
+void VtParser::switchScreen(bool alternate, bool clear, bool keepCursor)
+{
+    if (alternate == m_useAlternateScreen) {
+        return;
+    }
+    if (keepCursor && alternate) {
+        m_savedRow = m_primary.get().cursorRow();
+        m_savedColumn = m_primary.get().cursorColumn();
+    }
+    // 1047 clears the alternate screen on the way out, 1049 on the way in.
+    if (clear) {
+        m_alternate.get().clear();
+    }
+    m_useAlternateScreen = alternate;
+    if (keepCursor && !alternate) {
+        m_primary.get().moveCursor(m_savedRow, m_savedColumn);
+    }
+    // Renderers only see the active screen's damage, so the switch repaints it.
+    activeScreen().markAllDirty();
 }
 
 void VtParser::dispatchOsc()
 {
-    // TODO: Interpret OSC sequences (title, clipboard, hyperlinks, etc.).
+    PROFILE_FUNCTION();
+    const int separator = m_oscData.indexOf(';');
+    const QByteArray command = separator < 0 ? m_oscData : m_oscData.left(separator);
+    if (command == "133") {
+        dispatchShellMark(separator < 0 ? QByteArray() : m_oscData.mid(separator + 1));
+    }
+    // Other OSC sequences (title, clipboard, hyperlinks) are ignored.
+}
+
+void VtParser::dispatchShellMark(const QByteArray &data)
+{
+    // Full-screen applications on the alternate screen have no prompts.
+    if (!m_promptIndex || m_useAlternateScreen) {
+        return;
+    }
+    const ScreenBuffer &screen = m_primary.get();
+    const quint64 line = (screen.scrollback() ? screen.scrollback()->end() : 0) + screen.cursorRow();
+    m_promptIndex->handleShellMark(data, line);
 }
 
 void VtParser::dispatchDcs()
 {
+    PROFILE_FUNCTION();
     // TODO: Interpret DCS sequences (Sixel, DECRQSS, etc.).
 }
 
 ScreenBuffer &VtParser::activeScreen()
 {
-    return m_useAlternateScreen ? m_alternate : m_primary;
+    return m_useAlternateScreen ? m_alternate.get() : m_primary.get();
 }
 
 const ScreenBuffer &VtParser::activeScreen() const
 {
-    return m_useAlternateScreen ? m_alternate : m_primary;
+    return m_useAlternateScreen ? m_alternate.get() : m_primary.get();
 }
 
 } // namespace terminal
@@ -6,12 +6,17 @@
 #include <QByteArray>
 #include <QVector>
 
+#include <functional>
+
 namespace terminal
 {
 
+class PromptIndex;
+
 enum class ParserState {
     Ground,
     Escape,
+    EscapeIntermediate,
     CsiEntry,
     CsiParam,
     CsiIntermediate,
@@ -42,42 +47,87 @@ public:
 
     ParserState state() const { return m_state; }
 
+    ScreenBuffer &activeScreen();
+    const ScreenBuffer &activeScreen() const;
+    bool alternateScreenActive() const { return m_useAlternateScreen; }
+
+    // DEC private modes set by the application.
+    bool applicationCursorKeys() const { return m_applicationCursorKeys; }
+    bool cursorVisible() const { return m_cursorVisible; }
+    bool bracketedPaste() const { return m_bracketedPaste; }
+
+    // Receives OSC 133 marks; they are ignored while this is null.
+    void setPromptIndex(PromptIndex *index) { m_promptIndex = index; }
+
 private:
     void handleGround(char byte);
     void handleEscape(char byte);
     void handleCsi(char byte);
     void handleOsc(char byte);
     void handleDcs(char byte);
+    void printByte(unsigned char byte);
     void flushUtf8Buffer();
 
+    void print(char32_t codepoint);
+    void enterEscape();
     void executeControl(char byte);
     void collectParam(char byte);
     void collectIntermediate(char byte);
     void collectOsc(char byte);
     void collectDcs(char byte);
-    void dispatchCsi();
+    void dispatchEscape(char finalByte);
+    void dispatchCsi(char finalByte);
+    void dispatchSgr();
+    void dispatchSgrSubParams(int code, qsizetype first, qsizetype count);
+    int extendedColor(qsizetype index, quint32 *color) const;
+    // Number of ':' sub-parameters following the parameter at index.
+    qsizetype subParamCount(qsizetype index) const;
+    // The parameter at index, or fallback when it is missing or zero.
+    int param(qsizetype index, int fallback) const;
+    void cursorTo(int row, int column);
+    void saveCursor();
+    void restoreCursor();
+    void fullReset();
+    void setPrivateMode(int mode, bool enabled);
+    void switchScreen(bool alternate, bool clear, bool keepCursor);
     void dispatchOsc();
+    void dispatchShellMark(const QByteArray &data);
     void dispatchDcs();
 
     std::reference_wrapper<ScreenBuffer> m_primary;
     std::reference_wrapper<ScreenBuffer> m_alternate;
-    std::reference_wrapper<ScreenBuffer> m_active;
+    PromptIndex *m_promptIndex = nullptr;
 
     ParserState m_state = ParserState::Ground;
 
     QVector<int> m_params;
+    // Bit i set when m_params[i] followed a ':' rather than a ';'.
+    quint32 m_subParamMask = 0;
     QByteArray m_intermediates;
+    // '<', '=', '>' or '?' leading the CSI parameters, 0 if none.
+    char m_privateMarker = 0;
     QByteArray m_oscData;
     QByteArray m_dcsData;
-    QByteArray m_utf8Buffer;
+    char32_t m_utf8Codepoint = 0;
+    int m_utf8Remaining = 0;
+    CellAttributes m_attributes;
+    // For REP; 0 until something is printed.
+    char32_t m_lastPrinted = 0;
+    // G0 and G1 designated as DEC special graphics (line drawing), and
+    // whether SO has shifted G1 in.
+    bool m_g0LineDrawing = false;
+    bool m_g1LineDrawing = false;
+    bool m_shiftOut = false;
 
     int m_savedRow = 0;
     int m_savedColumn = 0;
+    CellAttributes m_savedAttributes;
     bool m_originMode = false;
-    bool m_autoWrap = true;
     bool m_insertMode = false;
     bool m_bracketedPaste = false;
-    bool m_screenAlternate = false;
+    bool m_applicationCursorKeys = false;
+    bool m_cursorVisible = true;
+    bool m_useAlternateScreen = false;
 };
 
 }
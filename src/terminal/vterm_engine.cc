@@ -0,0 +1,294 @@
+#include "vterm_engine.h"
+
+#include "profiling.h"
+#include "prompt_index.h"
+#include "scrollback.h"
+
+#include <QtGlobal>
+
+namespace terminal
+{
+
+namespace {
+
+// libvterm's marker for the second cell of a double-width character.
+constexpr uint32_t kVtermWideContinuation = static_cast<uint32_t>(-1);
+constexpr int kApplicationCursorKeysMode = 1;
+constexpr int kBracketedPasteMode = 2004;
+// More parameters than any real DECSET carries; the rest are ignored.
+constexpr int kMaxModeParams = 16;
+
+}
+
+VtermEngine::VtermEngine(int rows, int columns)
+    : m_vterm(vterm_new(qMax(1, rows), qMax(1, columns)))
+    , m_screen(vterm_obtain_screen(m_vterm))
+    , m_mirror(rows, columns)
+{
+    vterm_set_utf8(m_vterm, 1);
+    vterm_screen_set_callbacks(m_screen, &screenCallbacks(), this);
+#if defined(TERMINAL_VTERM_OSC_FALLBACK)
+    static const VTermStateFallbacks fallbacks = []() {
+        VTermStateFallbacks result{};
+        result.osc = &VtermEngine::osc;
+        return result;
+    }();
+    vterm_screen_set_unrecognised_fallbacks(m_screen, &fallbacks, this);
+#endif
+    // One callback per damaged row span instead of per cell.
+    vterm_screen_set_damage_merge(m_screen, VTERM_DAMAGE_ROW);
+    vterm_screen_enable_altscreen(m_screen, 1);
+    vterm_screen_reset(m_screen, 1);
+}
+
+VtermEngine::~VtermEngine()
+{
+    vterm_free(m_vterm);
+}
+
+QString VtermEngine::name() const
+{
+    return QStringLiteral("libvterm");
+}
+
+void VtermEngine::setScrollback(Scrollback *scrollback)
+{
+    m_scrollback = scrollback;
+}
+
+void VtermEngine::setPromptIndex(PromptIndex *index)
+{
+    m_promptIndex = index;
+}
+
+void VtermEngine::feed(const char *data, int length)
+{
+    PROFILE_FUNCTION();
+    scanPrivateModes(data, length);
+    vterm_input_write(m_vterm, data, static_cast<size_t>(length));
+    vterm_screen_flush_damage(m_screen);
+}
+
+void VtermEngine::resize(int rows, int columns)
+{
+    rows = qMax(1, rows);
+    columns = qMax(1, columns);
+    vterm_set_size(m_vterm, rows, columns);
+    vterm_screen_flush_damage(m_screen);
+    m_mirror.resize(rows, columns);
+    copyRect(VTermRect{0, rows, 0, columns});
+    VTermPos cursor;
+    vterm_state_get_cursorpos(vterm_obtain_state(m_vterm), &cursor);
+    m_mirror.moveCursor(cursor.row, cursor.col);
+}
+
+ScreenBuffer &VtermEngine::activeScreen()
+{
+    return m_mirror;
+}
+
+const ScreenBuffer &VtermEngine::activeScreen() const
+{
+    return m_mirror;
+}
+
+bool VtermEngine::alternateScreenActive() const
+{
+    return m_alternateScreen;
+}
+
+bool VtermEngine::applicationCursorKeys() const
+{
+    return m_applicationCursorKeys;
+}
+
+bool VtermEngine::cursorVisible() const
+{
+    return m_cursorVisible;
+}
+
+bool VtermEngine::bracketedPaste() const
+{
+    return m_bracketedPaste;
+}
+
+const VTermScreenCallbacks &VtermEngine::screenCallbacks()
+{
+    static const VTermScreenCallbacks callbacks = []() {
+        VTermScreenCallbacks result{};
+        result.damage = &VtermEngine::damage;
+        result.movecursor = &VtermEngine::moveCursor;
+        result.settermprop = &VtermEngine::setTermProp;
+        result.sb_pushline = &VtermEngine::pushLine;
+        return result;
+    }();
+    return callbacks;
+}
+
+int VtermEngine::damage(VTermRect rect, void *user)
+{
+    static_cast<VtermEngine *>(user)->copyRect(rect);
+    return 1;
+}
+
+int VtermEngine::moveCursor(VTermPos position, VTermPos, int, void *user)
+{
+    static_cast<VtermEngine *>(user)->m_mirror.moveCursor(position.row, position.col);
+    return 1;
+}
+
+int VtermEngine::setTermProp(VTermProp property, VTermValue *value, void *user)
+{
+    auto *engine = static_cast<VtermEngine *>(user);
+    switch (property) {
+    case VTERM_PROP_CURSORVISIBLE:
+        engine->m_cursorVisible = value->boolean != 0;
+        return 1;
+    case VTERM_PROP_ALTSCREEN:
+        engine->m_alternateScreen = value->boolean != 0;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+int VtermEngine::pushLine(int columns, const VTermScreenCell *cells, void *user)
+{
+    auto *engine = static_cast<VtermEngine *>(user);
+    if (!engine->m_scrollback) {
+        return 0;
+    }
+    engine->m_pushedLine.resize(static_cast<size_t>(columns));
+    for (int column = 0; column < columns; ++column) {
+        engine->m_pushedLine[static_cast<size_t>(column)] = engine->convertCell(cells[column]);
+    }
+    engine->m_scrollback->push(engine->m_pushedLine.data(), columns);
+    return 1;
+}
+
+#if defined(TERMINAL_VTERM_OSC_FALLBACK)
+int VtermEngine::osc(int command, VTermStringFragment fragment, void *user)
+{
+    if (command != 133) {
+        return 0;
+    }
+    auto *engine = static_cast<VtermEngine *>(user);
+    if (fragment.initial) {
+        engine->m_oscData.clear();
+    }
+    engine->m_oscData.append(fragment.str, static_cast<qsizetype>(fragment.len));
+    if (fragment.final) {
+        engine->dispatchShellMark(engine->m_oscData);
+    }
+    return 1;
+}
+#endif
+
+// Same line numbering as VtParser::dispatchShellMark().
+void VtermEngine::dispatchShellMark(const QByteArray &data)
+{
+    if (!m_promptIndex || m_alternateScreen) {
+        return;
+    }
+    VTermPos cursor;
+    vterm_state_get_cursorpos(vterm_obtain_state(m_vterm), &cursor);
+    const quint64 line = (m_scrollback ? m_scrollback->end() : 0) + static_cast<quint64>(cursor.row);
+    m_promptIndex->handleShellMark(data, line);
+}
+
+void VtermEngine::copyRect(const VTermRect &rect)
+{
+    VTermScreenCell cell;
+    for (int row = rect.start_row; row < rect.end_row; ++row) {
+        for (int column = rect.start_col; column < rect.end_col; ++column) {
+            if (vterm_screen_get_cell(m_screen, VTermPos{row, column}, &cell)) {
+                m_mirror.setCell(row, column, convertCell(cell));
+            }
+        }
+    }
+}
+
+Cell VtermEngine::convertCell(const VTermScreenCell &cell) const
+{
+    Cell result;
+    // Combining characters after chars[0] are dropped, as the native screen does.
+    if (cell.chars[0] == kVtermWideContinuation) {
+        result.codepoint = kWideCharContinuation;
+    } else if (cell.chars[0] != 0) {
+        result.codepoint = cell.chars[0];
+    }
+
+    const auto toRgb = [this](VTermColor color) {
+        vterm_screen_convert_color_to_rgb(m_screen, &color);
+        return (static_cast<quint32>(color.rgb.red) << 16) | (static_cast<quint32>(color.rgb.green) << 8)
+            | color.rgb.blue;
+    };
+    CellAttributes &attributes = result.attributes;
+    if (!VTERM_COLOR_IS_DEFAULT_FG(&cell.fg)) {
+        attributes.foreground = toRgb(cell.fg);
+    }
+    if (!VTERM_COLOR_IS_DEFAULT_BG(&cell.bg)) {
+        attributes.background = toRgb(cell.bg);
+    }
+    attributes.bold = cell.attrs.bold != 0;
+    attributes.italic = cell.attrs.italic != 0;
+    attributes.underline = cell.attrs.underline != 0;
+    attributes.inverse = cell.attrs.reverse != 0;
+    attributes.blink = cell.attrs.blink != 0;
+    attributes.invisible = cell.attrs.conceal != 0;
+    return result;
+}
+
+void VtermEngine::scanPrivateModes(const char *data, int length)
+{
+    for (int index = 0; index < length; ++index) {
+        const char byte = data[index];
+        switch (m_modeScan) {
+        case ModeScan::Ground:
+            if (byte == '\x1b') {
+                m_modeScan = ModeScan::Escape;
+            }
+            break;
+        case ModeScan::Escape:
+            if (byte == 'c') {
+                // RIS resets every mode.
+                m_applicationCursorKeys = false;
+                m_bracketedPaste = false;
+            }
+            m_modeScan = byte == '[' ? ModeScan::Csi : (byte == '\x1b' ? ModeScan::Escape : ModeScan::Ground);
+            break;
+        case ModeScan::Csi:
+            if (byte == '?') {
+                m_modeParams.clear();
+                m_modeParams.append(0);
+                m_modeScan = ModeScan::Private;
+            } else {
+                m_modeScan = byte == '\x1b' ? ModeScan::Escape : ModeScan::Ground;
+            }
+            break;
+        case ModeScan::Private:
+            if (byte >= '0' && byte <= '9') {
+                int &param = m_modeParams.last();
+                param = qMin((param * 10) + (byte - '0'), 99999);
+            } else if (byte == ';') {
+                if (m_modeParams.size() < kMaxModeParams) {
+                    m_modeParams.append(0);
+                }
+            } else {
+                if (byte == 'h' || byte == 'l') {
+                    for (int mode : std::as_const(m_modeParams)) {
+                        if (mode == kApplicationCursorKeysMode) {
+                            m_applicationCursorKeys = byte == 'h';
+                        } else if (mode == kBracketedPasteMode) {
+                            m_bracketedPaste = byte == 'h';
+                        }
+                    }
+                }
+                m_modeScan = byte == '\x1b' ? ModeScan::Escape : ModeScan::Ground;
+            }
+            break;
+        }
+    }
+}
+
+}
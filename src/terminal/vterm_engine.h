@@ -0,0 +1,89 @@
+#ifndef TERMINAL_VTERM_ENGINE_H
+#define TERMINAL_VTERM_ENGINE_H
+
+#include "emulation_engine.h"
+#include "screen_buffer.h"
+
+#include <QByteArray>
+#include <QVarLengthArray>
+
+#include <vterm.h>
+
+#include <vector>
+
+// String fragments for OSC fallbacks arrived in libvterm 0.2.
+#if defined(VTERM_VERSION_MAJOR) && (VTERM_VERSION_MAJOR > 0 || VTERM_VERSION_MINOR >= 2)
+#define TERMINAL_VTERM_OSC_FALLBACK 1
+#endif
+
+namespace terminal
+{
+
+// libvterm as a reference emulator. Its screen is mirrored into a
+// ScreenBuffer cell by cell from the damage callbacks, so renderers and the
+// differential harness read it exactly like the native engine's screen.
+// Moved rows arrive as damage rather than scroll events.
+class VtermEngine : public EmulationEngine
+{
+public:
+    VtermEngine(int rows, int columns);
+    ~VtermEngine() override;
+    VtermEngine(const VtermEngine &) = delete;
+    VtermEngine &operator=(const VtermEngine &) = delete;
+
+    QString name() const override;
+    void setScrollback(Scrollback *scrollback) override;
+    void setPromptIndex(PromptIndex *index) override;
+    void feed(const char *data, int length) override;
+    void resize(int rows, int columns) override;
+
+    ScreenBuffer &activeScreen() override;
+    const ScreenBuffer &activeScreen() const override;
+    bool alternateScreenActive() const override;
+
+    bool applicationCursorKeys() const override;
+    bool cursorVisible() const override;
+    bool bracketedPaste() const override;
+
+private:
+    static const VTermScreenCallbacks &screenCallbacks();
+    static int damage(VTermRect rect, void *user);
+    static int moveCursor(VTermPos position, VTermPos oldPosition, int visible, void *user);
+    static int setTermProp(VTermProp property, VTermValue *value, void *user);
+    static int pushLine(int columns, const VTermScreenCell *cells, void *user);
+#if defined(TERMINAL_VTERM_OSC_FALLBACK)
+    static int osc(int command, VTermStringFragment fragment, void *user);
+#endif
+    void dispatchShellMark(const QByteArray &data);
+
+    void copyRect(const VTermRect &rect);
+    Cell convertCell(const VTermScreenCell &cell) const;
+    void scanPrivateModes(const char *data, int length);
+
+    VTerm *m_vterm;
+    VTermScreen *m_screen;
+    ScreenBuffer m_mirror;
+    Scrollback *m_scrollback = nullptr;
+    PromptIndex *m_promptIndex = nullptr;
+    // OSC 133 payload gathered across fragments.
+    QByteArray m_oscData;
+    std::vector<Cell> m_pushedLine;
+    bool m_alternateScreen = false;
+    bool m_cursorVisible = true;
+
+    // libvterm keeps DECCKM and bracketed paste to itself, so DECSET/DECRST
+    // sequences are picked out of the input as it goes past.
+    enum class ModeScan {
+        Ground,
+        Escape,
+        Csi,
+        Private,
+    };
+    ModeScan m_modeScan = ModeScan::Ground;
+    QVarLengthArray<int, 4> m_modeParams;
+    bool m_applicationCursorKeys = false;
+    bool m_bracketedPaste = false;
+};
+
+}
+#endif
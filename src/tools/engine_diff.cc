@@ -0,0 +1,243 @@
+// Feeds captured pty byte streams to two emulation engines, compares the
+// resulting screens and scrollback cell by cell, then times each engine on
+// the same input. Tracks the native engine against libvterm:
+//
+//   keith_console_engine_diff [--columns N] [--rows N] [--chunk BYTES]
+//                             [--repeat N] [--attributes] [--every-chunk]
+//                             [--reference NAME] [--candidate NAME] input.bin...
+//
+// Exits with 1 if any input leaves the engines in different states.
+
+#include "emulation_engine.h"
+#include "screen_buffer.h"
+#include "scrollback.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kMaxReportedMismatches = 20;
+constexpr int kScrollbackLines = 10000;
+
+struct Options
+{
+    int rows;
+    int columns;
+    int chunk;
+    bool attributes;
+};
+
+// An engine with the scrollback it pushes into, as TerminalBridge pairs them.
+struct Emulator
+{
+    Emulator(const QString &name, const Options &options)
+        : engine(terminal::createEmulationEngine(name, options.rows, options.columns))
+        , scrollback(kScrollbackLines)
+    {
+        if (engine) {
+            engine->setScrollback(&scrollback);
+        }
+    }
+
+    std::unique_ptr<terminal::EmulationEngine> engine;
+    terminal::Scrollback scrollback;
+};
+
+bool sameAttributes(const terminal::CellAttributes &left, const terminal::CellAttributes &right)
+{
+    return left.foreground == right.foreground && left.background == right.background && left.bold == right.bold
+        && left.italic == right.italic && left.underline == right.underline && left.inverse == right.inverse
+        && left.blink == right.blink && left.invisible == right.invisible;
+}
+
+QString describe(const terminal::Cell &cell)
+{
+    if (cell.codepoint == terminal::kWideCharContinuation) {
+        return QStringLiteral("<wide>");
+    }
+    const QString hex =
+        QString::number(static_cast<uint>(cell.codepoint), 16).toUpper().rightJustified(4, QLatin1Char('0'));
+    return QStringLiteral("'%1' U+%2").arg(QString::fromUcs4(&cell.codepoint, 1), hex);
+}
+
+// Compares one line of cells, treating missing cells as blanks.
+void compareCells(const QString &where, const terminal::Cell *reference, int referenceLength,
+                  const terminal::Cell *candidate, int candidateLength, const Options &options,
+                  QStringList &mismatches)
+{
+    const terminal::Cell blank;
+    for (int column = 0; column < std::max(referenceLength, candidateLength); ++column) {
+        const terminal::Cell &left = column < referenceLength ? reference[column] : blank;
+        const terminal::Cell &right = column < candidateLength ? candidate[column] : blank;
+        if (left.codepoint != right.codepoint) {
+            mismatches.append(
+                QStringLiteral("%1 column %2: %3 vs %4").arg(where).arg(column).arg(describe(left), describe(right)));
+        } else if (options.attributes && !sameAttributes(left.attributes, right.attributes)) {
+            mismatches.append(
+                QStringLiteral("%1 column %2: attributes differ on %3").arg(where).arg(column).arg(describe(left)));
+        }
+    }
+}
+
+QStringList compare(const Emulator &reference, const Emulator &candidate, const Options &options)
+{
+    QStringList mismatches;
+    const terminal::ScreenBuffer &left = reference.engine->activeScreen();
+    const terminal::ScreenBuffer &right = candidate.engine->activeScreen();
+    if (reference.engine->alternateScreenActive() != candidate.engine->alternateScreenActive()) {
+        mismatches.append(QStringLiteral("alternate screen: %1 vs %2")
+                              .arg(QLatin1String(reference.engine->alternateScreenActive() ? "active" : "inactive"),
+                                   QLatin1String(candidate.engine->alternateScreenActive() ? "active" : "inactive")));
+    }
+    if (left.cursorRow() != right.cursorRow() || left.cursorColumn() != right.cursorColumn()) {
+        mismatches.append(QStringLiteral("cursor: %1,%2 vs %3,%4")
+                              .arg(left.cursorRow())
+                              .arg(left.cursorColumn())
+                              .arg(right.cursorRow())
+                              .arg(right.cursorColumn()));
+    }
+    for (int row = 0; row < options.rows; ++row) {
+        compareCells(QStringLiteral("row %1").arg(row), left.rowData(row), left.columns(), right.rowData(row),
+                     right.columns(), options, mismatches);
+    }
+
+    if (reference.scrollback.end() != candidate.scrollback.end()) {
+        mismatches.append(QStringLiteral("scrollback lines: %1 vs %2")
+                              .arg(reference.scrollback.end())
+                              .arg(candidate.scrollback.end()));
+    }
+    const quint64 end = std::min(reference.scrollback.end(), candidate.scrollback.end());
+    for (quint64 line = std::max(reference.scrollback.begin(), candidate.scrollback.begin()); line < end; ++line) {
+        int leftLength = 0;
+        int rightLength = 0;
+        const terminal::Cell *leftCells = reference.scrollback.line(line, &leftLength);
+        const terminal::Cell *rightCells = candidate.scrollback.line(line, &rightLength);
+        compareCells(QStringLiteral("scrollback line %1").arg(line), leftCells, leftLength, rightCells, rightLength,
+                     options, mismatches);
+    }
+    return mismatches;
+}
+
+void feed(terminal::EmulationEngine &engine, const QByteArray &stream, qsizetype offset, int chunk)
+{
+    const qsizetype length = std::min<qsizetype>(chunk, stream.size() - offset);
+    engine.feed(stream.constData() + offset, static_cast<int>(length));
+}
+
+// Megabytes per second over repeat fresh runs of the whole stream.
+double throughput(const QString &name, const QByteArray &stream, const Options &options, int repeat)
+{
+    QElapsedTimer timer;
+    qint64 nanoseconds = 0;
+    for (int run = 0; run < repeat; ++run) {
+        Emulator emulator(name, options);
+        timer.start();
+        for (qsizetype offset = 0; offset < stream.size(); offset += options.chunk) {
+            feed(*emulator.engine, stream, offset, options.chunk);
+        }
+        nanoseconds += timer.nsecsElapsed();
+    }
+    return nanoseconds > 0 ? (static_cast<double>(stream.size()) * repeat * 1000.0) / nanoseconds : 0.0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream errors(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Compare emulation engines on captured pty output."));
+    parser.addHelpOption();
+    const QCommandLineOption columnsOption(QStringLiteral("columns"), QStringLiteral("Grid width in cells."),
+                                           QStringLiteral("columns"), QStringLiteral("80"));
+    const QCommandLineOption rowsOption(QStringLiteral("rows"), QStringLiteral("Grid height in cells."),
+                                        QStringLiteral("rows"), QStringLiteral("24"));
+    const QCommandLineOption chunkOption(QStringLiteral("chunk"),
+                                         QStringLiteral("Bytes per feed, like one pty read."),
+                                         QStringLiteral("bytes"), QStringLiteral("4096"));
+    const QCommandLineOption repeatOption(QStringLiteral("repeat"), QStringLiteral("Timed runs per engine."),
+                                          QStringLiteral("count"), QStringLiteral("5"));
+    const QCommandLineOption attributesOption(QStringLiteral("attributes"),
+                                              QStringLiteral("Compare colours and attributes too."));
+    const QCommandLineOption everyChunkOption(QStringLiteral("every-chunk"),
+                                              QStringLiteral("Compare after each chunk to find the first divergence."));
+    const QCommandLineOption referenceOption(QStringLiteral("reference"), QStringLiteral("Reference engine."),
+                                             QStringLiteral("name"), QStringLiteral("libvterm"));
+    const QCommandLineOption candidateOption(QStringLiteral("candidate"), QStringLiteral("Engine under test."),
+                                             QStringLiteral("name"), QStringLiteral("native"));
+    parser.addOptions({columnsOption, rowsOption, chunkOption, repeatOption, attributesOption, everyChunkOption,
+                       referenceOption, candidateOption});
+    parser.addPositionalArgument(QStringLiteral("inputs"), QStringLiteral("Captured pty output files."),
+                                 QStringLiteral("input.bin..."));
+    parser.process(app);
+
+    const QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    const Options options{qMax(1, parser.value(rowsOption).toInt()), qMax(1, parser.value(columnsOption).toInt()),
+                          qMax(1, parser.value(chunkOption).toInt()), parser.isSet(attributesOption)};
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+    const QString referenceName = parser.value(referenceOption);
+    const QString candidateName = parser.value(candidateOption);
+    for (const QString &name : {referenceName, candidateName}) {
+        if (!terminal::createEmulationEngine(name, 1, 1)) {
+            errors << "Unknown emulation engine " << name << " (have "
+                   << terminal::emulationEngineNames().join(QStringLiteral(", ")) << ")" << Qt::endl;
+            return 2;
+        }
+    }
+
+    bool allMatch = true;
+    for (const QString &path : inputs) {
+        QFile input(path);
+        if (!input.open(QIODevice::ReadOnly)) {
+            errors << "Cannot read " << path << ": " << input.errorString() << Qt::endl;
+            return 2;
+        }
+        const QByteArray stream = input.readAll();
+
+        Emulator reference(referenceName, options);
+        Emulator candidate(candidateName, options);
+        qsizetype firstDivergence = -1;
+        for (qsizetype offset = 0; offset < stream.size(); offset += options.chunk) {
+            feed(*reference.engine, stream, offset, options.chunk);
+            feed(*candidate.engine, stream, offset, options.chunk);
+            if (parser.isSet(everyChunkOption) && firstDivergence < 0
+                && !compare(reference, candidate, options).isEmpty()) {
+                firstDivergence = std::min<qsizetype>(offset + options.chunk, stream.size());
+            }
+        }
+
+        const QStringList mismatches = compare(reference, candidate, options);
+        out << path << ": " << stream.size() << " bytes, ";
+        if (mismatches.isEmpty()) {
+            out << "screens match";
+        } else {
+            allMatch = false;
+            out << mismatches.size() << " differences (" << referenceName << " vs " << candidateName << ")";
+        }
+        out << Qt::endl;
+        for (qsizetype index = 0; index < std::min<qsizetype>(mismatches.size(), kMaxReportedMismatches); ++index) {
+            out << "  " << mismatches[index] << Qt::endl;
+        }
+        if (firstDivergence >= 0) {
+            out << "  first differ after byte " << firstDivergence << Qt::endl;
+        }
+        for (const QString &name : {referenceName, candidateName}) {
+            out << "  " << name << ": " << QString::number(throughput(name, stream, options, repeat), 'f', 1)
+                << " MB/s" << Qt::endl;
+        }
+    }
+    return allMatch ? 0 : 1;
+}
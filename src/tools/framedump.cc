@@ -0,0 +1,93 @@
+// Replays a captured pty byte stream through the emulator and writes the final
+// screen as a PNG using the CPU rasteriser. Runs without a display, so
+// rendering regressions can be checked on CI machines:
+//
+//   keith_console_framedump [--columns N] [--rows N] [--font FAMILY]
+//                           [--size POINTS] [--engine NAME] input.bin output.png
+
+#include "cpu_rasterizer.h"
+#include "emulation_engine.h"
+#include "screen_buffer.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFont>
+#include <QGuiApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    // Fonts need a QGuiApplication, but not a display.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    QTextStream errors(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Render a terminal byte stream to a PNG frame dump."));
+    parser.addHelpOption();
+    const QCommandLineOption columnsOption(QStringLiteral("columns"), QStringLiteral("Grid width in cells."),
+                                           QStringLiteral("columns"), QStringLiteral("80"));
+    const QCommandLineOption rowsOption(QStringLiteral("rows"), QStringLiteral("Grid height in cells."),
+                                        QStringLiteral("rows"), QStringLiteral("24"));
+    const QCommandLineOption fontOption(QStringLiteral("font"), QStringLiteral("Font family."),
+                                        QStringLiteral("family"), QStringLiteral("monospace"));
+    const QCommandLineOption sizeOption(QStringLiteral("size"), QStringLiteral("Font size in points."),
+                                        QStringLiteral("points"), QStringLiteral("13"));
+    const QCommandLineOption engineOption(QStringLiteral("engine"),
+                                          QStringLiteral("Emulation engine: %1.")
+                                              .arg(terminal::emulationEngineNames().join(QStringLiteral(", "))),
+                                          QStringLiteral("name"), QStringLiteral("native"));
+    parser.addOptions({columnsOption, rowsOption, fontOption, sizeOption, engineOption});
+    parser.addPositionalArgument(QStringLiteral("input"), QStringLiteral("Captured pty output."));
+    parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("PNG file to write."));
+    parser.process(app);
+
+    const QStringList positional = parser.positionalArguments();
+    if (positional.size() != 2) {
+        parser.showHelp(1);
+    }
+
+    QFile input(positional.at(0));
+    if (!input.open(QIODevice::ReadOnly)) {
+        errors << "Cannot read " << input.fileName() << ": " << input.errorString() << Qt::endl;
+        return 1;
+    }
+
+    const int columns = qMax(1, parser.value(columnsOption).toInt());
+    const int rows = qMax(1, parser.value(rowsOption).toInt());
+    const std::unique_ptr<terminal::EmulationEngine> engine =
+        terminal::createEmulationEngine(parser.value(engineOption), rows, columns);
+    if (!engine) {
+        errors << "Unknown emulation engine " << parser.value(engineOption) << Qt::endl;
+        return 1;
+    }
+    const QByteArray stream = input.readAll();
+    engine->feed(stream.constData(), static_cast<int>(stream.size()));
+
+    QFont font(parser.value(fontOption));
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPointSizeF(parser.value(sizeOption).toDouble());
+
+    // Dumps are compared pixel for pixel, so the cursor is left out.
+    render::CpuRasterizer rasterizer;
+    rasterizer.setFont(font, 1.0);
+    rasterizer.resize(rows, columns);
+    const terminal::ScreenBuffer &screen = engine->activeScreen();
+    quint32 generation = 0;
+    do {
+        // A full atlas starts over, leaving earlier rows with stale slots.
+        generation = rasterizer.atlasGeneration();
+        for (int row = 0; row < rows; ++row) {
+            rasterizer.updateRow(row, screen.rowData(row));
+        }
+    } while (generation != rasterizer.atlasGeneration());
+    rasterizer.rasterize();
+
+    if (!rasterizer.image().save(positional.at(1), "PNG")) {
+        errors << "Cannot write " << positional.at(1) << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -2,28 +2,215 @@
 
 #include <QCoreApplication>
 #include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
+#include <QRawFont>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QTimer>
 
+#include "latency_test.h"
+#include "performance_stats.h"
 #include "plain_text_surface.h"
+#include "raster_terminal_surface.h"
+#include "terminal/latency_tracker.h"
 #include "terminal/logger.h"
+#include "terminal/startup_trace.h"
 #include "terminal/terminal_bridge.h"
+#include "terminal/trace.h"
 
 #include <QtQml/qqmlregistration.h>
 #include <QDir>
+#include <QFontMetricsF>
+#include <QKeyEvent>
+
+namespace {
+
+enum class RenderBackend {
+    Auto,
+    Gpu,
+    Cpu,
+};
+
+// --renderer=gpu|cpu; parsed by hand because the choice has to be made before
+// QGuiApplication exists.
+RenderBackend requestedBackend(int argc, char *argv[])
+{
+    const QByteArray prefix("--renderer=");
+    for (int index = 1; index < argc; ++index) {
+        const QByteArray argument(argv[index]);
+        if (!argument.startsWith(prefix)) {
+            continue;
+        }
+        const QByteArray value = argument.mid(prefix.size());
+        if (value == "cpu") {
+            return RenderBackend::Cpu;
+        }
+        if (value == "gpu") {
+            return RenderBackend::Gpu;
+        }
+    }
+    return RenderBackend::Auto;
+}
+
+constexpr int kLatencyTestKeystrokes = 300;
+constexpr int kStartupPollMs = 5;
+constexpr int kStartupReportTimeoutMs = 5000;
+
+bool hasArgument(int argc, char *argv[], const char *name)
+{
+    for (int index = 1; index < argc; ++index) {
+        if (qstrcmp(argv[index], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Value of a --name=value argument, or an empty string.
+QString argumentValue(int argc, char *argv[], const char *prefix)
+{
+    const QByteArray expected(prefix);
+    for (int index = 1; index < argc; ++index) {
+        const QByteArray argument(argv[index]);
+        if (argument.startsWith(expected)) {
+            return QString::fromLocal8Bit(argument.mid(expected.size()));
+        }
+    }
+    return {};
+}
+
+// Opens a latency sample as a key event enters the application, before any
+// item or QML handler sees it.
+class KeyPressStamper : public QObject
+{
+public:
+    using QObject::QObject;
+
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::KeyPress && watched->isWindowType()) {
+            terminal::latencyTracker().keyPressed(terminal::LatencyTracker::now());
+        }
+        return QObject::eventFilter(watched, event);
+    }
+};
+
+// Resolves the configured font on a pool thread. The first lookup scans the
+// font database, which would otherwise happen on the GUI thread when the
+// surface first measures its cells.
+void warmUpFont(const terminal::Config &config)
+{
+    const QString family = config.fontFamily;
+    const qreal pointSize = config.fontSize;
+    QThreadPool::globalInstance()->start([family, pointSize]() {
+        QFont font(family);
+        font.setStyleHint(QFont::TypeWriter);
+        font.setPointSizeF(pointSize);
+        QFontMetricsF(font).horizontalAdvance(QLatin1Char('M'));
+        QRawFont::fromFont(font);
+        terminal::startupTrace().mark("font warmed (worker)");
+    });
+}
+
+// Logs the time to a usable prompt (first frame and first shell output),
+// and with --trace-startup prints every phase to stderr.
+void reportStartup(bool printPhases, QObject *context)
+{
+    auto *poll = new QTimer(context);
+    poll->setInterval(kStartupPollMs);
+    QObject::connect(poll, &QTimer::timeout, context, [poll, printPhases]() {
+        const terminal::StartupTrace &startup = terminal::startupTrace();
+        const bool ready = startup.has("first frame") && startup.has("first shell output");
+        if (!ready && startup.elapsedMs() < kStartupReportTimeoutMs) {
+            return;
+        }
+        poll->stop();
+        poll->deleteLater();
+        if (printPhases) {
+            QTextStream(stderr) << startup.report() << Qt::endl;
+        }
+        if (auto logger = terminalLogger()) {
+            logger->info("Startup {} after {} ms", ready ? "complete" : "incomplete", startup.elapsedMs());
+        }
+    });
+    poll->start();
+}
+
+// Mesa's llvmpipe and softpipe drivers run GL on the CPU; our own rasteriser
+// beats them by only blending damaged rows, in parallel.
+bool hasSoftwareOpenGL()
+{
+    QOffscreenSurface surface;
+    surface.create();
+    QOpenGLContext context;
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        return true;
+    }
+    const QByteArray renderer(reinterpret_cast<const char *>(context.functions()->glGetString(GL_RENDERER)));
+    context.doneCurrent();
+    return renderer.contains("llvmpipe") || renderer.contains("softpipe") || renderer.contains("Software Rasterizer");
+}
+
+}
 
 int Application::run(int argc, char *argv[])
 {
+    terminal::StartupTrace &startup = terminal::startupTrace();
+    RenderBackend backend = requestedBackend(argc, argv);
     QGuiApplication app(argc, argv);
+    startup.mark("gui application");
 
     const QString logDir = QDir(QCoreApplication::applicationDirPath()).filePath("../logs");
     initLogger(logDir);
+    startup.mark("logger");
+
+    // --trace=FILE records the binary event trace; see terminal/trace.h.
+    const QString tracePath = argumentValue(argc, argv, "--trace=");
+    if (!tracePath.isEmpty()) {
+        const bool tracing = terminal::startTrace(tracePath);
+        if (auto logger = terminalLogger()) {
+            if (tracing) {
+                logger->info("Recording event trace to {}", tracePath.toStdString());
+            } else {
+                logger->error("Cannot write event trace to {}", tracePath.toStdString());
+            }
+        }
+    }
 
-    qmlRegisterType<PlainTextSurface>("KeithConsole", 1, 0, "PlainTextSurface");
+    // The shell boots in its own process while the renderer is chosen and
+    // QML loads, and the font database is scanned on a worker thread, so the
+    // first frame waits for neither.
+    auto *bridge = new TerminalBridge(&app);
+    startup.mark("config and session");
+    warmUpFont(bridge->config());
+
+    if (backend == RenderBackend::Auto) {
+        backend = hasSoftwareOpenGL() ? RenderBackend::Cpu : RenderBackend::Gpu;
+    }
+    // The GPU surface draws through QRhi, so the scene graph keeps whichever
+    // backend the platform prefers (or QSG_RHI_BACKEND names).
+    if (backend == RenderBackend::Cpu) {
+        QQuickWindow::setGraphicsApi(QSGRendererInterface::Software);
+        qmlRegisterType<RasterTerminalSurface>("KeithConsole", 1, 0, "PlainTextSurface");
+    } else {
+        qmlRegisterType<PlainTextSurface>("KeithConsole", 1, 0, "PlainTextSurface");
+    }
+    if (auto logger = terminalLogger()) {
+        logger->info("Using the {} renderer", backend == RenderBackend::Cpu ? "cpu" : "gpu");
+    }
+    startup.mark("renderer selected");
+
+    KeyPressStamper keyPressStamper;
+    app.installEventFilter(&keyPressStamper);
 
     QQmlApplicationEngine engine;
-    auto *bridge = new TerminalBridge(&engine);
     engine.rootContext()->setContextProperty("terminalBridge", bridge);
+    engine.rootContext()->setContextProperty("performanceStats", new PerformanceStats(&engine));
     QObject::connect(
         &engine,
         &QQmlApplicationEngine::objectCreationFailed,
@@ -31,12 +218,33 @@ int Application::run(int argc, char *argv[])
         []() { QCoreApplication::exit(-1); },
         Qt::QueuedConnection);
     engine.loadFromModule("keith_console", "Main");
+    startup.mark("qml loaded");
+    reportStartup(hasArgument(argc, argv, "--trace-startup"), &app);
+
+    if (hasArgument(argc, argv, "--latency-test")) {
+        QQuickWindow *window = engine.rootObjects().isEmpty()
+            ? nullptr
+            : qobject_cast<QQuickWindow *>(engine.rootObjects().constFirst());
+        auto *test = new LatencyTest(window, bridge, kLatencyTestKeystrokes, &engine);
+        test->start();
+    }
 
-    return app.exec();
+    const int result = app.exec();
+    const terminal::LatencyTracker &tracker = terminal::latencyTracker();
+    if (tracker.completedSamples() > 0) {
+        if (auto logger = terminalLogger()) {
+            logger->info("Input latency over {} keystrokes\n{}", tracker.completedSamples(),
+                         tracker.report().toStdString());
+        }
+    }
+    terminal::stopTrace();
+    shutdownLogger();
+    return result;
 }
 
 int main(int argc, char *argv[])
 {
+    terminal::startupTrace().start();
     Application application;
     return application.run(argc, argv);
 }
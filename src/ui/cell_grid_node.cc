@@ -0,0 +1,665 @@
+#include "cell_grid_node.h"
+
+#include "terminal/logger.h"
+#include "terminal/profiling.h"
+#include "terminal/screen_buffer.h"
+
+#include <QFile>
+#include <QMatrix4x4>
+#include <QQuickWindow>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// Triangle strip corners of the unit quad every cell instance is drawn from.
+constexpr float kQuad[] = {
+    0.0f, 0.0f,
+    1.0f, 0.0f,
+    0.0f, 1.0f,
+    1.0f, 1.0f,
+};
+
+// std140 layout of the cell shaders' uniform block.
+struct Uniforms
+{
+    float matrix[16];
+    float glyphSize[2];
+    float atlasSize[2];
+    qint32 columns;
+    qint32 cursorCell;
+    float reserved[2];
+};
+
+// std140 layout of the composite shaders' uniform block.
+struct CompositeUniforms
+{
+    float matrix[16];
+    float origin[2];
+    float size[2];
+    float opacity;
+    float flipY;
+    float reserved[2];
+};
+
+QShader loadShader(const QString &name)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return QShader::fromSerialized(file.readAll());
+}
+
+void unpackColor(quint32 rgb, quint8 (&target)[4])
+{
+    target[0] = static_cast<quint8>((rgb >> 16) & 0xFF);
+    target[1] = static_cast<quint8>((rgb >> 8) & 0xFF);
+    target[2] = static_cast<quint8>(rgb & 0xFF);
+    target[3] = 0xFF;
+}
+
+}
+
+CellGridNode::CellGridNode(QQuickWindow *window)
+    : m_window(window)
+{
+}
+
+CellGridNode::~CellGridNode()
+{
+    releaseResources();
+}
+
+void CellGridNode::setFont(const QFont &font, qreal devicePixelRatio, const QStringList &fallbackFamilies)
+{
+    m_atlas.setFont(font, devicePixelRatio, fallbackFamilies);
+    m_devicePixelRatio = devicePixelRatio;
+}
+
+void CellGridNode::setGeometry(const QRectF &rect, const QPointF &origin)
+{
+    m_rect = rect;
+    m_origin = origin;
+}
+
+void CellGridNode::resize(int rows, int columns)
+{
+    if (rows == m_rows && columns == m_columns) {
+        return;
+    }
+    m_rows = rows;
+    m_columns = columns;
+    m_cursorCell = -1;
+    m_instances = QVector<CellInstance>(rows * columns, CellInstance{});
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            CellInstance &instance = m_instances[(row * columns) + column];
+            instance.column = static_cast<quint16>(column);
+            instance.row = static_cast<quint16>(row);
+        }
+    }
+    markInstancesDirty(0, static_cast<int>(m_instances.size()) - 1);
+    m_redrawRows.clear();
+    m_redrawFirstColumn = QVector<int>(rows, columns);
+    m_redrawLastColumn = QVector<int>(rows, -1);
+    m_pendingScrolls.clear();
+    m_fullRedraw = true;
+}
+
+void CellGridNode::updateRow(int row, const terminal::Cell *cells, int firstColumn, int lastColumn)
+{
+    if (row < 0 || row >= m_rows) {
+        return;
+    }
+    firstColumn = std::max(firstColumn, 0);
+    lastColumn = lastColumn < 0 ? m_columns - 1 : std::min(lastColumn, m_columns - 1);
+    if (firstColumn > lastColumn) {
+        return;
+    }
+
+    const QVector<render::GlyphSlot> slots = m_shaper.shape(cells, firstColumn, lastColumn, m_columns, m_atlas);
+
+    CellInstance *instances = m_instances.data() + (row * m_columns);
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+        const terminal::CellAttributes &attributes = cells[column].attributes;
+        const render::GlyphSlot &slot = slots[column - firstColumn];
+        CellInstance &instance = instances[column];
+        instance.glyphX = slot.x;
+        instance.glyphY = slot.y;
+        unpackColor(attributes.inverse ? attributes.background : attributes.foreground, instance.foreground);
+        unpackColor(attributes.inverse ? attributes.foreground : attributes.background, instance.background);
+    }
+    markInstancesDirty((row * m_columns) + firstColumn, (row * m_columns) + lastColumn);
+    markForRedraw(row, firstColumn, lastColumn);
+}
+
+void CellGridNode::setCursor(int row, int column)
+{
+    // The cursor is a uniform, so moving it never touches instance data, but
+    // the cell it leaves and the one it enters are drawn again.
+    const int cell = (row >= 0 && row < m_rows && column >= 0 && column < m_columns)
+        ? (row * m_columns) + column
+        : -1;
+    if (cell == m_cursorCell) {
+        return;
+    }
+    if (m_cursorCell >= 0) {
+        markForRedraw(m_cursorCell / m_columns, m_cursorCell % m_columns, m_cursorCell % m_columns);
+    }
+    if (cell >= 0) {
+        markForRedraw(row, column, column);
+    }
+    m_cursorCell = cell;
+}
+
+void CellGridNode::scroll(int top, int bottom, int lines)
+{
+    top = std::max(top, 0);
+    bottom = std::min(bottom, m_rows - 1);
+    const int height = (bottom - top) + 1;
+    if (lines == 0 || height <= 0 || std::abs(lines) >= height) {
+        // Nothing survives the shift; the damage spans rebuild the region.
+        return;
+    }
+
+    // Move instance data and not-yet-drawn damage along with the rows.
+    const int sourceTop = lines > 0 ? top + lines : top;
+    const int destinationTop = lines > 0 ? top : top - lines;
+    const int movedRows = height - std::abs(lines);
+    CellInstance *instances = m_instances.data();
+    std::memmove(instances + (destinationTop * m_columns), instances + (sourceTop * m_columns),
+                 sizeof(CellInstance) * static_cast<size_t>(movedRows * m_columns));
+    for (int row = destinationTop; row < destinationTop + movedRows; ++row) {
+        for (int column = 0; column < m_columns; ++column) {
+            instances[(row * m_columns) + column].row = static_cast<quint16>(row);
+        }
+    }
+    markInstancesDirty(destinationTop * m_columns, ((destinationTop + movedRows) * m_columns) - 1);
+
+    const QVector<int> movedFirst = m_redrawFirstColumn.mid(sourceTop, movedRows);
+    const QVector<int> movedLast = m_redrawLastColumn.mid(sourceTop, movedRows);
+    for (int row = top; row <= bottom; ++row) {
+        m_redrawFirstColumn[row] = m_columns;
+        m_redrawLastColumn[row] = -1;
+    }
+    m_redrawRows.erase(std::remove_if(m_redrawRows.begin(), m_redrawRows.end(),
+                                      [top, bottom](int row) { return row >= top && row <= bottom; }),
+                       m_redrawRows.end());
+    for (int index = 0; index < movedRows; ++index) {
+        if (movedLast[index] >= 0) {
+            markForRedraw(destinationTop + index, movedFirst[index], movedLast[index]);
+        }
+    }
+    // Nothing is copied into the vacated rows; they are drawn from whatever
+    // their instances hold once the damage spans have filled them.
+    const int vacatedTop = lines > 0 ? bottom - lines + 1 : top;
+    for (int row = vacatedTop; row < vacatedTop + std::abs(lines); ++row) {
+        markForRedraw(row, 0, m_columns - 1);
+    }
+
+    // The inverted cursor cell was copied along with the pixels around it, and
+    // the cell now under the cursor arrives without the inversion.
+    if (m_cursorCell >= 0) {
+        const int cursorRow = m_cursorCell / m_columns;
+        const int cursorColumn = m_cursorCell % m_columns;
+        if (cursorRow >= top && cursorRow <= bottom) {
+            const int movedRow = cursorRow - lines;
+            if (movedRow >= top && movedRow <= bottom) {
+                markForRedraw(movedRow, cursorColumn, cursorColumn);
+            }
+            markForRedraw(cursorRow, cursorColumn, cursorColumn);
+        }
+    }
+
+    if (!m_fullRedraw) {
+        m_pendingScrolls.append({top, bottom, lines});
+    }
+}
+
+void CellGridNode::prepare()
+{
+    PROFILE_FUNCTION();
+    QRhi *rhi = m_window->rhi();
+    QRhiCommandBuffer *commands = commandBuffer();
+    QRhiRenderTarget *target = renderTarget();
+    if (!rhi || !commands || !target || m_instances.isEmpty() || m_unsupported) {
+        return;
+    }
+    if (!rhi->isFeatureSupported(QRhi::Instancing)) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell renderer needs instanced drawing, which the {} backend lacks", rhi->backendName());
+        }
+        m_unsupported = true;
+        return;
+    }
+
+    QRhiResourceUpdateBatch *updates = rhi->nextResourceUpdateBatch();
+    if (!m_quadBuffer) {
+        m_quadBuffer.reset(rhi->newBuffer(QRhiBuffer::Immutable, QRhiBuffer::VertexBuffer, sizeof(kQuad)));
+        m_quadBuffer->create();
+        updates->uploadStaticBuffer(m_quadBuffer.get(), kQuad);
+        m_uniformBuffer.reset(rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, sizeof(Uniforms)));
+        m_uniformBuffer->create();
+        m_compositeUniformBuffer.reset(
+            rhi->newBuffer(QRhiBuffer::Dynamic, QRhiBuffer::UniformBuffer, sizeof(CompositeUniforms)));
+        m_compositeUniformBuffer->create();
+        m_sampler.reset(rhi->newSampler(QRhiSampler::Nearest, QRhiSampler::Nearest, QRhiSampler::None,
+                                        QRhiSampler::ClampToEdge, QRhiSampler::ClampToEdge));
+        m_sampler->create();
+    }
+
+    const QImage &atlasImage = m_atlas.image();
+    if (!m_atlasTexture || m_atlasTexture->pixelSize() != atlasImage.size()) {
+        m_atlasTexture.reset(rhi->newTexture(QRhiTexture::R8, atlasImage.size()));
+        m_atlasTexture->create();
+        m_atlas.takeDirtyRect();
+        updates->uploadTexture(m_atlasTexture.get(), atlasImage);
+        m_bindings.reset();
+    } else if (const QRect dirty = m_atlas.takeDirtyRect(); !dirty.isEmpty()) {
+        QRhiTextureSubresourceUploadDescription region(atlasImage);
+        region.setSourceTopLeft(dirty.topLeft());
+        region.setSourceSize(dirty.size());
+        region.setDestinationTopLeft(dirty.topLeft());
+        updates->uploadTexture(m_atlasTexture.get(), QRhiTextureUploadEntry(0, 0, region));
+    }
+
+    const auto stride = static_cast<quint32>(sizeof(CellInstance));
+    const quint32 instanceBytes = stride * static_cast<quint32>(m_instances.size());
+    if (!m_instanceBuffer || m_instanceBuffer->size() < instanceBytes) {
+        m_instanceBuffer.reset(rhi->newBuffer(QRhiBuffer::Static, QRhiBuffer::VertexBuffer, instanceBytes));
+        m_instanceBuffer->create();
+        markInstancesDirty(0, static_cast<int>(m_instances.size()) - 1);
+    }
+    if (m_dirtyFirst >= 0) {
+        updates->uploadStaticBuffer(m_instanceBuffer.get(), stride * m_dirtyFirst,
+                                    stride * ((m_dirtyLast - m_dirtyFirst) + 1),
+                                    m_instances.constData() + m_dirtyFirst);
+        m_dirtyFirst = -1;
+        m_dirtyLast = -1;
+    }
+
+    if (!ensureGridTexture(rhi)) {
+        updates->release();
+        return;
+    }
+    if (!m_bindings) {
+        m_bindings.reset(rhi->newShaderResourceBindings());
+        m_bindings->setBindings({
+            QRhiShaderResourceBinding::uniformBuffer(0, QRhiShaderResourceBinding::VertexStage,
+                                                     m_uniformBuffer.get()),
+            QRhiShaderResourceBinding::sampledTexture(1, QRhiShaderResourceBinding::FragmentStage,
+                                                      m_atlasTexture.get(), m_sampler.get()),
+        });
+        m_bindings->create();
+        m_pipeline.reset();
+    }
+    if (!m_pipeline && !createGridPipeline(rhi)) {
+        updates->release();
+        return;
+    }
+    QRhiRenderPassDescriptor *renderPass = target->renderPassDescriptor();
+    if (!m_compositePipeline || m_renderPassFormat != renderPass->serializedFormat()) {
+        if (!createCompositePipeline(rhi, renderPass)) {
+            updates->release();
+            return;
+        }
+    }
+
+    const QSize glyphSize = m_atlas.cellSize();
+    const QSize gridSize = m_gridTexture->pixelSize();
+    QMatrix4x4 gridProjection = rhi->clipSpaceCorrMatrix();
+    gridProjection.ortho(0.0f, static_cast<float>(gridSize.width()), static_cast<float>(gridSize.height()), 0.0f,
+                         -1.0f, 1.0f);
+    Uniforms uniforms = {};
+    std::memcpy(uniforms.matrix, gridProjection.constData(), sizeof(uniforms.matrix));
+    uniforms.glyphSize[0] = static_cast<float>(glyphSize.width());
+    uniforms.glyphSize[1] = static_cast<float>(glyphSize.height());
+    uniforms.atlasSize[0] = static_cast<float>(atlasImage.width());
+    uniforms.atlasSize[1] = static_cast<float>(atlasImage.height());
+    uniforms.columns = m_columns;
+    uniforms.cursorCell = m_cursorCell;
+    updates->updateDynamicBuffer(m_uniformBuffer.get(), 0, sizeof(Uniforms), &uniforms);
+
+    const QMatrix4x4 transform = *projectionMatrix() * *matrix();
+    CompositeUniforms composite = {};
+    std::memcpy(composite.matrix, transform.constData(), sizeof(composite.matrix));
+    composite.origin[0] = static_cast<float>(m_origin.x());
+    composite.origin[1] = static_cast<float>(m_origin.y() - (m_scrollFraction * glyphSize.height() / m_devicePixelRatio));
+    composite.size[0] = static_cast<float>(gridSize.width() / m_devicePixelRatio);
+    composite.size[1] = static_cast<float>(gridSize.height() / m_devicePixelRatio);
+    composite.opacity = static_cast<float>(inheritedOpacity());
+    composite.flipY = rhi->isYUpInFramebuffer() ? 1.0f : 0.0f;
+    updates->updateDynamicBuffer(m_compositeUniformBuffer.get(), 0, sizeof(CompositeUniforms), &composite);
+
+    if (!m_fullRedraw) {
+        applyScrolls(rhi, updates);
+    }
+    m_pendingScrolls.clear();
+
+    if (!m_fullRedraw && m_redrawRows.isEmpty()) {
+        commands->resourceUpdate(updates);
+        return;
+    }
+    // The grid target preserves its contents, so the pass only adds the
+    // redrawn cells on top of the previous frame and the clear colour is
+    // never used; a new texture starts with a full redraw.
+    commands->beginPass(m_gridTarget.get(), Qt::black, {1.0f, 0}, updates);
+    drawRedraws(commands);
+    commands->endPass();
+}
+
+void CellGridNode::render(const RenderState *state)
+{
+    PROFILE_FUNCTION();
+    if (!m_compositePipeline || !m_gridTexture || m_instances.isEmpty()) {
+        return;
+    }
+
+    QRhiCommandBuffer *commands = commandBuffer();
+    const QSize outputSize = renderTarget()->pixelSize();
+    commands->setGraphicsPipeline(m_compositePipeline.get());
+    commands->setViewport(QRhiViewport(0, 0, outputSize.width(), outputSize.height()));
+    if (state->scissorEnabled()) {
+        const QRect scissor = state->scissorRect();
+        commands->setScissor(QRhiScissor(scissor.x(), scissor.y(), scissor.width(), scissor.height()));
+    } else {
+        commands->setScissor(QRhiScissor(0, 0, outputSize.width(), outputSize.height()));
+    }
+    commands->setShaderResources();
+    const QRhiCommandBuffer::VertexInput input(m_quadBuffer.get(), 0);
+    commands->setVertexInput(0, 1, &input);
+    commands->draw(4);
+}
+
+void CellGridNode::releaseResources()
+{
+    m_compositePipeline.reset();
+    m_compositeBindings.reset();
+    m_compositeUniformBuffer.reset();
+    m_gridTarget.reset();
+    m_gridRenderPass.reset();
+    m_scrollScratch.reset();
+    m_gridTexture.reset();
+    m_pipeline.reset();
+    m_bindings.reset();
+    m_sampler.reset();
+    m_atlasTexture.reset();
+    m_uniformBuffer.reset();
+    m_instanceBuffer.reset();
+    m_quadBuffer.reset();
+    m_renderPassFormat.clear();
+    m_pendingScrolls.clear();
+    m_fullRedraw = true;
+}
+
+QSGRenderNode::StateFlags CellGridNode::changedStates() const
+{
+    return ViewportState | ScissorState;
+}
+
+QSGRenderNode::RenderingFlags CellGridNode::flags() const
+{
+    return BoundedRectRendering | NoExternalRendering;
+}
+
+QRectF CellGridNode::rect() const
+{
+    return m_rect;
+}
+
+void CellGridNode::markInstancesDirty(int first, int last)
+{
+    if (first > last) {
+        return;
+    }
+    m_dirtyFirst = m_dirtyFirst < 0 ? first : std::min(m_dirtyFirst, first);
+    m_dirtyLast = std::max(m_dirtyLast, last);
+}
+
+void CellGridNode::markForRedraw(int row, int firstColumn, int lastColumn)
+{
+    if (m_redrawLastColumn[row] < 0) {
+        m_redrawRows.append(row);
+    }
+    m_redrawFirstColumn[row] = std::min(m_redrawFirstColumn[row], firstColumn);
+    m_redrawLastColumn[row] = std::max(m_redrawLastColumn[row], lastColumn);
+}
+
+bool CellGridNode::ensureGridTexture(QRhi *rhi)
+{
+    const QSize glyphSize = m_atlas.cellSize();
+    const QSize size(m_columns * glyphSize.width(), m_rows * glyphSize.height());
+    if (m_gridTexture && m_gridTexture->pixelSize() == size) {
+        return true;
+    }
+    if (size.isEmpty() || size.width() > rhi->resourceLimit(QRhi::TextureSizeMax)
+        || size.height() > rhi->resourceLimit(QRhi::TextureSizeMax)) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell grid of {}x{} pixels does not fit a texture", size.width(), size.height());
+        }
+        m_unsupported = true;
+        return false;
+    }
+
+    m_compositePipeline.reset();
+    m_compositeBindings.reset();
+    m_gridTarget.reset();
+    m_gridRenderPass.reset();
+    m_pipeline.reset();
+
+    m_gridTexture.reset(rhi->newTexture(QRhiTexture::RGBA8, size, 1,
+                                        QRhiTexture::RenderTarget | QRhiTexture::UsedAsTransferSource));
+    m_scrollScratch.reset(rhi->newTexture(QRhiTexture::RGBA8, size, 1, QRhiTexture::UsedAsTransferSource));
+    if (!m_gridTexture->create() || !m_scrollScratch->create()) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell grid texture creation failed on the {} backend", rhi->backendName());
+        }
+        m_gridTexture.reset();
+        m_scrollScratch.reset();
+        m_unsupported = true;
+        return false;
+    }
+    m_gridTarget.reset(rhi->newTextureRenderTarget({m_gridTexture.get()},
+                                                   QRhiTextureRenderTarget::PreserveColorContents));
+    m_gridRenderPass.reset(m_gridTarget->newCompatibleRenderPassDescriptor());
+    m_gridTarget->setRenderPassDescriptor(m_gridRenderPass.get());
+    m_gridTarget->create();
+
+    m_compositeBindings.reset(rhi->newShaderResourceBindings());
+    m_compositeBindings->setBindings({
+        QRhiShaderResourceBinding::uniformBuffer(
+            0, QRhiShaderResourceBinding::VertexStage | QRhiShaderResourceBinding::FragmentStage,
+            m_compositeUniformBuffer.get()),
+        QRhiShaderResourceBinding::sampledTexture(1, QRhiShaderResourceBinding::FragmentStage,
+                                                  m_gridTexture.get(), m_sampler.get()),
+    });
+    m_compositeBindings->create();
+
+    m_pendingScrolls.clear();
+    m_fullRedraw = true;
+    return true;
+}
+
+void CellGridNode::applyScrolls(QRhi *rhi, QRhiResourceUpdateBatch *updates)
+{
+    // Each scroll copies the surviving rows out to the scratch texture and
+    // back in at their new position, in the order the scrolls happened.
+    for (const PendingScroll &scroll : std::as_const(m_pendingScrolls)) {
+        const int movedRows = ((scroll.bottom - scroll.top) + 1) - std::abs(scroll.lines);
+        const int sourceTop = scroll.lines > 0 ? scroll.top + scroll.lines : scroll.top;
+        const int destinationTop = scroll.lines > 0 ? scroll.top : scroll.top - scroll.lines;
+        const QRect source = textureRows(rhi, sourceTop, movedRows);
+        const QRect destination = textureRows(rhi, destinationTop, movedRows);
+
+        QRhiTextureCopyDescription out;
+        out.setPixelSize(source.size());
+        out.setSourceTopLeft(source.topLeft());
+        out.setDestinationTopLeft(source.topLeft());
+        updates->copyTexture(m_scrollScratch.get(), m_gridTexture.get(), out);
+
+        QRhiTextureCopyDescription back;
+        back.setPixelSize(source.size());
+        back.setSourceTopLeft(source.topLeft());
+        back.setDestinationTopLeft(destination.topLeft());
+        updates->copyTexture(m_gridTexture.get(), m_scrollScratch.get(), back);
+    }
+}
+
+void CellGridNode::drawRedraws(QRhiCommandBuffer *commands)
+{
+    const QSize gridSize = m_gridTexture->pixelSize();
+    commands->setGraphicsPipeline(m_pipeline.get());
+    commands->setViewport(QRhiViewport(0, 0, gridSize.width(), gridSize.height()));
+    commands->setShaderResources();
+
+    const auto stride = static_cast<quint32>(sizeof(CellInstance));
+    const auto drawCells = [&](int firstCell, int count) {
+        // Instances carry their own cell position, so a span is drawn by
+        // starting the instance stream at its first cell.
+        const QRhiCommandBuffer::VertexInput inputs[] = {
+            {m_quadBuffer.get(), 0},
+            {m_instanceBuffer.get(), stride * static_cast<quint32>(firstCell)},
+        };
+        commands->setVertexInput(0, 2, inputs);
+        commands->draw(4, static_cast<quint32>(count));
+    };
+
+    // Past half the rows, one draw of the whole grid is cheaper than many
+    // small ones.
+    if (m_fullRedraw || m_redrawRows.size() * 2 > m_rows) {
+        drawCells(0, static_cast<int>(m_instances.size()));
+    } else {
+        std::sort(m_redrawRows.begin(), m_redrawRows.end());
+        int runFirst = -1;
+        int runLast = -1;
+        for (const int row : std::as_const(m_redrawRows)) {
+            const int first = (row * m_columns) + m_redrawFirstColumn[row];
+            const int last = (row * m_columns) + m_redrawLastColumn[row];
+            // Spans that meet across a row boundary go out as one draw.
+            if (runFirst >= 0 && first == runLast + 1) {
+                runLast = last;
+                continue;
+            }
+            if (runFirst >= 0) {
+                drawCells(runFirst, (runLast - runFirst) + 1);
+            }
+            runFirst = first;
+            runLast = last;
+        }
+        if (runFirst >= 0) {
+            drawCells(runFirst, (runLast - runFirst) + 1);
+        }
+    }
+
+    for (const int row : std::as_const(m_redrawRows)) {
+        m_redrawFirstColumn[row] = m_columns;
+        m_redrawLastColumn[row] = -1;
+    }
+    m_redrawRows.clear();
+    m_fullRedraw = false;
+}
+
+QRect CellGridNode::textureRows(QRhi *rhi, int top, int count) const
+{
+    const QSize glyphSize = m_atlas.cellSize();
+    const int firstRow = rhi->isYUpInFramebuffer() ? m_rows - top - count : top;
+    return QRect(0, firstRow * glyphSize.height(), m_columns * glyphSize.width(), count * glyphSize.height());
+}
+
+bool CellGridNode::createGridPipeline(QRhi *rhi)
+{
+    const QShader vertexShader = loadShader(QStringLiteral(":/shaders/cell_grid.vert.qsb"));
+    const QShader fragmentShader = loadShader(QStringLiteral(":/shaders/cell_grid.frag.qsb"));
+    if (!vertexShader.isValid() || !fragmentShader.isValid()) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell renderer shaders are missing from the resources");
+        }
+        m_unsupported = true;
+        return false;
+    }
+
+    QRhiVertexInputLayout inputLayout;
+    inputLayout.setBindings({
+        {2 * sizeof(float)},
+        {sizeof(CellInstance), QRhiVertexInputBinding::PerInstance},
+    });
+    inputLayout.setAttributes({
+        {0, 0, QRhiVertexInputAttribute::Float2, 0},
+        {1, 1, QRhiVertexInputAttribute::UShort2, offsetof(CellInstance, column)},
+        {1, 2, QRhiVertexInputAttribute::UShort2, offsetof(CellInstance, glyphX)},
+        {1, 3, QRhiVertexInputAttribute::UNormByte4, offsetof(CellInstance, foreground)},
+        {1, 4, QRhiVertexInputAttribute::UNormByte4, offsetof(CellInstance, background)},
+    });
+
+    // Cells are opaque and replace whatever the texture held there.
+    m_pipeline.reset(rhi->newGraphicsPipeline());
+    m_pipeline->setTopology(QRhiGraphicsPipeline::TriangleStrip);
+    m_pipeline->setShaderStages({
+        {QRhiShaderStage::Vertex, vertexShader},
+        {QRhiShaderStage::Fragment, fragmentShader},
+    });
+    m_pipeline->setVertexInputLayout(inputLayout);
+    m_pipeline->setShaderResourceBindings(m_bindings.get());
+    m_pipeline->setRenderPassDescriptor(m_gridRenderPass.get());
+    if (!m_pipeline->create()) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell renderer pipeline creation failed on the {} backend", rhi->backendName());
+        }
+        m_pipeline.reset();
+        m_unsupported = true;
+        return false;
+    }
+    return true;
+}
+
+bool CellGridNode::createCompositePipeline(QRhi *rhi, QRhiRenderPassDescriptor *renderPass)
+{
+    const QShader vertexShader = loadShader(QStringLiteral(":/shaders/grid_composite.vert.qsb"));
+    const QShader fragmentShader = loadShader(QStringLiteral(":/shaders/grid_composite.frag.qsb"));
+    if (!vertexShader.isValid() || !fragmentShader.isValid()) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell renderer shaders are missing from the resources");
+        }
+        m_unsupported = true;
+        return false;
+    }
+
+    // Output is premultiplied, so partial item opacity blends correctly.
+    QRhiGraphicsPipeline::TargetBlend blend;
+    blend.enable = true;
+    blend.srcColor = QRhiGraphicsPipeline::One;
+    blend.dstColor = QRhiGraphicsPipeline::OneMinusSrcAlpha;
+    blend.srcAlpha = QRhiGraphicsPipeline::One;
+    blend.dstAlpha = QRhiGraphicsPipeline::OneMinusSrcAlpha;
+
+    QRhiVertexInputLayout inputLayout;
+    inputLayout.setBindings({{2 * sizeof(float)}});
+    inputLayout.setAttributes({{0, 0, QRhiVertexInputAttribute::Float2, 0}});
+
+    m_compositePipeline.reset(rhi->newGraphicsPipeline());
+    m_compositePipeline->setFlags(QRhiGraphicsPipeline::UsesScissor);
+    m_compositePipeline->setTopology(QRhiGraphicsPipeline::TriangleStrip);
+    m_compositePipeline->setTargetBlends({blend});
+    m_compositePipeline->setSampleCount(renderTarget()->sampleCount());
+    m_compositePipeline->setShaderStages({
+        {QRhiShaderStage::Vertex, vertexShader},
+        {QRhiShaderStage::Fragment, fragmentShader},
+    });
+    m_compositePipeline->setVertexInputLayout(inputLayout);
+    m_compositePipeline->setShaderResourceBindings(m_compositeBindings.get());
+    m_compositePipeline->setRenderPassDescriptor(renderPass);
+    if (!m_compositePipeline->create()) {
+        if (auto logger = terminalLogger()) {
+            logger->error("Cell renderer pipeline creation failed on the {} backend", rhi->backendName());
+        }
+        m_compositePipeline.reset();
+        m_unsupported = true;
+        return false;
+    }
+    m_renderPassFormat = renderPass->serializedFormat();
+    return true;
+}
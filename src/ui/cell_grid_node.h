@@ -0,0 +1,130 @@
+#pragma once
+
+#include "render/glyph_atlas.h"
+#include "render/row_shaper.h"
+
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+#include <QSGRenderNode>
+#include <QVector>
+#include <rhi/qrhi.h>
+
+#include <memory>
+
+class QQuickWindow;
+
+namespace terminal
+{
+struct Cell;
+}
+
+// Draws the terminal grid through QRhi, so it works on every scene graph
+// backend except software. Each cell is one instanced quad whose glyph
+// coverage comes from a GlyphAtlas texture. The cells are drawn into a
+// persistent texture that keeps its contents between frames: scrolled rows
+// are moved with texture copies and only cells changed since the last frame
+// are drawn again. The texture is then composited into the window's render
+// pass as a single quad, offset for smooth scrolling.
+class CellGridNode : public QSGRenderNode
+{
+public:
+    explicit CellGridNode(QQuickWindow *window);
+    ~CellGridNode() override;
+
+    void setFont(const QFont &font, qreal devicePixelRatio, const QStringList &fallbackFamilies = {});
+    quint32 atlasGeneration() const { return m_atlas.generation(); }
+
+    // Item bounds, and where the first cell starts within them.
+    void setGeometry(const QRectF &rect, const QPointF &origin);
+    // Moves the grid up by this fraction of a row, for smooth scrolling.
+    void setScrollFraction(qreal rows) { m_scrollFraction = rows; }
+
+    int rows() const { return m_rows; }
+    int columns() const { return m_columns; }
+
+    void resize(int rows, int columns);
+    void updateRow(int row, const terminal::Cell *cells, int firstColumn = 0, int lastColumn = -1);
+    void setCursor(int row, int column);
+    // Shifts rows top..bottom by lines (positive: up), matching ScreenBuffer.
+    void scroll(int top, int bottom, int lines);
+
+    void prepare() override;
+    void render(const RenderState *state) override;
+    void releaseResources() override;
+    StateFlags changedStates() const override;
+    RenderingFlags flags() const override;
+    QRectF rect() const override;
+
+private:
+    struct CellInstance
+    {
+        quint16 column;
+        quint16 row;
+        quint16 glyphX;
+        quint16 glyphY;
+        quint8 foreground[4];
+        quint8 background[4];
+    };
+
+    struct PendingScroll
+    {
+        int top;
+        int bottom;
+        int lines;
+    };
+
+    void markInstancesDirty(int first, int last);
+    void markForRedraw(int row, int firstColumn, int lastColumn);
+    bool ensureGridTexture(QRhi *rhi);
+    void applyScrolls(QRhi *rhi, QRhiResourceUpdateBatch *updates);
+    void drawRedraws(QRhiCommandBuffer *commands);
+    // Texel rect of count grid rows from top; rendered rows are stored
+    // bottom-up where the framebuffer's Y axis points up.
+    QRect textureRows(QRhi *rhi, int top, int count) const;
+    bool createGridPipeline(QRhi *rhi);
+    bool createCompositePipeline(QRhi *rhi, QRhiRenderPassDescriptor *renderPass);
+
+    QQuickWindow *m_window;
+    render::GlyphAtlas m_atlas;
+    render::RowShaper m_shaper;
+    qreal m_devicePixelRatio = 1.0;
+    QRectF m_rect;
+    QPointF m_origin;
+    qreal m_scrollFraction = 0.0;
+
+    QVector<CellInstance> m_instances;
+    int m_rows = 0;
+    int m_columns = 0;
+    int m_cursorCell = -1;
+    int m_dirtyFirst = -1;
+    int m_dirtyLast = -1;
+
+    // Cells whose pixels in the grid texture are out of date.
+    QVector<int> m_redrawRows;
+    QVector<int> m_redrawFirstColumn;
+    QVector<int> m_redrawLastColumn;
+    QVector<PendingScroll> m_pendingScrolls;
+    bool m_fullRedraw = true;
+
+    std::unique_ptr<QRhiBuffer> m_quadBuffer;
+    std::unique_ptr<QRhiBuffer> m_instanceBuffer;
+    std::unique_ptr<QRhiBuffer> m_uniformBuffer;
+    std::unique_ptr<QRhiTexture> m_atlasTexture;
+    std::unique_ptr<QRhiSampler> m_sampler;
+    std::unique_ptr<QRhiShaderResourceBindings> m_bindings;
+    std::unique_ptr<QRhiGraphicsPipeline> m_pipeline;
+
+    // The persistent grid, and a scratch copy scrolls go through because
+    // copies within one texture may not overlap.
+    std::unique_ptr<QRhiTexture> m_gridTexture;
+    std::unique_ptr<QRhiTexture> m_scrollScratch;
+    std::unique_ptr<QRhiTextureRenderTarget> m_gridTarget;
+    std::unique_ptr<QRhiRenderPassDescriptor> m_gridRenderPass;
+
+    std::unique_ptr<QRhiBuffer> m_compositeUniformBuffer;
+    std::unique_ptr<QRhiShaderResourceBindings> m_compositeBindings;
+    std::unique_ptr<QRhiGraphicsPipeline> m_compositePipeline;
+    QVector<quint32> m_renderPassFormat;
+    bool m_unsupported = false;
+};
@@ -0,0 +1,177 @@
+#include "frame_scheduler.h"
+
+#include "terminal/latency_tracker.h"
+#include "terminal/metrics.h"
+#include "terminal/profiling.h"
+#include "terminal/startup_trace.h"
+#include "terminal/trace.h"
+
+#include <QEvent>
+#include <QQuickItem>
+#include <QQuickWindow>
+
+namespace {
+constexpr int kCursorBlinkIntervalMs = 530;
+// Longest wait for a swap before the frame is given up on: an obscured
+// window may stop rendering without being reported unexposed, and a scene
+// graph reset drops the frame in flight.
+constexpr int kSwapTimeoutMs = 250;
+}
+
+FrameScheduler::FrameScheduler(QQuickItem *item)
+    : QObject(item)
+    , m_item(item)
+{
+    m_blinkTimer.setInterval(kCursorBlinkIntervalMs);
+    connect(&m_blinkTimer, &QTimer::timeout, this, [this]() {
+        m_cursorBlinkVisible = !m_cursorBlinkVisible;
+        requestFrame(CursorBlink);
+    });
+    m_swapTimeout.setSingleShot(true);
+    m_swapTimeout.setInterval(kSwapTimeoutMs);
+    connect(&m_swapTimeout, &QTimer::timeout, this, [this]() {
+        m_framePending = false;
+        if (!m_suspended && (m_deferredReasons || m_animating)) {
+            issueFrame();
+        }
+    });
+}
+
+void FrameScheduler::setWindow(QQuickWindow *window)
+{
+    QObject::disconnect(m_frameSwappedConnection);
+    QObject::disconnect(m_visibilityConnection);
+    m_swapTimeout.stop();
+    if (m_window) {
+        m_window->removeEventFilter(this);
+    }
+    m_window = window;
+    m_framePending = false;
+    if (window) {
+        // frameSwapped is emitted on the render thread; the receiver context
+        // makes this a queued call back onto the GUI thread.
+        m_frameSwappedConnection = connect(window, &QQuickWindow::frameSwapped,
+                                           this, &FrameScheduler::handleFrameSwapped);
+        // Minimising changes the visibility; being covered only shows up as
+        // an expose event, where the platform reports it at all.
+        m_visibilityConnection = connect(window, &QWindow::visibilityChanged,
+                                         this, &FrameScheduler::updateExposure);
+        window->installEventFilter(this);
+    }
+    updateExposure();
+}
+
+void FrameScheduler::requestFrame(Reason reason)
+{
+    if (m_framePending || m_suspended) {
+        m_deferredReasons |= reason;
+        return;
+    }
+    issueFrame();
+}
+
+void FrameScheduler::setAnimating(bool animating)
+{
+    if (m_animating == animating) {
+        return;
+    }
+    m_animating = animating;
+    if (animating) {
+        requestFrame(Animation);
+    }
+}
+
+void FrameScheduler::setCursorBlinking(bool blinking)
+{
+    if (blinking == m_cursorBlinking) {
+        return;
+    }
+    m_cursorBlinking = blinking;
+    if (blinking) {
+        if (!m_suspended) {
+            m_blinkTimer.start();
+        }
+    } else {
+        m_blinkTimer.stop();
+        if (!m_cursorBlinkVisible) {
+            m_cursorBlinkVisible = true;
+            requestFrame(CursorBlink);
+        }
+    }
+}
+
+void FrameScheduler::restartCursorBlink()
+{
+    if (!m_blinkTimer.isActive()) {
+        return;
+    }
+    m_blinkTimer.start();
+    if (!m_cursorBlinkVisible) {
+        m_cursorBlinkVisible = true;
+        requestFrame(CursorBlink);
+    }
+}
+
+void FrameScheduler::handleFrameSwapped()
+{
+    terminal::Metrics &metrics = terminal::metrics();
+    if (m_framePending) {
+        const qint64 frameTime = m_frameTimer.nsecsElapsed();
+        metrics.set(terminal::Metrics::FrameTimeNanoseconds, frameTime);
+        terminal::trace(terminal::TraceEvent::FrameTime, frameTime);
+    }
+    if (metrics.value(terminal::Metrics::FramesTotal) == 0) {
+        terminal::startupTrace().mark("first frame");
+    }
+    metrics.add(terminal::Metrics::FramesTotal, 1);
+    m_framePending = false;
+    m_swapTimeout.stop();
+    terminal::latencyTracker().framePresented();
+    PROFILE_FRAME();
+    if (!m_suspended && (m_deferredReasons || m_animating)) {
+        issueFrame();
+    }
+}
+
+void FrameScheduler::issueFrame()
+{
+    m_deferredReasons = {};
+    m_framePending = true;
+    m_swapTimeout.start();
+    m_frameTimer.start();
+    // Items that prepare their frame on the GUI thread do it in updatePolish().
+    m_item->polish();
+    m_item->update();
+}
+
+bool FrameScheduler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_window.data() && event->type() == QEvent::Expose) {
+        updateExposure();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void FrameScheduler::updateExposure()
+{
+    const bool suspended = !m_window || !m_window->isExposed()
+        || m_window->visibility() == QWindow::Minimized;
+    if (suspended == m_suspended) {
+        return;
+    }
+    m_suspended = suspended;
+    if (suspended) {
+        // A hidden window may never swap the frame in flight.
+        m_framePending = false;
+        m_swapTimeout.stop();
+        m_blinkTimer.stop();
+    } else {
+        m_cursorBlinkVisible = true;
+        if (m_cursorBlinking) {
+            m_blinkTimer.start();
+        }
+        // Whatever changed while hidden is drawn in this one frame.
+        issueFrame();
+    }
+    emit exposedChanged(!suspended);
+}
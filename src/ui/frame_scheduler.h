@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFlags>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class QEvent;
+class QQuickItem;
+class QQuickWindow;
+
+// Requests frames for one item only when something visible changed, at most
+// one per vsync: a request made while a frame is in flight is deferred until
+// the window reports the swap. With no damage, blink or animation pending the
+// item produces no frames at all, and none while its window is minimised or
+// covered: requests made then are kept and drawn as one frame on re-expose.
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Reason {
+        Damage = 0x1,
+        CursorBlink = 0x2,
+        Selection = 0x4,
+        Animation = 0x8,
+        Appearance = 0x10,
+        Scroll = 0x20,
+    };
+    Q_DECLARE_FLAGS(Reasons, Reason)
+
+    explicit FrameScheduler(QQuickItem *item);
+
+    void setWindow(QQuickWindow *window);
+    void requestFrame(Reason reason);
+    bool exposed() const { return !m_suspended; }
+
+    // While animating, every swap requests the next frame.
+    void setAnimating(bool animating);
+
+    void setCursorBlinking(bool blinking);
+    bool cursorBlinkVisible() const { return m_cursorBlinkVisible; }
+    // Input and output restart the blink cycle with the cursor shown.
+    void restartCursorBlink();
+
+signals:
+    void exposedChanged(bool exposed);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void handleFrameSwapped();
+    void issueFrame();
+    void updateExposure();
+
+    QQuickItem *m_item;
+    QPointer<QQuickWindow> m_window;
+    QMetaObject::Connection m_frameSwappedConnection;
+    QMetaObject::Connection m_visibilityConnection;
+    QTimer m_blinkTimer;
+    // Clears m_framePending if the swap for it never arrives.
+    QTimer m_swapTimeout;
+    // Started when this item's frame is requested; read at its swap.
+    QElapsedTimer m_frameTimer;
+    Reasons m_deferredReasons;
+    bool m_framePending = false;
+    bool m_animating = false;
+    bool m_suspended = false;
+    bool m_cursorBlinking = false;
+    bool m_cursorBlinkVisible = true;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(FrameScheduler::Reasons)
@@ -0,0 +1,85 @@
+#include "latency_test.h"
+
+#include "terminal/latency_tracker.h"
+#include "terminal/logger.h"
+#include "terminal/terminal_bridge.h"
+
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QQuickWindow>
+#include <QTextStream>
+
+namespace {
+
+// Long enough for the window to be exposed and cat to start.
+constexpr int kStartDelayMs = 1000;
+// Slower than the echo round trip, so keystrokes are measured one at a time.
+constexpr int kKeyIntervalMs = 25;
+constexpr int kDrainPollMs = 50;
+constexpr int kMaxDrainPolls = 40;
+constexpr int kColumnsPerLine = 60;
+
+}
+
+LatencyTest::LatencyTest(QQuickWindow *window, TerminalBridge *terminal, int keystrokes, QObject *parent)
+    : QObject(parent)
+    , m_window(window)
+    , m_terminal(terminal)
+    , m_keystrokes(keystrokes)
+{
+    m_timer.setInterval(kKeyIntervalMs);
+    connect(&m_timer, &QTimer::timeout, this, &LatencyTest::typeNext);
+}
+
+void LatencyTest::start()
+{
+    if (!m_window || !m_terminal) {
+        finish();
+        return;
+    }
+    m_terminal->setCommandOverride(QStringLiteral("cat"));
+    QTimer::singleShot(kStartDelayMs, this, [this]() {
+        terminal::latencyTracker().reset();
+        m_timer.start();
+    });
+}
+
+void LatencyTest::typeNext()
+{
+    if (!m_window || m_typed >= m_keystrokes) {
+        m_timer.stop();
+        waitForEchoes();
+        return;
+    }
+
+    // Break lines so the test also covers cat's line echo and scrolling.
+    const bool newline = (m_typed + 1) % kColumnsPerLine == 0;
+    const int key = newline ? Qt::Key_Return : Qt::Key_A + (m_typed % 26);
+    const QString text = newline ? QStringLiteral("\r") : QString(QLatin1Char('a' + (m_typed % 26)));
+    QCoreApplication::postEvent(m_window, new QKeyEvent(QEvent::KeyPress, key, Qt::NoModifier, text));
+    QCoreApplication::postEvent(m_window, new QKeyEvent(QEvent::KeyRelease, key, Qt::NoModifier, text));
+    ++m_typed;
+}
+
+void LatencyTest::waitForEchoes()
+{
+    if (terminal::latencyTracker().hasOpenSamples() && m_drainPolls++ < kMaxDrainPolls) {
+        QTimer::singleShot(kDrainPollMs, this, &LatencyTest::waitForEchoes);
+        return;
+    }
+    finish();
+}
+
+void LatencyTest::finish()
+{
+    const terminal::LatencyTracker &tracker = terminal::latencyTracker();
+    const QString report = tracker.report();
+    QTextStream(stdout) << "Typed " << m_typed << " keys into cat, " << tracker.completedSamples()
+                        << " reached the screen\n"
+                        << report << Qt::endl;
+    if (auto logger = terminalLogger()) {
+        logger->info("Latency test report\n{}", report.toStdString());
+    }
+    QCoreApplication::exit(tracker.completedSamples() > 0 ? 0 : 1);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class QQuickWindow;
+class TerminalBridge;
+
+// --latency-test: swaps the shell for `cat`, types a fixed run of keys into
+// the window through the normal key event path and prints the per-stage
+// latency report once every echo has been presented, then quits.
+class LatencyTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    LatencyTest(QQuickWindow *window, TerminalBridge *terminal, int keystrokes, QObject *parent = nullptr);
+
+    void start();
+
+private:
+    void typeNext();
+    void waitForEchoes();
+    void finish();
+
+    QPointer<QQuickWindow> m_window;
+    QPointer<TerminalBridge> m_terminal;
+    QTimer m_timer;
+    int m_keystrokes;
+    int m_typed = 0;
+    int m_drainPolls = 0;
+};
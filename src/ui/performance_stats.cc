@@ -0,0 +1,73 @@
+#include "performance_stats.h"
+
+namespace {
+
+constexpr int kSampleIntervalMs = 500;
+constexpr qreal kMegabyte = 1024.0 * 1024.0;
+
+qreal ratio(std::int64_t numerator, std::int64_t denominator)
+{
+    return denominator > 0 ? static_cast<qreal>(numerator) / static_cast<qreal>(denominator) : 0.0;
+}
+
+}
+
+PerformanceStats::PerformanceStats(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setInterval(kSampleIntervalMs);
+    connect(&m_timer, &QTimer::timeout, this, &PerformanceStats::sample);
+}
+
+void PerformanceStats::setActive(bool active)
+{
+    if (active == isActive()) {
+        return;
+    }
+    if (active) {
+        m_previous = snapshot();
+        m_interval.start();
+        m_timer.start();
+    } else {
+        m_timer.stop();
+    }
+    emit activeChanged();
+}
+
+PerformanceStats::Snapshot PerformanceStats::snapshot() const
+{
+    Snapshot values;
+    const terminal::Metrics &metrics = terminal::metrics();
+    for (int id = 0; id < terminal::Metrics::Count; ++id) {
+        values[id] = metrics.value(static_cast<terminal::Metrics::Id>(id));
+    }
+    return values;
+}
+
+void PerformanceStats::sample()
+{
+    using terminal::Metrics;
+
+    const Snapshot current = snapshot();
+    const qreal seconds = m_interval.restart() / 1000.0;
+    Snapshot delta;
+    for (int id = 0; id < Metrics::Count; ++id) {
+        delta[id] = current[id] - m_previous[id];
+    }
+    m_previous = current;
+
+    m_frameTimeMs = current[Metrics::FrameTimeNanoseconds] / 1e6;
+    m_framesPerSecond = seconds > 0.0 ? delta[Metrics::FramesTotal] / seconds : 0.0;
+    m_parseMegabytesPerSecond =
+        ratio(delta[Metrics::ParsedBytesTotal], delta[Metrics::ParseNanosecondsTotal]) * 1e9 / kMegabyte;
+    m_ptyBytesPerSecond = seconds > 0.0 ? delta[Metrics::PtyBytesTotal] / seconds : 0.0;
+    m_dirtyCellsPerFrame = ratio(delta[Metrics::DirtyCellsTotal], delta[Metrics::FramesTotal]);
+    m_scrollbackMegabytes = current[Metrics::ScrollbackBytes] / kMegabyte;
+    const std::int64_t runLookups = delta[Metrics::GlyphRunHitsTotal] + delta[Metrics::GlyphRunMissesTotal];
+    m_glyphRunHitRate = runLookups > 0 ? ratio(delta[Metrics::GlyphRunHitsTotal], runLookups) : 1.0;
+    const std::int64_t glyphLookups = delta[Metrics::GlyphLookupsTotal];
+    m_glyphAtlasHitRate = glyphLookups > 0
+        ? 1.0 - ratio(delta[Metrics::GlyphsRasterisedTotal], glyphLookups)
+        : 1.0;
+    emit updated();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "terminal/metrics.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include <array>
+
+// Rates derived from terminal::metrics() for the performance HUD. Sampling
+// only runs while active, so a hidden HUD costs nothing.
+class PerformanceStats : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(qreal frameTimeMs READ frameTimeMs NOTIFY updated)
+    Q_PROPERTY(qreal framesPerSecond READ framesPerSecond NOTIFY updated)
+    Q_PROPERTY(qreal parseMegabytesPerSecond READ parseMegabytesPerSecond NOTIFY updated)
+    Q_PROPERTY(qreal ptyBytesPerSecond READ ptyBytesPerSecond NOTIFY updated)
+    Q_PROPERTY(qreal dirtyCellsPerFrame READ dirtyCellsPerFrame NOTIFY updated)
+    Q_PROPERTY(qreal scrollbackMegabytes READ scrollbackMegabytes NOTIFY updated)
+    Q_PROPERTY(qreal glyphRunHitRate READ glyphRunHitRate NOTIFY updated)
+    Q_PROPERTY(qreal glyphAtlasHitRate READ glyphAtlasHitRate NOTIFY updated)
+
+public:
+    explicit PerformanceStats(QObject *parent = nullptr);
+
+    bool isActive() const { return m_timer.isActive(); }
+    void setActive(bool active);
+
+    qreal frameTimeMs() const { return m_frameTimeMs; }
+    qreal framesPerSecond() const { return m_framesPerSecond; }
+    qreal parseMegabytesPerSecond() const { return m_parseMegabytesPerSecond; }
+    qreal ptyBytesPerSecond() const { return m_ptyBytesPerSecond; }
+    qreal dirtyCellsPerFrame() const { return m_dirtyCellsPerFrame; }
+    qreal scrollbackMegabytes() const { return m_scrollbackMegabytes; }
+    // Fractions in [0, 1] over the last sampling interval.
+    qreal glyphRunHitRate() const { return m_glyphRunHitRate; }
+    qreal glyphAtlasHitRate() const { return m_glyphAtlasHitRate; }
+
+signals:
+    void activeChanged();
+    void updated();
+
+private:
+    using Snapshot = std::array<std::int64_t, terminal::Metrics::Count>;
+
+    Snapshot snapshot() const;
+    void sample();
+
+    QTimer m_timer;
+    QElapsedTimer m_interval;
+    Snapshot m_previous{};
+    qreal m_frameTimeMs = 0.0;
+    qreal m_framesPerSecond = 0.0;
+    qreal m_parseMegabytesPerSecond = 0.0;
+    qreal m_ptyBytesPerSecond = 0.0;
+    qreal m_dirtyCellsPerFrame = 0.0;
+    qreal m_scrollbackMegabytes = 0.0;
+    qreal m_glyphRunHitRate = 0.0;
+    qreal m_glyphAtlasHitRate = 0.0;
+};
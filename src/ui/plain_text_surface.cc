@@ -1,148 +1,122 @@
 #include "plain_text_surface.h"
 
+#include "cell_grid_node.h"
+#include "surface_controller.h"
+#include "terminal/profiling.h"
 #include "terminal/terminal_bridge.h"
 
-#include <QColor>
-#include <QFont>
-#include <QOpenGLFramebufferObject>
-#include <QOpenGLFramebufferObjectFormat>
-#include <QOpenGLFunctions>
-#include <QOpenGLPaintDevice>
-#include <QPainter>
-#include <QStringList>
-#include <QtMath>
-
-namespace {
-class PlainTextRenderer : public QQuickFramebufferObject::Renderer, protected QOpenGLFunctions
-{
-public:
-    explicit PlainTextRenderer(const PlainTextSurface *surface)
-        : m_surface(surface)
-    {
-        initializeOpenGLFunctions();
-        m_font.setFamily("monospace");
-        m_font.setPointSize(13);
-    }
-
-    QOpenGLFramebufferObject *createFramebufferObject(const QSize &size) override
-    {
-        if (size.width() <= 0 || size.height() <= 0) {
-            return nullptr;
-        }
-        QOpenGLFramebufferObjectFormat format;
-        format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
-        m_paintDevice.setSize(size);
-        return new QOpenGLFramebufferObject(size, format);
-    }
-
-    void render() override
-    {
-        auto *fbo = framebufferObject();
-        if (!fbo) {
-            return;
-        }
-
-        const QSize size = fbo->size();
-        glViewport(0, 0, size.width(), size.height());
-        glClearColor(0.07f, 0.07f, 0.07f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        m_paintDevice.setSize(size);
-
-        QPainter painter(&m_paintDevice);
-        painter.setRenderHint(QPainter::TextAntialiasing, true);
-        painter.fillRect(QRect(QPoint(0, 0), size), QColor(16, 16, 16));
-        painter.setPen(QColor(80, 240, 120));
-        m_font.setFamily(m_surface->fontFamily());
-        m_font.setPointSizeF(m_surface->fontPointSize());
-        painter.setFont(m_font);
-
-        const TerminalBridge *terminal = qobject_cast<TerminalBridge *>(m_surface->terminal());
-        if (terminal) {
-            const QString text = terminal->buffer();
-            const QStringList lines = text.split('\n');
-            const qreal lineHeight = m_surface->fontPointSize() + 4;
-            qreal y = lineHeight;
-            for (const QString &line : lines) {
-                painter.drawText(QPointF(6, y), line);
-                y += lineHeight;
-                if (y > size.height() + lineHeight) {
-                    break;
-                }
-            }
-        }
-        painter.end();
-
-        update();
-    }
-
-private:
-    const PlainTextSurface *m_surface;
-    QOpenGLPaintDevice m_paintDevice;
-    QFont m_font;
-};
-} // namespace
+#include <QQuickWindow>
 
 PlainTextSurface::PlainTextSurface(QQuickItem *parent)
-    : QQuickFramebufferObject(parent)
+    : QQuickItem(parent)
+    , m_controller(new SurfaceController(this))
 {
-    setMirrorVertically(true);
+    setFlag(ItemHasContents, true);
+    // The grid has an extra row for smooth scrolling that must not spill out.
+    setClip(true);
 }
 
-QQuickFramebufferObject::Renderer *PlainTextSurface::createRenderer() const
+QSGNode *PlainTextSurface::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
 {
-    return new PlainTextRenderer(this);
+    PROFILE_FUNCTION();
+    // Runs on the render thread while the GUI thread is blocked, so the
+    // terminal's screen can be read directly.
+    auto *node = static_cast<CellGridNode *>(oldNode);
+    TerminalBridge *terminal = m_controller->terminal();
+    if (!terminal || !window()) {
+        delete node;
+        return nullptr;
+    }
+    if (!node) {
+        node = new CellGridNode(window());
+    }
+
+    const qreal devicePixelRatio = window()->effectiveDevicePixelRatio();
+    node->setFont(m_controller->font(), devicePixelRatio, m_controller->fallbackFamilies());
+    const qreal padding = qRound(SurfaceController::kPadding * devicePixelRatio) / devicePixelRatio;
+    node->setGeometry(boundingRect(), QPointF(padding, padding));
+
+    m_controller->viewport().sync(*node, *terminal, m_controller->cursorVisible());
+    node->markDirty(QSGNode::DirtyMaterial);
+    return node;
 }
 
 QObject *PlainTextSurface::terminal() const
 {
-    return m_terminal;
+    return m_controller->terminal();
 }
 
 void PlainTextSurface::setTerminal(QObject *terminal)
 {
-    if (m_terminal == terminal) {
-        return;
+    if (m_controller->setTerminal(terminal)) {
+        emit terminalChanged();
     }
+}
 
-    if (m_terminal) {
-        QObject::disconnect(m_bufferConnection);
-    }
+void PlainTextSurface::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    m_controller->geometryChange(newGeometry, oldGeometry);
+}
 
-    m_terminal = qobject_cast<TerminalBridge *>(terminal);
-    if (m_terminal) {
-        m_bufferConnection = connect(m_terminal, &TerminalBridge::bufferChanged, this, &PlainTextSurface::update);
-    }
-    emit terminalChanged();
-    update();
+void PlainTextSurface::scrollToBottom()
+{
+    m_controller->scrollToBottom();
+}
+
+void PlainTextSurface::wheelEvent(QWheelEvent *event)
+{
+    m_controller->wheelEvent(event);
+}
+
+void PlainTextSurface::keyPressEvent(QKeyEvent *event)
+{
+    m_controller->keyPressEvent(event);
+}
+
+void PlainTextSurface::updatePolish()
+{
+    m_controller->advanceScroll();
+}
+
+void PlainTextSurface::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    m_controller->itemChange(change, value);
+    QQuickItem::itemChange(change, value);
 }
 
 QString PlainTextSurface::fontFamily() const
 {
-    return m_fontFamily;
+    return m_controller->fontFamily();
 }
 
 void PlainTextSurface::setFontFamily(const QString &family)
 {
-    if (m_fontFamily == family) {
-        return;
+    if (m_controller->setFontFamily(family)) {
+        emit fontFamilyChanged();
     }
-    m_fontFamily = family;
-    emit fontFamilyChanged();
-    update();
 }
 
 qreal PlainTextSurface::fontPointSize() const
 {
-    return m_fontPointSize;
+    return m_controller->fontPointSize();
 }
 
 void PlainTextSurface::setFontPointSize(qreal pointSize)
 {
-    if (qFuzzyCompare(m_fontPointSize, pointSize)) {
-        return;
+    if (m_controller->setFontPointSize(pointSize)) {
+        emit fontPointSizeChanged();
+    }
+}
+
+QString PlainTextSurface::fontFallback() const
+{
+    return m_controller->fontFallback();
+}
+
+void PlainTextSurface::setFontFallback(const QString &families)
+{
+    if (m_controller->setFontFallback(families)) {
+        emit fontFallbackChanged();
     }
-    m_fontPointSize = pointSize;
-    emit fontPointSizeChanged();
-    update();
 }
@@ -1,24 +1,26 @@
 #pragma once
 
-#include <QMetaObject>
-#include <QPointer>
-#include <QQuickFramebufferObject>
+#include <QQuickItem>
 #include <QString>
 
-class TerminalBridge;
+class SurfaceController;
 
-class PlainTextSurface : public QQuickFramebufferObject
+// Terminal view for every RHI scene graph backend. A CellGridNode keeps the
+// cells in a texture it updates incrementally and composites into the
+// window's render pass; RasterTerminalSurface covers the software backend.
+class PlainTextSurface : public QQuickItem
 {
     Q_OBJECT
     Q_PROPERTY(QObject *terminal READ terminal WRITE setTerminal NOTIFY terminalChanged)
     Q_PROPERTY(QString fontFamily READ fontFamily WRITE setFontFamily NOTIFY fontFamilyChanged)
     Q_PROPERTY(qreal fontPointSize READ fontPointSize WRITE setFontPointSize NOTIFY fontPointSizeChanged)
+    // Comma-separated families tried for codepoints the main font lacks;
+    // empty uses FontFallbackChain's defaults.
+    Q_PROPERTY(QString fontFallback READ fontFallback WRITE setFontFallback NOTIFY fontFallbackChanged)
 
 public:
     explicit PlainTextSurface(QQuickItem *parent = nullptr);
 
-    Renderer *createRenderer() const override;
-
     QObject *terminal() const;
     void setTerminal(QObject *terminal);
 
@@ -28,14 +30,26 @@ public:
     qreal fontPointSize() const;
     void setFontPointSize(qreal pointSize);
 
+    QString fontFallback() const;
+    void setFontFallback(const QString &families);
+
+    // Leaves scrollback and follows the live screen again.
+    Q_INVOKABLE void scrollToBottom();
+
 signals:
     void terminalChanged();
     void fontFamilyChanged();
     void fontPointSizeChanged();
+    void fontFallbackChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void updatePolish() override;
 
 private:
-    QPointer<TerminalBridge> m_terminal;
-    QMetaObject::Connection m_bufferConnection;
-    QString m_fontFamily = QStringLiteral("monospace");
-    qreal m_fontPointSize = 13.0;
+    SurfaceController *m_controller;
 };
@@ -0,0 +1,128 @@
+#include "raster_terminal_surface.h"
+
+#include "surface_controller.h"
+#include "terminal/profiling.h"
+#include "terminal/terminal_bridge.h"
+
+#include <QPainter>
+
+RasterTerminalSurface::RasterTerminalSurface(QQuickItem *parent)
+    : QQuickPaintedItem(parent)
+    , m_controller(new SurfaceController(this))
+{
+    setOpaquePainting(true);
+    setFillColor(QColor(0x10, 0x10, 0x10));
+    setClip(true);
+}
+
+void RasterTerminalSurface::paint(QPainter *painter)
+{
+    PROFILE_FUNCTION();
+    // The painter clip is the union of the bands marked in updatePolish().
+    const qreal ratio = m_controller->devicePixelRatio();
+    const qreal padding = qRound(SurfaceController::kPadding * ratio) / ratio;
+    const qreal shift = m_rasterizer.scrollFraction() * m_rasterizer.cellSize().height() / ratio;
+    painter->drawImage(QPointF(padding, padding - shift), m_rasterizer.image());
+}
+
+QObject *RasterTerminalSurface::terminal() const
+{
+    return m_controller->terminal();
+}
+
+void RasterTerminalSurface::setTerminal(QObject *terminal)
+{
+    if (m_controller->setTerminal(terminal)) {
+        emit terminalChanged();
+    }
+}
+
+void RasterTerminalSurface::updatePolish()
+{
+    PROFILE_FUNCTION();
+    TerminalBridge *terminal = m_controller->terminal();
+    if (!terminal) {
+        return;
+    }
+
+    m_controller->advanceScroll();
+
+    const qreal ratio = m_controller->devicePixelRatio();
+    m_rasterizer.setFont(m_controller->font(), ratio, m_controller->fallbackFamilies());
+    const qreal previousFraction = m_rasterizer.scrollFraction();
+    m_controller->viewport().sync(m_rasterizer, *terminal, m_controller->cursorVisible());
+    if (m_rasterizer.scrollFraction() != previousFraction) {
+        // The whole image moved by a sub-row amount.
+        update();
+    }
+
+    const qreal padding = qRound(SurfaceController::kPadding * ratio);
+    const qreal shift = m_rasterizer.scrollFraction() * m_rasterizer.cellSize().height();
+    for (const QRect &band : m_rasterizer.rasterize()) {
+        const QRectF pixels(band.x() + padding, band.y() + padding - shift, band.width(), band.height());
+        update(QRectF(pixels.topLeft() / ratio, pixels.size() / ratio).toAlignedRect());
+    }
+}
+
+void RasterTerminalSurface::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickPaintedItem::geometryChange(newGeometry, oldGeometry);
+    m_controller->geometryChange(newGeometry, oldGeometry);
+}
+
+void RasterTerminalSurface::scrollToBottom()
+{
+    m_controller->scrollToBottom();
+}
+
+void RasterTerminalSurface::wheelEvent(QWheelEvent *event)
+{
+    m_controller->wheelEvent(event);
+}
+
+void RasterTerminalSurface::keyPressEvent(QKeyEvent *event)
+{
+    m_controller->keyPressEvent(event);
+}
+
+void RasterTerminalSurface::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    m_controller->itemChange(change, value);
+    QQuickPaintedItem::itemChange(change, value);
+}
+
+QString RasterTerminalSurface::fontFamily() const
+{
+    return m_controller->fontFamily();
+}
+
+void RasterTerminalSurface::setFontFamily(const QString &family)
+{
+    if (m_controller->setFontFamily(family)) {
+        emit fontFamilyChanged();
+    }
+}
+
+qreal RasterTerminalSurface::fontPointSize() const
+{
+    return m_controller->fontPointSize();
+}
+
+void RasterTerminalSurface::setFontPointSize(qreal pointSize)
+{
+    if (m_controller->setFontPointSize(pointSize)) {
+        emit fontPointSizeChanged();
+    }
+}
+
+QString RasterTerminalSurface::fontFallback() const
+{
+    return m_controller->fontFallback();
+}
+
+void RasterTerminalSurface::setFontFallback(const QString &families)
+{
+    if (m_controller->setFontFallback(families)) {
+        emit fontFallbackChanged();
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "render/cpu_rasterizer.h"
+
+#include <QQuickPaintedItem>
+#include <QString>
+
+class SurfaceController;
+
+// CPU counterpart of PlainTextSurface for hosts without a usable GPU. Damage
+// is rasterised on the GUI thread during polish and only the changed row
+// bands are marked dirty, so the scene graph re-uploads just those texels.
+class RasterTerminalSurface : public QQuickPaintedItem
+{
+    Q_OBJECT
+    Q_PROPERTY(QObject *terminal READ terminal WRITE setTerminal NOTIFY terminalChanged)
+    Q_PROPERTY(QString fontFamily READ fontFamily WRITE setFontFamily NOTIFY fontFamilyChanged)
+    Q_PROPERTY(qreal fontPointSize READ fontPointSize WRITE setFontPointSize NOTIFY fontPointSizeChanged)
+    // Comma-separated families tried for codepoints the main font lacks;
+    // empty uses FontFallbackChain's defaults.
+    Q_PROPERTY(QString fontFallback READ fontFallback WRITE setFontFallback NOTIFY fontFallbackChanged)
+
+public:
+    explicit RasterTerminalSurface(QQuickItem *parent = nullptr);
+
+    void paint(QPainter *painter) override;
+
+    QObject *terminal() const;
+    void setTerminal(QObject *terminal);
+
+    QString fontFamily() const;
+    void setFontFamily(const QString &family);
+
+    qreal fontPointSize() const;
+    void setFontPointSize(qreal pointSize);
+
+    QString fontFallback() const;
+    void setFontFallback(const QString &families);
+
+    // Leaves scrollback and follows the live screen again.
+    Q_INVOKABLE void scrollToBottom();
+
+signals:
+    void terminalChanged();
+    void fontFamilyChanged();
+    void fontPointSizeChanged();
+    void fontFallbackChanged();
+
+protected:
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void updatePolish() override;
+    void wheelEvent(QWheelEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    SurfaceController *m_controller;
+    render::CpuRasterizer m_rasterizer;
+};
@@ -0,0 +1,74 @@
+#include "scroll_viewport.h"
+
+#include <QtMath>
+
+namespace {
+
+// Exponential ease for wheel scrolling: 1/e of the remaining distance is left
+// after 1/kScrollResponse seconds.
+constexpr qreal kScrollResponse = 18.0;
+constexpr qreal kScrollSnap = 0.01;
+
+}
+
+qreal ScrollViewport::topLine(const TerminalBridge &terminal) const
+{
+    const auto end = static_cast<qreal>(terminal.historyEnd());
+    if (m_followOutput) {
+        return end;
+    }
+    return qBound(static_cast<qreal>(terminal.historyBegin()), m_top, end);
+}
+
+void ScrollViewport::scrollBy(qreal lines, const TerminalBridge &terminal, bool animated)
+{
+    const auto begin = static_cast<qreal>(terminal.historyBegin());
+    const auto end = static_cast<qreal>(terminal.historyEnd());
+    const qreal from = m_animating ? m_target : topLine(terminal);
+    m_target = qBound(begin, from + lines, end);
+    if (!m_animating) {
+        m_top = topLine(terminal);
+    }
+    m_followOutput = false;
+    m_animating = animated;
+    if (!animated) {
+        m_top = m_target;
+        m_followOutput = m_top >= end;
+    }
+}
+
+void ScrollViewport::scrollToBottom()
+{
+    m_followOutput = true;
+    m_animating = false;
+}
+
+bool ScrollViewport::advance(qreal elapsedSeconds, const TerminalBridge &terminal)
+{
+    if (!m_animating) {
+        return false;
+    }
+    const auto end = static_cast<qreal>(terminal.historyEnd());
+    m_target = qBound(static_cast<qreal>(terminal.historyBegin()), m_target, end);
+    m_top += (m_target - m_top) * (1.0 - qExp(-elapsedSeconds * kScrollResponse));
+    if (qAbs(m_target - m_top) < kScrollSnap) {
+        m_top = m_target;
+        m_animating = false;
+    }
+    m_followOutput = !m_animating && m_top >= end;
+    return m_animating;
+}
+
+void ScrollViewport::reveal(quint64 lineNumber, const TerminalBridge &terminal)
+{
+    const qreal top = topLine(terminal);
+    const auto line = static_cast<qreal>(lineNumber);
+    if (line >= top && line < top + terminal.rows()) {
+        return;
+    }
+    const auto end = static_cast<qreal>(terminal.historyEnd());
+    m_top = qBound(static_cast<qreal>(terminal.historyBegin()), line - terminal.rows() / 3, end);
+    m_target = m_top;
+    m_animating = false;
+    m_followOutput = m_top >= end;
+}
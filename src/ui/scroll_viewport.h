@@ -0,0 +1,203 @@
+#pragma once
+
+#include "terminal/profiling.h"
+#include "terminal/screen_buffer.h"
+#include "terminal/terminal_bridge.h"
+#include "terminal/text_matcher.h"
+
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+// Which absolute lines of history plus screen a surface shows. The position is
+// a fractional line number so wheel and touchpad input scroll pixel by pixel;
+// while it sits at the live screen the view follows new output, otherwise it
+// stays on the same lines as output arrives.
+//
+// sync() brings a cell grid (CellGridNode or render::CpuRasterizer) up to
+// date. The grid has one more row than the screen for the partially visible
+// line. Moving the view shifts the grid and fetches only the newly exposed
+// lines, so the cost depends on the rows in view, never on the history size.
+class ScrollViewport
+{
+public:
+    bool followsOutput() const { return m_followOutput; }
+    bool isAnimating() const { return m_animating; }
+
+    // Absolute line at the top edge, clamped to what the terminal still has.
+    qreal topLine(const TerminalBridge &terminal) const;
+
+    // Positive lines scroll towards newer output. Animated scrolls ease towards
+    // their target over the following frames; see advance().
+    void scrollBy(qreal lines, const TerminalBridge &terminal, bool animated);
+    void scrollToBottom();
+    // Steps an animated scroll; returns whether it is still running.
+    bool advance(qreal elapsedSeconds, const TerminalBridge &terminal);
+    // Scrolls just enough history into view to show lineNumber a third of the
+    // way down, unless it is on screen already.
+    void reveal(quint64 lineNumber, const TerminalBridge &terminal);
+
+    template <typename Grid>
+    void sync(Grid &grid, TerminalBridge &terminal, bool cursorVisible);
+
+private:
+    template <typename Grid>
+    void updateLine(Grid &grid, const TerminalBridge &terminal, int row, quint64 lineNumber);
+    // cells, or a copy in m_paddedRow with the line background applied
+    // and search matches shown inverted.
+    const terminal::Cell *highlight(const TerminalBridge &terminal, quint64 lineNumber, const terminal::Cell *cells,
+                                    int length);
+
+    bool m_followOutput = true;
+    bool m_animating = false;
+    qreal m_top = 0.0;
+    qreal m_target = 0.0;
+
+    // What the grid showed after the previous sync().
+    bool m_synced = false;
+    bool m_syncedLive = true;
+    quint32 m_syncedGeneration = 0;
+    quint32 m_syncedHighlightGeneration = 0;
+    quint64 m_syncedFirstLine = 0;
+    quint64 m_syncedHistoryEnd = 0;
+    QVector<terminal::Cell> m_paddedRow;
+};
+
+template <typename Grid>
+void ScrollViewport::sync(Grid &grid, TerminalBridge &terminal, bool cursorVisible)
+{
+    PROFILE_FUNCTION();
+    const int viewRows = terminal.rows() + 1;
+    const quint32 generation = grid.atlasGeneration();
+    const bool resized = grid.rows() != viewRows || grid.columns() != terminal.columns();
+    grid.resize(viewRows, terminal.columns());
+
+    const quint64 historyEnd = terminal.historyEnd();
+    const qreal top = topLine(terminal);
+    const auto firstLine = static_cast<quint64>(std::floor(top));
+    const bool live = firstLine == historyEnd;
+    grid.setScrollFraction(top - static_cast<qreal>(firstLine));
+
+    const bool damaged = terminal.hasPendingDamage();
+    const terminal::FrameDamage damage = damaged ? terminal.takeDamage() : terminal::FrameDamage();
+    const quint32 highlightGeneration = terminal.highlightGeneration();
+    const terminal::HighlightDamage highlights = terminal.takeHighlightDamage();
+    bool rebuildAll = !m_synced || resized || generation != m_syncedGeneration
+        || highlightGeneration != m_syncedHighlightGeneration || highlights.all;
+    if (!rebuildAll && live && m_syncedLive) {
+        // Following output: the grid rows are the screen rows. Scrolls are
+        // replayed first so the spans, which are in post-scroll rows, land on
+        // the right cells.
+        for (const terminal::ScrollEvent &scroll : damage.scrolls) {
+            grid.scroll(scroll.top, scroll.bottom, scroll.lines);
+        }
+        for (const terminal::DamageSpan &span : damage.spans) {
+            const quint64 lineNumber = historyEnd + static_cast<quint64>(span.row);
+            grid.updateRow(span.row, highlight(terminal, lineNumber, terminal.rowData(span.row), terminal.columns()),
+                           span.firstColumn, span.lastColumn);
+        }
+    } else if (!rebuildAll) {
+        const qint64 delta = static_cast<qint64>(firstLine - m_syncedFirstLine);
+        if (std::abs(delta) >= viewRows) {
+            rebuildAll = true;
+        } else {
+            if (delta != 0) {
+                const int lines = static_cast<int>(delta);
+                grid.scroll(0, viewRows - 1, lines);
+                const int exposedFirst = lines > 0 ? viewRows - lines : 0;
+                const int exposedLast = lines > 0 ? viewRows - 1 : -lines - 1;
+                for (int row = exposedFirst; row <= exposedLast; ++row) {
+                    updateLine(grid, terminal, row, firstLine + row);
+                }
+            }
+            if (damaged) {
+                // Lines that were on screen last time may have changed in
+                // place or moved into history; everything older is immutable.
+                const quint64 changedFrom = std::min(m_syncedHistoryEnd, historyEnd);
+                for (int row = 0; row < viewRows; ++row) {
+                    if (firstLine + row >= changedFrom) {
+                        updateLine(grid, terminal, row, firstLine + row);
+                    }
+                }
+            }
+        }
+    }
+    if (!rebuildAll) {
+        // Lines whose highlighting changed, as far as they are in view.
+        const quint64 endLine = firstLine + static_cast<quint64>(viewRows);
+        for (const terminal::LineRange &range : highlights.lines) {
+            for (quint64 line = std::max(range.begin, firstLine); line < std::min(range.end, endLine); ++line) {
+                updateLine(grid, terminal, static_cast<int>(line - firstLine), line);
+            }
+        }
+    }
+    // A full atlas starts a new generation mid-update, leaving stale slots.
+    if (rebuildAll || generation != grid.atlasGeneration()) {
+        for (int row = 0; row < viewRows; ++row) {
+            updateLine(grid, terminal, row, firstLine + row);
+        }
+    }
+
+    const quint64 cursorLine = historyEnd + static_cast<quint64>(terminal.cursorRow());
+    if (cursorVisible && cursorLine >= firstLine && cursorLine < firstLine + viewRows) {
+        grid.setCursor(static_cast<int>(cursorLine - firstLine), terminal.cursorColumn());
+    } else {
+        grid.setCursor(-1, -1);
+    }
+
+    m_synced = true;
+    m_syncedGeneration = grid.atlasGeneration();
+    m_syncedHighlightGeneration = highlightGeneration;
+    m_syncedLive = live;
+    m_syncedFirstLine = firstLine;
+    m_syncedHistoryEnd = historyEnd;
+}
+
+template <typename Grid>
+void ScrollViewport::updateLine(Grid &grid, const TerminalBridge &terminal, int row, quint64 lineNumber)
+{
+    // History lines are stored without trailing blanks and keep the width they
+    // were written at; pad them out to the grid.
+    int length = 0;
+    const terminal::Cell *cells = terminal.lineData(lineNumber, &length);
+    if (length < grid.columns()) {
+        m_paddedRow.fill(terminal::Cell{}, grid.columns());
+        if (cells) {
+            std::copy(cells, cells + length, m_paddedRow.begin());
+        }
+        cells = m_paddedRow.constData();
+    }
+    grid.updateRow(row, highlight(terminal, lineNumber, cells, std::max(length, grid.columns())));
+}
+
+inline const terminal::Cell *ScrollViewport::highlight(const TerminalBridge &terminal, quint64 lineNumber,
+                                                       const terminal::Cell *cells, int length)
+{
+    const QVector<terminal::ColumnSpan> *matches = terminal.searchMatches(lineNumber);
+    quint32 background = 0;
+    const bool tinted = terminal.lineBackground(lineNumber, &background);
+    if ((!matches && !tinted) || !cells) {
+        return cells;
+    }
+    if (cells != m_paddedRow.constData()) {
+        m_paddedRow.resize(length);
+        std::copy(cells, cells + length, m_paddedRow.begin());
+    }
+    if (tinted) {
+        for (terminal::Cell &cell : m_paddedRow) {
+            cell.attributes.background = background;
+        }
+    }
+    if (!matches) {
+        return m_paddedRow.constData();
+    }
+    for (const terminal::ColumnSpan &match : *matches) {
+        const int last = std::min(match.column + match.length, static_cast<int>(m_paddedRow.size()));
+        for (int column = match.column; column < last; ++column) {
+            terminal::CellAttributes &attributes = m_paddedRow[column].attributes;
+            attributes.inverse = !attributes.inverse;
+        }
+    }
+    return m_paddedRow.constData();
+}
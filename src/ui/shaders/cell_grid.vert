@@ -0,0 +1,28 @@
+#version 440
+
+layout(location = 0) in vec2 corner;
+layout(location = 1) in uvec2 cell;
+layout(location = 2) in uvec2 glyph;
+layout(location = 3) in vec4 foreground;
+layout(location = 4) in vec4 background;
+
+layout(location = 0) out vec2 v_uv;
+layout(location = 1) out vec4 v_foreground;
+layout(location = 2) out vec4 v_background;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 matrix;
+    vec2 glyphSize;
+    vec2 atlasSize;
+    int columns;
+    int cursorCell;
+};
+
+void main()
+{
+    v_uv = (vec2(glyph) + corner * glyphSize) / atlasSize;
+    bool cursor = int(cell.y) * columns + int(cell.x) == cursorCell;
+    v_foreground = cursor ? background : foreground;
+    v_background = cursor ? foreground : background;
+    gl_Position = matrix * vec4((vec2(cell) + corner) * glyphSize, 0.0, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 440
+
+layout(location = 0) in vec2 v_uv;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 matrix;
+    vec2 origin;
+    vec2 size;
+    float opacity;
+    float flipY;
+};
+
+layout(binding = 1) uniform sampler2D grid;
+
+void main()
+{
+    fragColor = texture(grid, v_uv) * opacity;
+}
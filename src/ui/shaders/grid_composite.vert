@@ -0,0 +1,19 @@
+#version 440
+
+layout(location = 0) in vec2 corner;
+
+layout(location = 0) out vec2 v_uv;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 matrix;
+    vec2 origin;
+    vec2 size;
+    float opacity;
+    float flipY;
+};
+
+void main()
+{
+    v_uv = vec2(corner.x, flipY > 0.5 ? 1.0 - corner.y : corner.y);
+    gl_Position = matrix * vec4(origin + corner * size, 0.0, 1.0);
+}
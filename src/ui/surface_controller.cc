@@ -0,0 +1,203 @@
+#include "surface_controller.h"
+
+#include "render/glyph_atlas.h"
+#include "terminal/terminal_bridge.h"
+
+#include <QKeyEvent>
+#include <QQuickWindow>
+#include <QWheelEvent>
+#include <QtMath>
+
+namespace {
+constexpr qreal kWheelStepLines = 3.0;
+}
+
+SurfaceController::SurfaceController(QQuickItem *item)
+    : QObject(item)
+    , m_item(item)
+    , m_scheduler(new FrameScheduler(item))
+{
+    connect(m_scheduler, &FrameScheduler::exposedChanged, this, [this](bool exposed) {
+        if (m_terminal) {
+            m_terminal->setInBackground(!exposed);
+        }
+    });
+    updateFont();
+}
+
+bool SurfaceController::setTerminal(QObject *terminal)
+{
+    if (m_terminal == terminal) {
+        return false;
+    }
+
+    if (m_terminal) {
+        QObject::disconnect(m_bufferConnection);
+        QObject::disconnect(m_revealConnection);
+    }
+
+    m_terminal = qobject_cast<TerminalBridge *>(terminal);
+    if (m_terminal) {
+        m_bufferConnection = connect(m_terminal, &TerminalBridge::damageAvailable, this,
+                                     &SurfaceController::handleDamage);
+        m_revealConnection = connect(m_terminal, &TerminalBridge::revealLine, this, [this](quint64 lineNumber) {
+            m_viewport.reveal(lineNumber, *m_terminal);
+            m_scheduler->requestFrame(FrameScheduler::Scroll);
+        });
+        m_terminal->setInBackground(!m_scheduler->exposed());
+    }
+    updateGridSize();
+    m_scheduler->requestFrame(FrameScheduler::Damage);
+    return true;
+}
+
+bool SurfaceController::setFontFamily(const QString &family)
+{
+    if (m_fontFamily == family) {
+        return false;
+    }
+    m_fontFamily = family;
+    updateFont();
+    updateGridSize();
+    m_scheduler->requestFrame(FrameScheduler::Appearance);
+    return true;
+}
+
+bool SurfaceController::setFontPointSize(qreal pointSize)
+{
+    if (qFuzzyCompare(m_fontPointSize, pointSize)) {
+        return false;
+    }
+    m_fontPointSize = pointSize;
+    updateFont();
+    updateGridSize();
+    m_scheduler->requestFrame(FrameScheduler::Appearance);
+    return true;
+}
+
+bool SurfaceController::setFontFallback(const QString &families)
+{
+    if (m_fontFallback == families) {
+        return false;
+    }
+    m_fontFallback = families;
+    m_fallbackFamilies = families.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (QString &family : m_fallbackFamilies) {
+        family = family.trimmed();
+    }
+    m_scheduler->requestFrame(FrameScheduler::Appearance);
+    return true;
+}
+
+void SurfaceController::updateFont()
+{
+    m_font = QFont(m_fontFamily);
+    m_font.setStyleHint(QFont::TypeWriter);
+    m_font.setPointSizeF(m_fontPointSize);
+}
+
+qreal SurfaceController::devicePixelRatio() const
+{
+    return m_item->window() ? m_item->window()->effectiveDevicePixelRatio() : 1.0;
+}
+
+bool SurfaceController::cursorVisible() const
+{
+    return m_scheduler->cursorBlinkVisible() && (!m_terminal || m_terminal->cursorVisible());
+}
+
+void SurfaceController::updateGridSize()
+{
+    if (!m_terminal) {
+        return;
+    }
+    // Same device-pixel cell metrics the renderers' glyph atlases use.
+    const qreal ratio = devicePixelRatio();
+    const QSize cellSize = render::GlyphAtlas::cellSizeFor(font(), ratio);
+    if (cellSize.isEmpty()) {
+        return;
+    }
+    m_cellHeight = cellSize.height() / ratio;
+    const qreal padding = qRound(kPadding * ratio);
+    const int columns = qFloor(((m_item->width() * ratio) - (2 * padding)) / cellSize.width());
+    const int rows = qFloor(((m_item->height() * ratio) - (2 * padding)) / cellSize.height());
+    m_terminal->resize(columns, rows);
+}
+
+void SurfaceController::scrollToBottom()
+{
+    if (m_viewport.followsOutput()) {
+        return;
+    }
+    m_viewport.scrollToBottom();
+    m_scheduler->setAnimating(false);
+    m_scheduler->requestFrame(FrameScheduler::Scroll);
+}
+
+void SurfaceController::advanceScroll()
+{
+    if (m_terminal && m_viewport.isAnimating()) {
+        m_viewport.advance(m_scrollClock.restart() / 1000.0, *m_terminal);
+        m_scheduler->setAnimating(m_viewport.isAnimating());
+    }
+}
+
+void SurfaceController::itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value)
+{
+    if (change == QQuickItem::ItemSceneChange) {
+        m_scheduler->setWindow(value.window);
+        // Cell metrics are in device pixels, and the ratio was a guess of 1
+        // until the item had a window.
+        if (value.window) {
+            updateGridSize();
+        }
+    } else if (change == QQuickItem::ItemDevicePixelRatioHasChanged) {
+        updateGridSize();
+        m_scheduler->requestFrame(FrameScheduler::Appearance);
+    } else if (change == QQuickItem::ItemActiveFocusHasChanged) {
+        m_scheduler->setCursorBlinking(value.boolValue);
+    }
+}
+
+void SurfaceController::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    if (newGeometry.size() != oldGeometry.size()) {
+        updateGridSize();
+    }
+}
+
+void SurfaceController::wheelEvent(QWheelEvent *event)
+{
+    if (!m_terminal || m_cellHeight <= 0) {
+        event->ignore();
+        return;
+    }
+    // Touchpads report pixels and already move smoothly; wheel notches are
+    // eased over the next frames instead of jumping whole lines.
+    if (!event->pixelDelta().isNull()) {
+        m_viewport.scrollBy(-event->pixelDelta().y() / m_cellHeight, *m_terminal, false);
+    } else {
+        m_viewport.scrollBy(-(event->angleDelta().y() / 120.0) * kWheelStepLines, *m_terminal, true);
+        m_scrollClock.restart();
+    }
+    m_scheduler->setAnimating(m_viewport.isAnimating());
+    m_scheduler->requestFrame(FrameScheduler::Scroll);
+    event->accept();
+}
+
+void SurfaceController::keyPressEvent(QKeyEvent *event)
+{
+    if (!m_terminal || !m_terminal->sendKey(event->key(), event->modifiers(), event->text())) {
+        event->ignore();
+        return;
+    }
+    // Typing jumps back from scrollback to the live screen.
+    scrollToBottom();
+    event->accept();
+}
+
+void SurfaceController::handleDamage()
+{
+    m_scheduler->restartCursorBlink();
+    m_scheduler->requestFrame(FrameScheduler::Damage);
+}
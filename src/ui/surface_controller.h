@@ -0,0 +1,84 @@
+#pragma once
+
+#include "frame_scheduler.h"
+#include "scroll_viewport.h"
+
+#include <QElapsedTimer>
+#include <QFont>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QQuickItem>
+#include <QString>
+#include <QStringList>
+
+class QKeyEvent;
+class QWheelEvent;
+class TerminalBridge;
+
+// Everything PlainTextSurface and RasterTerminalSurface share apart from
+// drawing: the terminal connection, font settings, grid sizing, frame
+// scheduling, scrolling and keyboard input. The two surfaces derive from
+// different Qt item classes, so each owns one of these and forwards its
+// properties and events to it.
+class SurfaceController : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Gap between the item's edges and the cell grid, in logical pixels.
+    static constexpr qreal kPadding = 6.0;
+
+    explicit SurfaceController(QQuickItem *item);
+
+    TerminalBridge *terminal() const { return m_terminal; }
+    // The setters return whether anything changed, for the item to notify.
+    bool setTerminal(QObject *terminal);
+
+    QString fontFamily() const { return m_fontFamily; }
+    bool setFontFamily(const QString &family);
+    qreal fontPointSize() const { return m_fontPointSize; }
+    bool setFontPointSize(qreal pointSize);
+    // Comma-separated families tried for codepoints the main font lacks;
+    // empty uses FontFallbackChain's defaults.
+    QString fontFallback() const { return m_fontFallback; }
+    bool setFontFallback(const QString &families);
+
+    // Built when the settings change, not per frame.
+    const QFont &font() const { return m_font; }
+    const QStringList &fallbackFamilies() const { return m_fallbackFamilies; }
+    qreal devicePixelRatio() const;
+    bool cursorVisible() const;
+
+    FrameScheduler &scheduler() { return *m_scheduler; }
+    ScrollViewport &viewport() { return m_viewport; }
+
+    // Leaves scrollback and follows the live screen again.
+    void scrollToBottom();
+    // Steps an animated scroll; called from the item's updatePolish().
+    void advanceScroll();
+
+    void itemChange(QQuickItem::ItemChange change, const QQuickItem::ItemChangeData &value);
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry);
+    void wheelEvent(QWheelEvent *event);
+    void keyPressEvent(QKeyEvent *event);
+
+private:
+    void updateFont();
+    void updateGridSize();
+    void handleDamage();
+
+    QQuickItem *m_item;
+    QPointer<TerminalBridge> m_terminal;
+    QMetaObject::Connection m_bufferConnection;
+    QMetaObject::Connection m_revealConnection;
+    FrameScheduler *m_scheduler;
+    ScrollViewport m_viewport;
+    QElapsedTimer m_scrollClock;
+    qreal m_cellHeight = 0.0;
+    QString m_fontFamily = QStringLiteral("monospace");
+    qreal m_fontPointSize = 13.0;
+    QString m_fontFallback;
+    QFont m_font;
+    QStringList m_fallbackFamilies;
+};
@@ -0,0 +1,124 @@
+#include "key_encoder.h"
+
+#include <QTest>
+
+class KeyEncoderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void encodesKey_data();
+    void encodesKey();
+    void appendsToOutput();
+    void rejectsKeysWithoutOutput();
+};
+
+void KeyEncoderTest::encodesKey_data()
+{
+    // Modifiers as int: QFETCH needs a registered type and the flags are not.
+    QTest::addColumn<int>("key");
+    QTest::addColumn<int>("modifiers");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("applicationCursorKeys");
+    QTest::addColumn<QByteArray>("expected");
+
+    const int none = Qt::NoModifier;
+    const int shift = Qt::ShiftModifier;
+    const int control = Qt::ControlModifier;
+    const int alt = Qt::AltModifier;
+
+    QTest::newRow("up") << int(Qt::Key_Up) << none << QString() << false << QByteArray("\x1b[A");
+    QTest::newRow("up, application") << int(Qt::Key_Up) << none << QString() << true << QByteArray("\x1bOA");
+    QTest::newRow("shift+up") << int(Qt::Key_Up) << shift << QString() << false << QByteArray("\x1b[1;2A");
+    // A modifier overrides application mode, as in xterm.
+    QTest::newRow("shift+up, application") << int(Qt::Key_Up) << shift << QString() << true
+                                           << QByteArray("\x1b[1;2A");
+    QTest::newRow("alt+up") << int(Qt::Key_Up) << alt << QString() << false << QByteArray("\x1b[1;3A");
+    QTest::newRow("ctrl+right") << int(Qt::Key_Right) << control << QString() << false << QByteArray("\x1b[1;5C");
+    QTest::newRow("ctrl+shift+left") << int(Qt::Key_Left) << (control | shift) << QString() << false
+                                     << QByteArray("\x1b[1;6D");
+    QTest::newRow("home") << int(Qt::Key_Home) << none << QString() << false << QByteArray("\x1b[H");
+    QTest::newRow("end, application") << int(Qt::Key_End) << none << QString() << true << QByteArray("\x1bOF");
+
+    QTest::newRow("f1") << int(Qt::Key_F1) << none << QString() << false << QByteArray("\x1bOP");
+    QTest::newRow("shift+f1") << int(Qt::Key_F1) << shift << QString() << false << QByteArray("\x1b[1;2P");
+    QTest::newRow("f5") << int(Qt::Key_F5) << none << QString() << false << QByteArray("\x1b[15~");
+    QTest::newRow("f12") << int(Qt::Key_F12) << none << QString() << false << QByteArray("\x1b[24~");
+    QTest::newRow("insert") << int(Qt::Key_Insert) << none << QString() << false << QByteArray("\x1b[2~");
+    QTest::newRow("delete") << int(Qt::Key_Delete) << none << QString() << false << QByteArray("\x1b[3~");
+    QTest::newRow("ctrl+pageup") << int(Qt::Key_PageUp) << control << QString() << false
+                                 << QByteArray("\x1b[5;5~");
+
+    QTest::newRow("return") << int(Qt::Key_Return) << none << QStringLiteral("\r") << false << QByteArray("\r");
+    QTest::newRow("enter") << int(Qt::Key_Enter) << none << QStringLiteral("\r") << false << QByteArray("\r");
+    QTest::newRow("alt+return") << int(Qt::Key_Return) << alt << QStringLiteral("\r") << false
+                                << QByteArray("\x1b\r");
+    QTest::newRow("backspace") << int(Qt::Key_Backspace) << none << QStringLiteral("\b") << false
+                               << QByteArray("\x7f");
+    QTest::newRow("ctrl+backspace") << int(Qt::Key_Backspace) << control << QString() << false
+                                    << QByteArray("\x08");
+    QTest::newRow("tab") << int(Qt::Key_Tab) << none << QStringLiteral("\t") << false << QByteArray("\t");
+    QTest::newRow("backtab") << int(Qt::Key_Backtab) << shift << QString() << false << QByteArray("\x1b[Z");
+    QTest::newRow("escape") << int(Qt::Key_Escape) << none << QStringLiteral("\x1b") << false << QByteArray("\x1b");
+
+    QTest::newRow("ctrl+a") << int(Qt::Key_A) << control << QStringLiteral("\x01") << false << QByteArray("\x01");
+    QTest::newRow("ctrl+z") << int(Qt::Key_Z) << control << QString() << false << QByteArray("\x1a");
+    QTest::newRow("ctrl+space") << int(Qt::Key_Space) << control << QStringLiteral(" ") << false
+                                << QByteArray("\0", 1);
+    QTest::newRow("ctrl+@") << int(Qt::Key_At) << (control | shift) << QString() << false << QByteArray("\0", 1);
+    QTest::newRow("ctrl+[") << int(Qt::Key_BracketLeft) << control << QString() << false << QByteArray("\x1b");
+    QTest::newRow("ctrl+/") << int(Qt::Key_Slash) << control << QString() << false << QByteArray("\x1f");
+    QTest::newRow("ctrl+?") << int(Qt::Key_Question) << (control | shift) << QString() << false
+                            << QByteArray("\x7f");
+    QTest::newRow("ctrl+alt+c") << int(Qt::Key_C) << (control | alt) << QString() << false
+                                << QByteArray("\x1b\x03");
+
+    QTest::newRow("text") << int(Qt::Key_X) << none << QStringLiteral("x") << false << QByteArray("x");
+    QTest::newRow("shifted text") << int(Qt::Key_X) << shift << QStringLiteral("X") << false << QByteArray("X");
+    QTest::newRow("alt+x") << int(Qt::Key_X) << alt << QStringLiteral("x") << false << QByteArray("\x1bx");
+    QTest::newRow("non-ascii text") << int(Qt::Key_Eacute) << none << QStringLiteral("é") << false
+                                    << QByteArray("\xc3\xa9");
+    QTest::newRow("composed text") << 0 << none << QStringLiteral("漢字") << false
+                                   << QByteArray("\xe6\xbc\xa2\xe5\xad\x97");
+}
+
+void KeyEncoderTest::encodesKey()
+{
+    QFETCH(int, key);
+    QFETCH(int, modifiers);
+    QFETCH(QString, text);
+    QFETCH(bool, applicationCursorKeys);
+    QFETCH(QByteArray, expected);
+
+    terminal::KeyboardModes modes;
+    modes.applicationCursorKeys = applicationCursorKeys;
+    QByteArray output;
+    QVERIFY(terminal::encodeKey(key, Qt::KeyboardModifiers(modifiers), text, modes, output));
+    QCOMPARE(output, expected);
+}
+
+void KeyEncoderTest::appendsToOutput()
+{
+    QByteArray output("ls");
+    QVERIFY(terminal::encodeKey(Qt::Key_Return, Qt::NoModifier, QStringLiteral("\r"), {}, output));
+    QVERIFY(terminal::encodeKey(Qt::Key_Up, Qt::NoModifier, QString(), {}, output));
+    QCOMPARE(output, QByteArray("ls\r\x1b[A"));
+}
+
+void KeyEncoderTest::rejectsKeysWithoutOutput()
+{
+    QByteArray output("pending");
+    QVERIFY(!terminal::encodeKey(Qt::Key_Shift, Qt::ShiftModifier, QString(), {}, output));
+    QCOMPARE(output, QByteArray("pending"));
+
+    // The ESC that Alt would have prefixed is taken back as well.
+    QVERIFY(!terminal::encodeKey(Qt::Key_Control, Qt::AltModifier | Qt::ControlModifier, QString(), {}, output));
+    QCOMPARE(output, QByteArray("pending"));
+
+    // Ctrl on a key with no C0 equivalent and no text sends nothing.
+    QVERIFY(!terminal::encodeKey(Qt::Key_Comma, Qt::ControlModifier, QString(), {}, output));
+    QCOMPARE(output, QByteArray("pending"));
+}
+
+QTEST_GUILESS_MAIN(KeyEncoderTest)
+#include "key_encoder_test.moc"
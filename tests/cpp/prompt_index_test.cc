@@ -0,0 +1,189 @@
+#include "prompt_index.h"
+
+#include <QTest>
+
+namespace {
+
+// A prompt at line, a command typed on it and output from the next line on;
+// finishedLine is where the shell reported the exit code.
+void runCommand(terminal::PromptIndex &index, quint64 line, quint64 finishedLine, int exitCode)
+{
+    index.mark(terminal::ShellMark::PromptStart, line);
+    index.mark(terminal::ShellMark::CommandStart, line);
+    index.mark(terminal::ShellMark::OutputStart, line + 1);
+    index.mark(terminal::ShellMark::CommandFinished, finishedLine, exitCode);
+}
+
+}
+
+class PromptIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void recordsMarks();
+    void parsesShellMarkPayloads();
+    void ignoresFinishWithoutOutput();
+    void createsRecordWithoutPromptMark();
+    void promptAboveNewestReplacesRecords();
+    void findsCommandAtLine();
+    void findsAdjacentCommands();
+    void reportsOutputRanges();
+    void evictsOldPrompts();
+};
+
+void PromptIndexTest::recordsMarks()
+{
+    terminal::PromptIndex index;
+    runCommand(index, 10, 15, 2);
+
+    QCOMPARE(index.size(), 1);
+    const terminal::CommandRecord &record = index.at(0);
+    QCOMPARE(record.promptLine, quint64(10));
+    QCOMPARE(record.commandLine, quint64(10));
+    QCOMPARE(record.outputLine, quint64(11));
+    QCOMPARE(record.finishedLine, quint64(15));
+    QCOMPARE(record.exitCode, 2);
+    QVERIFY(record.finished());
+    QVERIFY(record.finishedAt >= record.startedAt);
+}
+
+void PromptIndexTest::parsesShellMarkPayloads()
+{
+    terminal::PromptIndex index;
+    index.handleShellMark("A", 10);
+    index.handleShellMark("B", 10);
+    index.handleShellMark("C", 11);
+    index.handleShellMark("D;2", 15);
+    runCommand(index, 20, 21, 0);
+    index.handleShellMark("C", 21);
+    index.handleShellMark("D", 24);
+    index.handleShellMark("", 30);
+    index.handleShellMark("Z", 30);
+
+    QCOMPARE(index.size(), 2);
+    QCOMPARE(index.at(0).promptLine, quint64(10));
+    QCOMPARE(index.at(0).commandLine, quint64(10));
+    QCOMPARE(index.at(0).outputLine, quint64(11));
+    QCOMPARE(index.at(0).finishedLine, quint64(15));
+    QCOMPARE(index.at(0).exitCode, 2);
+    // A restarted command finishes without a code.
+    QCOMPARE(index.at(1).finishedLine, quint64(24));
+    QCOMPARE(index.at(1).exitCode, -1);
+}
+
+void PromptIndexTest::ignoresFinishWithoutOutput()
+{
+    // Shells send D after an empty command line too.
+    terminal::PromptIndex index;
+    index.mark(terminal::ShellMark::PromptStart, 3);
+    index.mark(terminal::ShellMark::CommandStart, 3);
+    index.mark(terminal::ShellMark::CommandFinished, 4, 0);
+
+    QCOMPARE(index.size(), 1);
+    QVERIFY(!index.at(0).finished());
+    QCOMPARE(index.at(0).exitCode, -1);
+}
+
+void PromptIndexTest::createsRecordWithoutPromptMark()
+{
+    terminal::PromptIndex index;
+    index.mark(terminal::ShellMark::OutputStart, 7);
+    index.mark(terminal::ShellMark::CommandFinished, 9, 1);
+
+    QCOMPARE(index.size(), 1);
+    QCOMPARE(index.at(0).promptLine, quint64(7));
+    QCOMPARE(index.at(0).outputLine, quint64(7));
+    QCOMPARE(index.at(0).exitCode, 1);
+}
+
+void PromptIndexTest::promptAboveNewestReplacesRecords()
+{
+    // The screen was cleared and the shell drew its prompt again higher up.
+    terminal::PromptIndex index;
+    runCommand(index, 100, 104, 0);
+    runCommand(index, 105, 110, 0);
+    index.mark(terminal::ShellMark::PromptStart, 103);
+
+    QCOMPARE(index.size(), 2);
+    QCOMPARE(index.at(0).promptLine, quint64(100));
+    QCOMPARE(index.at(1).promptLine, quint64(103));
+    QVERIFY(!index.at(1).finished());
+}
+
+void PromptIndexTest::findsCommandAtLine()
+{
+    terminal::PromptIndex index;
+    runCommand(index, 10, 15, 0);
+    runCommand(index, 20, 25, 0);
+
+    QCOMPARE(index.commandAt(5), -1);
+    QCOMPARE(index.commandAt(10), 0);
+    QCOMPARE(index.commandAt(19), 0);
+    QCOMPARE(index.commandAt(20), 1);
+    QCOMPARE(index.commandAt(1000), 1);
+}
+
+void PromptIndexTest::findsAdjacentCommands()
+{
+    terminal::PromptIndex index;
+    runCommand(index, 10, 15, 0);
+    runCommand(index, 20, 25, 0);
+    runCommand(index, 30, 35, 0);
+
+    QCOMPARE(index.adjacentCommand(20, true), 0);
+    QCOMPARE(index.adjacentCommand(21, true), 1);
+    QCOMPARE(index.adjacentCommand(10, true), -1);
+    QCOMPARE(index.adjacentCommand(20, false), 2);
+    QCOMPARE(index.adjacentCommand(5, false), 0);
+    QCOMPARE(index.adjacentCommand(30, false), -1);
+}
+
+void PromptIndexTest::reportsOutputRanges()
+{
+    terminal::PromptIndex index;
+    runCommand(index, 10, 15, 0);
+    // Output that never finished ends at the next prompt.
+    index.mark(terminal::ShellMark::PromptStart, 20);
+    index.mark(terminal::ShellMark::OutputStart, 21);
+    // The running command's output ends at the limit.
+    index.mark(terminal::ShellMark::PromptStart, 30);
+    index.mark(terminal::ShellMark::OutputStart, 31);
+    index.mark(terminal::ShellMark::PromptStart, 40);
+
+    quint64 first = 0;
+    quint64 end = 0;
+    QVERIFY(index.outputRange(0, 50, &first, &end));
+    QCOMPARE(first, quint64(11));
+    QCOMPARE(end, quint64(15));
+    QVERIFY(index.outputRange(1, 50, &first, &end));
+    QCOMPARE(first, quint64(21));
+    QCOMPARE(end, quint64(30));
+    QVERIFY(!index.outputRange(3, 50, &first, &end));
+    QVERIFY(!index.outputRange(-1, 50, &first, &end));
+
+    terminal::PromptIndex running;
+    running.mark(terminal::ShellMark::PromptStart, 0);
+    running.mark(terminal::ShellMark::OutputStart, 1);
+    QVERIFY(running.outputRange(0, 8, &first, &end));
+    QCOMPARE(first, quint64(1));
+    QCOMPARE(end, quint64(8));
+}
+
+void PromptIndexTest::evictsOldPrompts()
+{
+    terminal::PromptIndex index;
+    runCommand(index, 10, 15, 0);
+    runCommand(index, 20, 25, 0);
+    runCommand(index, 30, 35, 0);
+
+    const quint32 revision = index.revision();
+    index.evictBefore(20);
+    QCOMPARE(index.size(), 2);
+    QVERIFY(index.revision() != revision);
+    QCOMPARE(index.at(0).promptLine, quint64(20));
+    QCOMPARE(index.commandAt(12), -1);
+}
+
+QTEST_GUILESS_MAIN(PromptIndexTest)
+#include "prompt_index_test.moc"
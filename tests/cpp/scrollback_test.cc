@@ -0,0 +1,171 @@
+#include "scrollback.h"
+
+#include <QTest>
+
+namespace {
+
+// A row of columns blanks with text written from the first column.
+QVector<terminal::Cell> makeRow(const QString &text, int columns)
+{
+    QVector<terminal::Cell> cells(columns);
+    for (qsizetype index = 0; index < text.size() && index < columns; ++index) {
+        cells[index].codepoint = text.at(index).unicode();
+    }
+    return cells;
+}
+
+QString lineText(const terminal::Scrollback &scrollback, quint64 lineNumber)
+{
+    int length = 0;
+    const terminal::Cell *cells = scrollback.line(lineNumber, &length);
+    QString text;
+    for (int column = 0; cells && column < length; ++column) {
+        text.append(QChar(static_cast<char16_t>(cells[column].codepoint)));
+    }
+    return text;
+}
+
+void pushLines(terminal::Scrollback &scrollback, int count)
+{
+    for (int index = 0; index < count; ++index) {
+        const QVector<terminal::Cell> row = makeRow(QString::number(index), 8);
+        scrollback.push(row.constData(), static_cast<int>(row.size()));
+    }
+}
+
+}
+
+class ScrollbackTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void storesLinesWithoutTrailingBlanks();
+    void keepsWrappedFlag();
+    void numbersLinesAbsolutely();
+    void evictsWholePagesPastTheLimit();
+    void loweringTheLimitFreesPages();
+    void zeroLimitKeepsNothing();
+    void raisingZeroLimitStartsFresh();
+    void clearKeepsLineNumbers();
+};
+
+void ScrollbackTest::storesLinesWithoutTrailingBlanks()
+{
+    terminal::Scrollback scrollback(100);
+    const QVector<terminal::Cell> row = makeRow(QStringLiteral("ab c"), 80);
+    scrollback.push(row.constData(), static_cast<int>(row.size()));
+
+    int length = 0;
+    QVERIFY(scrollback.line(0, &length));
+    QCOMPARE(length, 4);
+    QCOMPARE(lineText(scrollback, 0), QStringLiteral("ab c"));
+}
+
+void ScrollbackTest::keepsWrappedFlag()
+{
+    terminal::Scrollback scrollback(100);
+    const QVector<terminal::Cell> row = makeRow(QStringLiteral("x"), 4);
+    scrollback.push(row.constData(), 4, true);
+    scrollback.push(row.constData(), 4, false);
+
+    int length = 0;
+    bool wrapped = false;
+    scrollback.line(0, &length, &wrapped);
+    QVERIFY(wrapped);
+    scrollback.line(1, &length, &wrapped);
+    QVERIFY(!wrapped);
+}
+
+void ScrollbackTest::numbersLinesAbsolutely()
+{
+    terminal::Scrollback scrollback(10);
+    pushLines(scrollback, 25);
+
+    QCOMPARE(scrollback.begin(), quint64(15));
+    QCOMPARE(scrollback.end(), quint64(25));
+    QCOMPARE(scrollback.size(), 10);
+    QCOMPARE(lineText(scrollback, 15), QStringLiteral("15"));
+    QCOMPARE(lineText(scrollback, 24), QStringLiteral("24"));
+
+    int length = -1;
+    QVERIFY(!scrollback.line(14, &length));
+    QCOMPARE(length, 0);
+    QVERIFY(!scrollback.line(25, &length));
+}
+
+void ScrollbackTest::evictsWholePagesPastTheLimit()
+{
+    // Pages hold 1024 lines; the first one goes once all of it is past the
+    // limit, and lines across the page boundary stay readable.
+    terminal::Scrollback scrollback(3000);
+    pushLines(scrollback, 4000);
+    QCOMPARE(scrollback.begin(), quint64(1000));
+    const qsizetype beforeEviction = scrollback.memoryBytes();
+
+    pushLines(scrollback, 100);
+    QCOMPARE(scrollback.begin(), quint64(1100));
+    QVERIFY(scrollback.memoryBytes() < beforeEviction);
+    QCOMPARE(lineText(scrollback, 1100), QStringLiteral("1100"));
+    QCOMPARE(lineText(scrollback, 2047), QStringLiteral("2047"));
+    QCOMPARE(lineText(scrollback, 2048), QStringLiteral("2048"));
+    QCOMPARE(lineText(scrollback, 4099), QStringLiteral("99"));
+}
+
+void ScrollbackTest::loweringTheLimitFreesPages()
+{
+    terminal::Scrollback scrollback(5000);
+    pushLines(scrollback, 5000);
+    const qsizetype full = scrollback.memoryBytes();
+    QVERIFY(full > 0);
+
+    scrollback.setMaxLines(100);
+    QCOMPARE(scrollback.begin(), quint64(4900));
+    QCOMPARE(scrollback.size(), 100);
+    QVERIFY(scrollback.memoryBytes() < full / 2);
+    QCOMPARE(lineText(scrollback, 4900), QStringLiteral("4900"));
+}
+
+void ScrollbackTest::zeroLimitKeepsNothing()
+{
+    terminal::Scrollback scrollback(0);
+    pushLines(scrollback, 5);
+
+    QCOMPARE(scrollback.size(), 0);
+    QCOMPARE(scrollback.begin(), quint64(5));
+    QCOMPARE(scrollback.end(), quint64(5));
+    QCOMPARE(scrollback.memoryBytes(), qsizetype(0));
+}
+
+void ScrollbackTest::raisingZeroLimitStartsFresh()
+{
+    terminal::Scrollback scrollback(100);
+    pushLines(scrollback, 10);
+    scrollback.setMaxLines(0);
+    QCOMPARE(scrollback.size(), 0);
+    QCOMPARE(scrollback.memoryBytes(), qsizetype(0));
+
+    // No page from before may be reused for the lines that follow.
+    scrollback.setMaxLines(100);
+    pushLines(scrollback, 3);
+    QCOMPARE(scrollback.begin(), quint64(10));
+    QCOMPARE(scrollback.end(), quint64(13));
+    QCOMPARE(lineText(scrollback, 10), QStringLiteral("0"));
+    QCOMPARE(lineText(scrollback, 12), QStringLiteral("2"));
+}
+
+void ScrollbackTest::clearKeepsLineNumbers()
+{
+    terminal::Scrollback scrollback(100);
+    pushLines(scrollback, 7);
+    scrollback.clear();
+
+    QCOMPARE(scrollback.begin(), quint64(7));
+    QCOMPARE(scrollback.end(), quint64(7));
+    QCOMPARE(scrollback.memoryBytes(), qsizetype(0));
+    pushLines(scrollback, 1);
+    QCOMPARE(lineText(scrollback, 7), QStringLiteral("0"));
+}
+
+QTEST_GUILESS_MAIN(ScrollbackTest)
+#include "scrollback_test.moc"
@@ -0,0 +1,26 @@
+#ifndef TEST_CELLS_H
+#define TEST_CELLS_H
+
+#include "screen_buffer.h"
+
+#include <QString>
+#include <QVector>
+
+// One cell per character of text; characters listed in wide also take a
+// continuation cell, as ScreenBuffer stores double-width characters.
+inline QVector<terminal::Cell> makeCells(const QString &text, const QString &wide = {})
+{
+    QVector<terminal::Cell> cells;
+    for (const char32_t codepoint : text.toUcs4()) {
+        terminal::Cell cell;
+        cell.codepoint = codepoint;
+        cells.append(cell);
+        if (wide.toUcs4().contains(codepoint)) {
+            cell.codepoint = terminal::kWideCharContinuation;
+            cells.append(cell);
+        }
+    }
+    return cells;
+}
+
+#endif
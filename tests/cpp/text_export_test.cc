@@ -0,0 +1,174 @@
+#include "text_export.h"
+
+#include "test_cells.h"
+
+#include <QBuffer>
+#include <QTest>
+
+namespace {
+
+// Stands in for TerminalBridge::lineData(): rows numbered from kFirstLine,
+// characters listed in wide taking a continuation cell as on screen. A row
+// added with addMissingLine() reads back as null, like an evicted page.
+class FakeLines
+{
+public:
+    static constexpr quint64 kFirstLine = 1000;
+
+    FakeLines &addLine(const QString &text, bool wrapped = false, const QString &wide = {})
+    {
+        m_rows.append(makeCells(text, wide));
+        m_wrapped.append(wrapped);
+        m_missing.append(false);
+        return *this;
+    }
+
+    FakeLines &addMissingLine()
+    {
+        addLine(QString());
+        m_missing.last() = true;
+        return *this;
+    }
+
+    terminal::LineReader reader() const
+    {
+        return [this](quint64 lineNumber, int *length, bool *wrapped) -> const terminal::Cell * {
+            const qsizetype index = static_cast<qsizetype>(lineNumber - kFirstLine);
+            if (lineNumber < kFirstLine || index >= m_rows.size() || m_missing[index]) {
+                *length = 0;
+                *wrapped = false;
+                return nullptr;
+            }
+            *length = static_cast<int>(m_rows[index].size());
+            *wrapped = m_wrapped[index];
+            return m_rows[index].constData();
+        };
+    }
+
+    // Whole lines [first, end) counted from kFirstLine.
+    static terminal::TextRange lines(int first, int end)
+    {
+        return {kFirstLine + first, 0, kFirstLine + end, 0};
+    }
+
+private:
+    QVector<QVector<terminal::Cell>> m_rows;
+    QVector<bool> m_wrapped;
+    QVector<bool> m_missing;
+};
+
+QByteArray writtenText(const FakeLines &lines, const terminal::TextRange &range)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    if (!terminal::writeRangeText(lines.reader(), range, buffer)) {
+        qWarning("writeRangeText failed");
+    }
+    return buffer.data();
+}
+
+}
+
+class TextExportTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void endsUnwrappedLinesWithNewline();
+    void joinsWrappedLines();
+    void dropsTrailingBlanks();
+    void cutsPartialLines();
+    void skipsContinuationCells();
+    void keepsMissingLinesAsBlank();
+    void writesUtf8();
+    void reportsWriteFailure();
+};
+
+void TextExportTest::endsUnwrappedLinesWithNewline()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("first")).addLine(QStringLiteral("second")).addLine(QStringLiteral("third"));
+
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(0, 3)), QStringLiteral("first\nsecond\nthird\n"));
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(1, 2)), QStringLiteral("second\n"));
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(1, 1)), QString());
+}
+
+void TextExportTest::joinsWrappedLines()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("a long "), true)
+        .addLine(QStringLiteral("command "), true)
+        .addLine(QStringLiteral("line  "))
+        .addLine(QStringLiteral("next"));
+
+    // Blanks at a wrap point are kept when the text carries on after them.
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(0, 4)),
+             QStringLiteral("a long command line\nnext\n"));
+}
+
+void TextExportTest::dropsTrailingBlanks()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("prompt $   ")).addLine(QStringLiteral("     ")).addLine(QStringLiteral("  indented  "));
+
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(0, 3)),
+             QStringLiteral("prompt $\n\n  indented\n"));
+}
+
+void TextExportTest::cutsPartialLines()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("hello")).addLine(QStringLiteral("world"));
+
+    const quint64 first = FakeLines::kFirstLine;
+    QCOMPARE(terminal::rangeText(lines.reader(), {first, 2, first + 1, 3}), QStringLiteral("llo\nwor"));
+    QCOMPARE(terminal::rangeText(lines.reader(), {first, 1, first, 4}), QStringLiteral("ell"));
+    // Columns past the end of a line clamp to it.
+    QCOMPARE(terminal::rangeText(lines.reader(), {first + 1, 3, first + 1, 80}), QStringLiteral("ld"));
+}
+
+void TextExportTest::skipsContinuationCells()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("漢字 ok"), false, QStringLiteral("漢字"));
+
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(0, 1)), QStringLiteral("漢字 ok\n"));
+    // Starting on the right half of 漢 leaves it out.
+    const quint64 first = FakeLines::kFirstLine;
+    QCOMPARE(terminal::rangeText(lines.reader(), {first, 1, first, 4}), QStringLiteral("字"));
+}
+
+void TextExportTest::keepsMissingLinesAsBlank()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("before")).addMissingLine().addLine(QStringLiteral("after"));
+
+    QCOMPARE(terminal::rangeText(lines.reader(), FakeLines::lines(0, 3)), QStringLiteral("before\n\nafter\n"));
+}
+
+void TextExportTest::writesUtf8()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("café  "), true)
+        .addLine(QStringLiteral("漢字"), false, QStringLiteral("漢字"))
+        .addLine(QString::fromUcs4(U"\U0001F600 done"));
+
+    const terminal::TextRange range = FakeLines::lines(0, 3);
+    const QByteArray expected = terminal::rangeText(lines.reader(), range).toUtf8();
+    QCOMPARE(expected, QByteArray("café  漢字\n\xf0\x9f\x98\x80 done\n"));
+    QCOMPARE(writtenText(lines, range), expected);
+}
+
+void TextExportTest::reportsWriteFailure()
+{
+    FakeLines lines;
+    lines.addLine(QStringLiteral("text"));
+
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadOnly);
+    QVERIFY(!terminal::writeRangeText(lines.reader(), FakeLines::lines(0, 1), buffer));
+}
+
+QTEST_GUILESS_MAIN(TextExportTest)
+#include "text_export_test.moc"
@@ -0,0 +1,142 @@
+#include "text_matcher.h"
+
+#include "test_cells.h"
+
+#include <QTest>
+
+namespace terminal
+{
+
+// Lets QCOMPARE print the spans that differ.
+char *toString(const ColumnSpan &span)
+{
+    return QTest::toString(QStringLiteral("{%1, %2}").arg(span.column).arg(span.length));
+}
+
+}
+
+Q_DECLARE_METATYPE(terminal::ColumnSpan)
+
+namespace {
+
+QVector<terminal::ColumnSpan> find(const QString &pattern, bool caseSensitive, bool regex,
+                                   const QVector<terminal::Cell> &cells)
+{
+    terminal::TextMatcher matcher;
+    QString error;
+    if (!matcher.setPattern(pattern, caseSensitive, regex, &error)) {
+        qWarning("pattern did not compile: %s", qPrintable(error));
+        return {};
+    }
+    QVector<terminal::ColumnSpan> spans;
+    matcher.match(cells.constData(), static_cast<int>(cells.size()), spans);
+    return spans;
+}
+
+using Spans = QVector<terminal::ColumnSpan>;
+
+}
+
+class TextMatcherTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyPatternMatchesNothing();
+    void findsPlainText();
+    void foldsCaseWhenAsked();
+    void reportsColumnsAroundWideCharacters();
+    void findsNonOverlappingMatches();
+    void rejectsInvalidRegex();
+    void matchesRegex_data();
+    void matchesRegex();
+};
+
+void TextMatcherTest::emptyPatternMatchesNothing()
+{
+    terminal::TextMatcher matcher;
+    QVERIFY(matcher.setPattern(QString(), true, false));
+    QVERIFY(matcher.isEmpty());
+    QCOMPARE(find(QString(), true, true, makeCells(QStringLiteral("abc"))), Spans());
+}
+
+void TextMatcherTest::findsPlainText()
+{
+    // Long enough that the four-at-a-time scan and its tail both run.
+    const QVector<terminal::Cell> cells = makeCells(QStringLiteral("the quick brown fox jumps over the lazy dog"));
+    QCOMPARE(find(QStringLiteral("the"), true, false, cells), Spans({{0, 3}, {31, 3}}));
+    QCOMPARE(find(QStringLiteral("dog"), true, false, cells), Spans({{40, 3}}));
+    QCOMPARE(find(QStringLiteral("cat"), true, false, cells), Spans());
+    QCOMPARE(find(QStringLiteral("a.y"), true, false, cells), Spans());
+}
+
+void TextMatcherTest::foldsCaseWhenAsked()
+{
+    const QVector<terminal::Cell> cells = makeCells(QStringLiteral("Error: error ERROR"));
+    QCOMPARE(find(QStringLiteral("error"), true, false, cells), Spans({{7, 5}}));
+    QCOMPARE(find(QStringLiteral("error"), false, false, cells), Spans({{0, 5}, {7, 5}, {13, 5}}));
+    QCOMPARE(find(QStringLiteral("ERR.R"), false, true, cells), Spans({{0, 5}, {7, 5}, {13, 5}}));
+}
+
+void TextMatcherTest::reportsColumnsAroundWideCharacters()
+{
+    const QString wide = QStringLiteral("漢字");
+    const QVector<terminal::Cell> cells = makeCells(QStringLiteral("a漢字b"), wide);
+    QCOMPARE(find(QStringLiteral("b"), true, false, cells), Spans({{5, 1}}));
+    QCOMPARE(find(QStringLiteral("字"), true, false, cells), Spans({{3, 2}}));
+    QCOMPARE(find(QStringLiteral("漢.b"), true, true, cells), Spans({{1, 5}}));
+}
+
+void TextMatcherTest::findsNonOverlappingMatches()
+{
+    const QVector<terminal::Cell> cells = makeCells(QStringLiteral("aaaaa"));
+    QCOMPARE(find(QStringLiteral("aa"), true, false, cells), Spans({{0, 2}, {2, 2}}));
+    QCOMPARE(find(QStringLiteral("a+"), true, true, cells), Spans({{0, 5}}));
+}
+
+void TextMatcherTest::rejectsInvalidRegex()
+{
+    terminal::TextMatcher matcher;
+    QString error;
+    QVERIFY(!matcher.setPattern(QStringLiteral("(unclosed"), true, true, &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!matcher.setPattern(QStringLiteral("trailing\\"), true, true, &error));
+}
+
+void TextMatcherTest::matchesRegex_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("line");
+    QTest::addColumn<Spans>("expected");
+
+    // Each pattern's prefilter literal must be one the match really
+    // contains, or lines that match are skipped.
+    QTest::newRow("escaped dot") << QStringLiteral("a\\.txt") << QStringLiteral("x a.txt") << Spans({{2, 5}});
+    QTest::newRow("class escape") << QStringLiteral("\\d+ms") << QStringLiteral("took 12ms") << Spans({{5, 4}});
+    QTest::newRow("literal missing") << QStringLiteral("\\d+ms") << QStringLiteral("took 12 s") << Spans();
+    QTest::newRow("hex escape") << QStringLiteral("\\x41BC") << QStringLiteral("zABCz") << Spans({{1, 3}});
+    QTest::newRow("octal escape") << QStringLiteral("\\101BC") << QStringLiteral("zABCz") << Spans({{1, 3}});
+    QTest::newRow("property escape") << QStringLiteral("\\p{Lu}x") << QStringLiteral("aQx") << Spans({{1, 2}});
+    QTest::newRow("leading bracket in class") << QStringLiteral("[]x]yz") << QStringLiteral("a]yz")
+                                              << Spans({{1, 3}});
+    QTest::newRow("negated leading bracket") << QStringLiteral("[^]x]yz") << QStringLiteral("]yz ayz")
+                                             << Spans({{4, 3}});
+    QTest::newRow("posix class") << QStringLiteral("[[:alpha:]]42") << QStringLiteral("-z42") << Spans({{1, 3}});
+    QTest::newRow("optional literal") << QStringLiteral("colou?r") << QStringLiteral("color colour")
+                                      << Spans({{0, 5}, {6, 6}});
+    QTest::newRow("group") << QStringLiteral("(ab)+c") << QStringLiteral("ababc") << Spans({{0, 5}});
+    QTest::newRow("alternation") << QStringLiteral("cat|dog") << QStringLiteral("hotdog") << Spans({{3, 3}});
+    QTest::newRow("inline option") << QStringLiteral("(?i)warn") << QStringLiteral("WARN") << Spans({{0, 4}});
+}
+
+void TextMatcherTest::matchesRegex()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, line);
+    QFETCH(Spans, expected);
+
+    QCOMPARE(find(pattern, true, true, makeCells(line)), expected);
+}
+
+QTEST_GUILESS_MAIN(TextMatcherTest)
+#include "text_matcher_test.moc"
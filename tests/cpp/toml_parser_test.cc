@@ -0,0 +1,161 @@
+#include "toml_parser.h"
+
+#include <QDateTime>
+#include <QTest>
+#include <QTimeZone>
+
+class TomlParserTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parsesScalarsAndTables();
+    void parsesArraysAndInlineTables();
+    void parsesStrings();
+    void recordsKeyLines();
+    void rejectsRedefinitions_data();
+    void rejectsRedefinitions();
+    void rejectsMalformedValues_data();
+    void rejectsMalformedValues();
+};
+
+void TomlParserTest::parsesScalarsAndTables()
+{
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    const QByteArray data = "title = \"keith\" # trailing comment\n"
+                            "[font]\n"
+                            "family = 'Mono'\n"
+                            "size = 13.5\n"
+                            "ligatures = true\n"
+                            "[scrollback]\n"
+                            "lines = 10_000\n"
+                            "mask = 0xff\n"
+                            "started = 1979-05-27T07:32:00Z\n";
+    QVERIFY2(terminal::parseToml(data, document, error), qPrintable(error.message));
+
+    QCOMPARE(document.root.value("title").toString(), QStringLiteral("keith"));
+    const QVariantMap font = document.root.value("font").toMap();
+    QCOMPARE(font.value("family").toString(), QStringLiteral("Mono"));
+    QCOMPARE(font.value("size").toDouble(), 13.5);
+    QCOMPARE(font.value("ligatures").toBool(), true);
+    const QVariantMap scrollback = document.root.value("scrollback").toMap();
+    QCOMPARE(scrollback.value("lines").toLongLong(), 10000);
+    QCOMPARE(scrollback.value("mask").toLongLong(), 255);
+    QCOMPARE(scrollback.value("started").toDateTime(), QDateTime(QDate(1979, 5, 27), QTime(7, 32), QTimeZone::UTC));
+}
+
+void TomlParserTest::parsesArraysAndInlineTables()
+{
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    const QByteArray data = "colors = [1, 2,\n  3,]\n"
+                            "point = { x = 1, y = 2 }\n"
+                            "a.b.c = 'dotted'\n"
+                            "[[trigger]]\n"
+                            "pattern = \"error\"\n"
+                            "[[trigger]]\n"
+                            "pattern = \"warning\"\n";
+    QVERIFY2(terminal::parseToml(data, document, error), qPrintable(error.message));
+
+    QCOMPARE(document.root.value("colors").toList(), QVariantList({qint64(1), qint64(2), qint64(3)}));
+    const QVariantMap point = document.root.value("point").toMap();
+    QCOMPARE(point.value("x").toLongLong(), 1);
+    QCOMPARE(point.value("y").toLongLong(), 2);
+    QCOMPARE(document.root.value("a").toMap().value("b").toMap().value("c").toString(), QStringLiteral("dotted"));
+    const QVariantList triggers = document.root.value("trigger").toList();
+    QCOMPARE(triggers.size(), 2);
+    QCOMPARE(triggers.at(0).toMap().value("pattern").toString(), QStringLiteral("error"));
+    QCOMPARE(triggers.at(1).toMap().value("pattern").toString(), QStringLiteral("warning"));
+}
+
+void TomlParserTest::parsesStrings()
+{
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    const QByteArray data = "escaped = \"tab\\tquote\\\" \\u00e9\"\n"
+                            "literal = 'C:\\path'\n"
+                            "multi = \"\"\"\nfirst\nsecond\"\"\"\n"
+                            "\"quoted key\" = 1\n";
+    QVERIFY2(terminal::parseToml(data, document, error), qPrintable(error.message));
+
+    QCOMPARE(document.root.value("escaped").toString(), QStringLiteral("tab\tquote\" \u00e9"));
+    QCOMPARE(document.root.value("literal").toString(), QStringLiteral("C:\\path"));
+    QCOMPARE(document.root.value("multi").toString(), QStringLiteral("first\nsecond"));
+    QCOMPARE(document.root.value("quoted key").toLongLong(), 1);
+}
+
+void TomlParserTest::recordsKeyLines()
+{
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    const QByteArray data = "# comment\n"
+                            "\n"
+                            "[font]\n"
+                            "size = 12\n"
+                            "\"family name\" = 'Mono'\n";
+    QVERIFY2(terminal::parseToml(data, document, error), qPrintable(error.message));
+
+    QCOMPARE(document.keyLines.value("font"), 3);
+    QCOMPARE(document.keyLines.value("font.size"), 4);
+    QCOMPARE(document.keyLines.value("font.family name"), 5);
+}
+
+void TomlParserTest::rejectsRedefinitions_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("line");
+    QTest::addColumn<QString>("message");
+
+    QTest::newRow("duplicate key") << QByteArray("a = 1\nb = 2\na = 3\n") << 3 << QStringLiteral("duplicate key 'a'");
+    QTest::newRow("table twice") << QByteArray("[a]\nx = 1\n[a]\n") << 3
+                                 << QStringLiteral("table 'a' is defined twice");
+    QTest::newRow("header over dotted key") << QByteArray("a.b = 1\n[a]\n") << 2
+                                            << QStringLiteral("table 'a' is defined twice");
+    QTest::newRow("inline table is sealed") << QByteArray("p = { x = 1 }\np.y = 2\n") << 2
+                                            << QStringLiteral("cannot add keys to 'p'");
+    QTest::newRow("value is not a table array") << QByteArray("t = 1\n[[t]]\n") << 2
+                                                << QStringLiteral("'t' is not an array of tables");
+}
+
+void TomlParserTest::rejectsRedefinitions()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(int, line);
+    QFETCH(QString, message);
+
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    QVERIFY(!terminal::parseToml(data, document, error));
+    QCOMPARE(error.line, line);
+    QCOMPARE(error.message, message);
+}
+
+void TomlParserTest::rejectsMalformedValues_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("unterminated string") << QByteArray("a = \"open\n");
+    QTest::newRow("bad escape") << QByteArray("a = \"\\q\"\n");
+    QTest::newRow("leading zero") << QByteArray("a = 012\n");
+    QTest::newRow("stray underscore") << QByteArray("a = 1__0\n");
+    QTest::newRow("underscore before exponent") << QByteArray("a = 1_e5\n");
+    QTest::newRow("missing value") << QByteArray("a =\n");
+    QTest::newRow("unterminated array") << QByteArray("a = [1, 2\n");
+    QTest::newRow("junk after value") << QByteArray("a = 1 2\n");
+    QTest::newRow("trailing comma in inline table") << QByteArray("a = { x = 1, }\n");
+}
+
+void TomlParserTest::rejectsMalformedValues()
+{
+    QFETCH(QByteArray, data);
+
+    terminal::TomlDocument document;
+    terminal::TomlError error;
+    QVERIFY(!terminal::parseToml(data, document, error));
+    QVERIFY(!error.message.isEmpty());
+    QCOMPARE(error.line, 1);
+}
+
+QTEST_GUILESS_MAIN(TomlParserTest)
+#include "toml_parser_test.moc"
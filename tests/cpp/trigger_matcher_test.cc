@@ -0,0 +1,120 @@
+#include "trigger_matcher.h"
+
+#include "test_cells.h"
+
+#include <QTest>
+
+#include <algorithm>
+
+namespace {
+
+terminal::TriggerConfig makeTrigger(const QString &pattern, bool caseSensitive = false)
+{
+    terminal::TriggerConfig trigger;
+    trigger.pattern = pattern;
+    trigger.caseSensitive = caseSensitive;
+    return trigger;
+}
+
+// Hits as "trigger@column+length", sorted: the automaton reports patterns
+// that end on the same character in no particular order.
+QStringList hitsIn(terminal::TriggerMatcher &matcher, const QVector<terminal::Cell> &cells)
+{
+    QVector<terminal::TriggerHit> hits;
+    matcher.match(cells.constData(), static_cast<int>(cells.size()), hits);
+    QStringList result;
+    for (const terminal::TriggerHit &hit : std::as_const(hits)) {
+        result.append(QStringLiteral("%1@%2+%3").arg(hit.trigger).arg(hit.column).arg(hit.length));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}
+
+class TriggerMatcherTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyMatcherFindsNothing();
+    void findsEveryOccurrence();
+    void findsOverlappingPatterns();
+    void foldsCaseUnlessSensitive();
+    void foldsNonAsciiCase();
+    void reportsColumnsAroundWideCharacters();
+    void rebuildReplacesPatterns();
+};
+
+void TriggerMatcherTest::emptyMatcherFindsNothing()
+{
+    terminal::TriggerMatcher matcher;
+    QVERIFY(matcher.isEmpty());
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("anything"))), QStringList());
+
+    matcher.build({makeTrigger(QString())});
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("anything"))), QStringList());
+}
+
+void TriggerMatcherTest::findsEveryOccurrence()
+{
+    terminal::TriggerMatcher matcher;
+    matcher.build({makeTrigger(QStringLiteral("ab")), makeTrigger(QStringLiteral("aa"))});
+
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("ab-xab"))), QStringList({"0@0+2", "0@4+2"}));
+    // Unlike a search, triggers report overlapping occurrences too.
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("aaab"))), QStringList({"0@2+2", "1@0+2", "1@1+2"}));
+}
+
+void TriggerMatcherTest::findsOverlappingPatterns()
+{
+    // The textbook case: failure links must carry "he" into "she".
+    terminal::TriggerMatcher matcher;
+    matcher.build({makeTrigger(QStringLiteral("he")), makeTrigger(QStringLiteral("she")),
+                   makeTrigger(QStringLiteral("his")), makeTrigger(QStringLiteral("hers"))});
+
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("ushers"))), QStringList({"0@2+2", "1@1+3", "3@2+4"}));
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("ahishers"))),
+             QStringList({"0@4+2", "1@3+3", "2@1+3", "3@4+4"}));
+}
+
+void TriggerMatcherTest::foldsCaseUnlessSensitive()
+{
+    terminal::TriggerMatcher matcher;
+    matcher.build({makeTrigger(QStringLiteral("error")), makeTrigger(QStringLiteral("Fatal"), true)});
+
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("ERROR Error"))), QStringList({"0@0+5", "0@6+5"}));
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("fatal FATAL Fatal"))), QStringList({"1@12+5"}));
+}
+
+void TriggerMatcherTest::foldsNonAsciiCase()
+{
+    terminal::TriggerMatcher matcher;
+    matcher.build({makeTrigger(QStringLiteral("Ärger"))});
+
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("kein ärger"))), QStringList({"0@5+5"}));
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("ÄRGER"))), QStringList({"0@0+5"}));
+}
+
+void TriggerMatcherTest::reportsColumnsAroundWideCharacters()
+{
+    terminal::TriggerMatcher matcher;
+    matcher.build({makeTrigger(QStringLiteral("字x")), makeTrigger(QStringLiteral("字"))});
+
+    // 漢 and 字 each take two cells; a hit ending on a wide character
+    // includes its continuation cell.
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("漢字x"), QStringLiteral("漢字"))),
+             QStringList({"0@2+3", "1@2+2"}));
+}
+
+void TriggerMatcherTest::rebuildReplacesPatterns()
+{
+    terminal::TriggerMatcher matcher;
+    matcher.build({makeTrigger(QStringLiteral("old"))});
+    matcher.build({makeTrigger(QStringLiteral("new"))});
+
+    QCOMPARE(hitsIn(matcher, makeCells(QStringLiteral("old new"))), QStringList({"0@4+3"}));
+}
+
+QTEST_GUILESS_MAIN(TriggerMatcherTest)
+#include "trigger_matcher_test.moc"